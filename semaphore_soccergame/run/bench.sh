@@ -0,0 +1,42 @@
+#!/bin/bash
+#
+# Benchmark driver: runs the simulation several times and appends one record per run to a report.
+#
+# USAGE: ./bench.sh [-n number-of-runs] [-o report] [generator options]
+#
+# The report is CSV, or JSON Lines when its name ends in .json (see writeReport in
+# probSemSharedMemSoccerGame.c); it is created anew, so that every report describes a single build.
+# Generator options select the roster (-p -g -P -G -k), the tournament length (-m), the engine (-t, or -e
+# with its workers), the log format (-b) and whether entities pause (-z disables pacing, to measure only
+# synchronization).
+
+n=10
+report=bench.csv
+
+# the driver options come first, every other one goes to the generator
+while [ $# -ge 2 ]
+do
+    case $1 in
+        -n) n=$2; shift 2;;
+        -o) report=$2; shift 2;;
+        *) break;;
+    esac
+done
+
+if ! [ $n -gt 0 ] 2>/dev/null; then
+    echo "Wrong number of runs (\"$n\"). Aborting."
+    exit 1
+fi
+
+rm -f "$report"
+for i in $(seq 1 $n)
+do
+    if ! ./probSemSharedMemSoccerGame -r "$report" "$@" bench.log 2>bench.err; then
+        echo "Run n.º $i failed:"
+        cat bench.err
+        exit 1
+    fi
+done
+rm -f bench.err
+
+cat "$report"
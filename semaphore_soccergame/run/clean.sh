@@ -3,15 +3,42 @@
 rm -f error*
 rm -f core
 
-#unsafe
-key=$(ipcs | grep " 120 " | cut -d\  -f1)
+# same key as ftok (".", 'a'): proj_id, low byte of the device, low 16 bits of the inode
+read dev ino <<< "$(stat -c '%d %i' .)"
+key=$(printf "0x%02x%02x%04x" 97 $((dev & 0xff)) $((ino & 0xffff)))
 
-if [[ -z $key ]]
+# an object of POSIX shared memory is in use while some live process has it mapped
+mapped() { grep -qsF "$1" /proc/[0-9]*/maps; }
+
+# futex semaphore sets (make SEMAPHORE=futex) live in POSIX shared memory, named after the key, or after the pid
+# of the generator for a private one: only the set of this directory's key and the private sets whose generator is
+# gone are removed, and neither while some process still maps it, so that simulations still running are left alone
+for f in /dev/shm/soccergame.sem.${key#0x} /dev/shm/soccergame.sem.private.*
+do
+   [ -e "$f" ] || continue
+   [[ "$f" == */soccergame.sem.private.* ]] && kill -0 "${f##*.}" 2>/dev/null && continue
+   mapped "$f" || rm -f "$f"
+done
+
+# POSIX shared memory blocks (make SHMEM=posix) are named after the key and the pid of the generator:
+# only those whose generator is gone are removed; the block of the IPC pool (option -u) ends in "pool" instead of
+# a pid, and is removed only for this directory's key and while no process maps it
+for f in /dev/shm/soccergame.shm.* ${SOCCERGAME_HUGETLB:+$SOCCERGAME_HUGETLB/soccergame.shm.*}
+do
+   [ -e "$f" ] || continue
+   if [ "${f##*.}" = pool ]
+   then
+      [[ "$f" == */soccergame.shm.${key#0x}.pool ]] && ! mapped "$f" && rm -f "$f"
+   else
+      kill -0 "${f##*.}" 2>/dev/null || rm -f "$f"
+   fi
+done
+
+if ! ipcs -m | grep -q "^$key " && ! ipcs -s | grep -q "^$key "
 then
    echo Did not find soccergame IPC resources
    exit 1
 fi
 
-ipcrm -S $key
-ipcrm -M $key
-
+ipcrm -S $key 2>/dev/null
+ipcrm -M $key 2>/dev/null
@@ -1,4 +1,5 @@
 #!/bin/bash
 
-./probSemSharedMemSoccerGame | awk -f filter_log.awk
-
+# filtered view of the log, read from the generator as it is written; logAnalyze handles any roster
+# (see its -s and -c options for the metrics of the run and the protocol checks)
+./probSemSharedMemSoccerGame "$@" | ./logAnalyze
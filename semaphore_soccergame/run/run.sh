@@ -11,8 +11,15 @@ if ! [ $n -gt 0 ] 2>/dev/null; then
     exit 1
 fi
 
+# latency histograms are accumulated over all runs into $LATENCY, when set; a run whose matches take longer
+# than $DEADLINE ms is killed and cleaned up, so that it does not stall the batch; entities are pinned to
+# processors with the placement policy $AFFINITY (pack, spread or referee), when set, and short waits poll their
+# semaphore up to $SPIN times before blocking, when set; all runs share one semaphore set and shared region, reset
+# in place by each of them, when $POOL is set (remove them with clean.sh once the batch is over)
+opts="${LATENCY:+-l $LATENCY} ${DEADLINE:+-d $DEADLINE} ${AFFINITY:+-a $AFFINITY} ${SPIN:+-w $SPIN} ${POOL:+-u}"
+
 for i in $(seq 1 $n)
 do
      echo -e "\n\e[34;1mRun n.º $i\e[0m"
-     ./probSemSharedMemSoccerGame
+     ./probSemSharedMemSoccerGame $opts
 done
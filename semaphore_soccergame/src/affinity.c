@@ -0,0 +1,334 @@
+/**
+ *  \file affinity.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Placement of the intervening entities on the processors, and of the shared region on a memory node.
+ *
+ *  The processor of every entity is chosen once, in the order of the pitches: the players of a pitch, its goalies,
+ *  then its referee, so that round-robin keeps the entities that share the data of a pitch on neighbouring
+ *  processors. Processes are placed by the generator right after they are generated, which is early enough since
+ *  they do not touch the shared region before the start of operations; threads are created in place.
+ *
+ *  The memory policy is set with the <tt>mbind</tt> system call, so that no NUMA library is needed.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sched.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "affinity.h"
+
+/** \brief largest number of memory nodes a region may be bound to */
+#define  MAXNODES      1024
+
+/**
+ *  \brief Definition of <em>processor</em> data type.
+ */
+typedef struct {
+    /** \brief processor number */
+    int cpu;
+    /** \brief package (socket) of the processor */
+    int package;
+    /** \brief core of the processor, within its package */
+    int core;
+} PROCESSOR;
+
+/** \brief names of the policies, indexed by policy */
+static const char *policyName[] = { "none", "pack", "spread", "referee" };
+
+/** \brief placement policy */
+static int policy = AFF_NONE;
+
+/** \brief referees run with the policy SCHED_FIFO */
+static bool fifo = false;
+
+/** \brief number of players, goalies and referees */
+static unsigned int nP, nG, nR;
+
+/** \brief processor of every entity: players, goalies and referees, in this order */
+static int *cpuOf;
+
+/** \brief memory node the shared region is bound to */
+static int memNode;
+
+/** \brief number of distinct processors and cores the entities were placed on */
+static unsigned int nCpus, nCores;
+
+/* internal functions */
+
+static int readInt (const char *path, int dflt)
+{
+    FILE *fp = fopen (path, "r");
+    int v;
+
+    if (fp == NULL) return dflt;
+    if (fscanf (fp, "%d", &v) != 1) v = dflt;
+    fclose (fp);
+    return v;
+}
+
+/* the node of a processor is the nodeN entry of its sysfs directory */
+static int nodeOf (int cpu)
+{
+    char path[64];
+    struct dirent *d;
+    DIR *dir;
+    int node = 0;
+
+    snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d", cpu);
+    if ((dir = opendir (path)) == NULL) return 0;
+    while ((d = readdir (dir)) != NULL) {
+        if ((strncmp (d->d_name, "node", 4) == 0) && (sscanf (d->d_name + 4, "%d", &node) == 1)) break;
+    }
+    closedir (dir);
+    return node;
+}
+
+/* processors the calling process may run on, with their topology */
+static unsigned int processors (PROCESSOR **proc)
+{
+    char path[96];
+    cpu_set_t set;
+    unsigned int n = 0;
+    int cpu;
+
+    if (sched_getaffinity (0, sizeof (set), &set) == -1) {
+        perror ("error on getting the affinity of the generator");
+        exit (EXIT_FAILURE);
+    }
+    if ((*proc = malloc ((size_t) CPU_COUNT (&set) * sizeof (PROCESSOR))) == NULL) {
+        perror ("error on allocating the processor table");
+        exit (EXIT_FAILURE);
+    }
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET (cpu, &set)) continue;
+        PROCESSOR *p = &(*proc)[n++];
+
+        p->cpu = cpu;
+        snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        p->package = readInt (path, 0);
+        snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        p->core = readInt (path, cpu);
+    }
+    return n;
+}
+
+/* keeps the first hardware thread of every core */
+static unsigned int firstThreads (PROCESSOR *proc, unsigned int n)
+{
+    unsigned int i, j, m = 0;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; (j < m) && ((proc[j].package != proc[i].package) || (proc[j].core != proc[i].core)); j++) ;
+        if (j == m) proc[m++] = proc[i];
+    }
+    return m;
+}
+
+/* index of an entity among all entities */
+static unsigned int entityIndex (char kind, unsigned int id)
+{
+    switch (kind) {
+        case 'P': return id;
+        case 'G': return nP + id;
+        default:  return nP + nG + id;
+    }
+}
+
+/* deals the processors round-robin to the entities, pitch by pitch; referees are left out when they have their own */
+static void deal (PROCESSOR *proc, unsigned int n, bool referees)
+{
+    unsigned int k, e, next = 0;
+
+    for (k = 0; k < nR; k++) {
+        for (e = k; e < nP; e += nR) {
+            cpuOf[e] = proc[next++ % n].cpu;
+        }
+        for (e = k; e < nG; e += nR) {
+            cpuOf[nP + e] = proc[next++ % n].cpu;
+        }
+        if (referees) cpuOf[nP + nG + k] = proc[next++ % n].cpu;
+    }
+}
+
+/* external functions */
+
+/**
+ *  \brief Policy with a given name.
+ *
+ *  \param name name of the policy (<tt>pack</tt>, <tt>spread</tt> or <tt>referee</tt>)
+ *
+ *  \return policy, upon success
+ *  \return -\c 1, if there is no policy with that name
+ */
+int affPolicy (const char *name)
+{
+    int p;
+
+    for (p = AFF_PACK; p <= AFF_REFEREE; p++) {
+        if (strcmp (name, policyName[p]) == 0) return p;
+    }
+    return -1;
+}
+
+/**
+ *  \brief Choosing the processor of every entity, among those the calling process may run on.
+ *
+ *  \param pol placement policy (AFF_NONE leaves the entities alone)
+ *  \param fifoReferees referees run with the policy SCHED_FIFO
+ *  \param nPlayers total number of players
+ *  \param nGoalies total number of goalies
+ *  \param nReferees total number of referees, one per pitch
+ */
+void affInit (int pol, bool fifoReferees, unsigned int nPlayers, unsigned int nGoalies, unsigned int nReferees)
+{
+    PROCESSOR *proc;
+    unsigned int n, i, m;
+
+    policy = pol;
+    fifo = fifoReferees;
+    nP = nPlayers;
+    nG = nGoalies;
+    nR = nReferees;
+    if (policy == AFF_NONE) return;
+
+    if ((cpuOf = malloc ((size_t) (nP + nG + nR) * sizeof (int))) == NULL) {
+        perror ("error on allocating the placement table");
+        exit (EXIT_FAILURE);
+    }
+    n = processors (&proc);
+    switch (policy) {
+        case AFF_PACK:                                           /* the package of the first processor */
+            for (i = 0, m = 0; i < n; i++) {
+                if (proc[i].package == proc[0].package) proc[m++] = proc[i];
+            }
+            deal (proc, m, true);                         /* every hardware thread of the package */
+            nCpus = m;
+            nCores = firstThreads (proc, m);
+            break;
+        case AFF_SPREAD:
+            nCpus = nCores = n = firstThreads (proc, n);
+            deal (proc, n, true);
+            break;
+        case AFF_REFEREE:
+            nCpus = nCores = n = firstThreads (proc, n);
+            for (i = 0; i < nR; i++) {
+                cpuOf[nP + nG + i] = proc[i % n].cpu;
+            }
+            /* the players and goalies share the cores left, or all of them when there are too few */
+            if (n > nR) deal (proc + nR, n - nR, false);
+            else deal (proc, n, false);
+            break;
+    }
+    memNode = nodeOf (cpuOf[nP + nG]);
+    free (proc);
+}
+
+/**
+ *  \brief Placing an entity process just generated, before the start of operations.
+ *
+ *  \param pid process id of the entity
+ *  \param kind kind of entity (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id within its kind
+ */
+void affProcess (pid_t pid, char kind, unsigned int id)
+{
+    struct sched_param sp = { .sched_priority = sched_get_priority_min (SCHED_FIFO) };
+    cpu_set_t set;
+
+    /* an entity that already ended (ESRCH) is reported by the supervision */
+    if (policy != AFF_NONE) {
+        CPU_ZERO (&set);
+        CPU_SET (cpuOf[entityIndex (kind, id)], &set);
+        if ((sched_setaffinity (pid, sizeof (set), &set) == -1) && (errno != ESRCH)) {
+            perror ("error on setting the affinity of an entity");
+            exit (EXIT_FAILURE);
+        }
+    }
+    if (fifo && (kind == 'R') && (sched_setscheduler (pid, SCHED_FIFO, &sp) == -1) && (errno != ESRCH)) {
+        perror ("error on setting the scheduling policy of a referee");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Setting up the attributes of an entity thread, so that it is created in place.
+ *
+ *  \param attr pointer to the thread attributes
+ *  \param kind kind of entity (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id within its kind
+ */
+void affThread (pthread_attr_t *attr, char kind, unsigned int id)
+{
+    struct sched_param sp = { .sched_priority = sched_get_priority_min (SCHED_FIFO) };
+    cpu_set_t set;
+    int err = 0;
+
+    if (policy != AFF_NONE) {
+        CPU_ZERO (&set);
+        CPU_SET (cpuOf[entityIndex (kind, id)], &set);
+        err = pthread_attr_setaffinity_np (attr, sizeof (set), &set);
+    }
+    if ((err == 0) && fifo) {
+        if (kind == 'R') {
+            if (((err = pthread_attr_setinheritsched (attr, PTHREAD_EXPLICIT_SCHED)) == 0) &&
+                ((err = pthread_attr_setschedpolicy (attr, SCHED_FIFO)) == 0))
+                err = pthread_attr_setschedparam (attr, &sp);
+        }
+        else err = pthread_attr_setinheritsched (attr, PTHREAD_INHERIT_SCHED);
+    }
+    if (err != 0) {
+        fprintf (stderr, "error on setting the placement of an entity thread: %s\n", strerror (err));
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Binding a memory region to the node of the entities, moving the pages already there.
+ *
+ *  Nothing is done without a placement policy, nor on a system without NUMA support.
+ *
+ *  \param addr address of the region, aligned to a page
+ *  \param len length of the region (in bytes)
+ */
+void affBindMemory (void *addr, size_t len)
+{
+    unsigned long mask[MAXNODES / (8 * sizeof (unsigned long))];
+
+    if ((policy == AFF_NONE) || (memNode >= MAXNODES)) return;
+    memset (mask, 0, sizeof (mask));
+    mask[memNode / (8 * sizeof (unsigned long))] = 1ul << (memNode % (8 * sizeof (unsigned long)));
+    /* maxnode is one more than the number of bits of the mask the kernel reads */
+    if ((syscall (SYS_mbind, addr, len, MPOL_BIND, mask, (unsigned long) MAXNODES + 1, MPOL_MF_MOVE) == -1) &&
+        (errno != ENOSYS)) {
+        perror ("error on binding the shared region to a memory node");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Printing a line describing the placement.
+ *
+ *  \param fp stream where the line is printed
+ */
+void affReport (FILE *fp)
+{
+    if (policy == AFF_NONE) {
+        if (fifo) fprintf (fp, "placement none, referees SCHED_FIFO\n");
+        return;
+    }
+    fprintf (fp, "placement %s: %u entities on %u processors (%u cores), shared region on node %d%s\n",
+             policyName[policy], nP + nG + nR, nCpus, nCores, memNode, fifo ? ", referees SCHED_FIFO" : "");
+}
@@ -0,0 +1,101 @@
+/**
+ *  \file affinity.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Placement of the intervening entities on the processors, and of the shared region on a memory node.
+ *
+ *  By default entities run wherever the scheduler takes them, so that they bounce across processors and the cache
+ *  lines of the shared region they touch migrate with them. A placement policy pins every entity to a processor,
+ *  chosen among those the generator may run on, with the entities of the same pitch next to each other:
+ *     \li <tt>pack</tt> all entities on the processors of a single package (socket), round-robin
+ *     \li <tt>spread</tt> one entity per core (a single hardware thread of each), round-robin over all cores
+ *     \li <tt>referee</tt> every referee on a core of its own, the players and goalies round-robin over the others.
+ *
+ *  The shared region is bound to the memory node of the processor of the first referee, and referees may run
+ *  with the real-time policy SCHED_FIFO, so that they are not preempted while the teams wait for them. The topology
+ *  is taken from sysfs; without it every processor is a core of package 0 and node 0.
+ *
+ *  Defined operations:
+ *     \li naming a policy
+ *     \li choosing the processor of every entity
+ *     \li placing an entity process, or an entity thread before it is created
+ *     \li binding a memory region to the node of the entities
+ *     \li describing the placement.
+ */
+
+#ifndef AFFINITY_H_
+#define AFFINITY_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/** \brief entities are not placed */
+#define  AFF_NONE      0
+/** \brief all entities on the processors of a single package */
+#define  AFF_PACK      1
+/** \brief one entity per core */
+#define  AFF_SPREAD    2
+/** \brief every referee on a core of its own */
+#define  AFF_REFEREE   3
+
+/**
+ *  \brief Policy with a given name.
+ *
+ *  \param name name of the policy (<tt>pack</tt>, <tt>spread</tt> or <tt>referee</tt>)
+ *
+ *  \return policy, upon success
+ *  \return -\c 1, if there is no policy with that name
+ */
+extern int affPolicy (const char *name);
+
+/**
+ *  \brief Choosing the processor of every entity, among those the calling process may run on.
+ *
+ *  \param policy placement policy (AFF_NONE leaves the entities alone)
+ *  \param fifo referees run with the policy SCHED_FIFO
+ *  \param nPlayers total number of players
+ *  \param nGoalies total number of goalies
+ *  \param nReferees total number of referees, one per pitch
+ */
+extern void affInit (int policy, bool fifo, unsigned int nPlayers, unsigned int nGoalies, unsigned int nReferees);
+
+/**
+ *  \brief Placing an entity process just generated, before the start of operations.
+ *
+ *  \param pid process id of the entity
+ *  \param kind kind of entity (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id within its kind
+ */
+extern void affProcess (pid_t pid, char kind, unsigned int id);
+
+/**
+ *  \brief Setting up the attributes of an entity thread, so that it is created in place.
+ *
+ *  \param attr pointer to the thread attributes
+ *  \param kind kind of entity (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id within its kind
+ */
+extern void affThread (pthread_attr_t *attr, char kind, unsigned int id);
+
+/**
+ *  \brief Binding a memory region to the node of the entities, moving the pages already there.
+ *
+ *  Nothing is done without a placement policy, nor on a system without NUMA support.
+ *
+ *  \param addr address of the region, aligned to a page
+ *  \param len length of the region (in bytes)
+ */
+extern void affBindMemory (void *addr, size_t len);
+
+/**
+ *  \brief Printing a line describing the placement.
+ *
+ *  \param fp stream where the line is printed
+ */
+extern void affReport (FILE *fp);
+
+#endif /* AFFINITY_H_ */
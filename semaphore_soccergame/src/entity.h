@@ -0,0 +1,56 @@
+/**
+ *  \file entity.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Life cycle of the intervening entities.
+ *
+ *  Each entity program connects to the IPC resources, by their key or through the identifiers passed on by the
+ *  generator (option -f), and then runs the life cycle of its entity. The generator may instead run the life cycles
+ *  in threads of its own (option -t): the entity sources are then compiled with ENTITY_THREAD defined, which leaves
+ *  their main program out, and every thread shares the semaphore set and the shared region already set up by the
+ *  generator.
+ */
+
+#ifndef ENTITY_H_
+#define ENTITY_H_
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Life cycle of a player, once for each match of the tournament.
+ *
+ *  \param id player id
+ *  \param logFile name of the logging file
+ *  \param semSet semaphore set access identifier
+ *  \param region pointer to the shared region
+ *
+ *  \return EXIT_SUCCESS, or EXIT_FAILURE when the id is wrong
+ */
+extern int runPlayer (unsigned int id, char logFile[], int semSet, SHARED_REGION *region);
+
+/**
+ *  \brief Life cycle of a goalie, once for each match of the tournament.
+ *
+ *  \param id goalie id
+ *  \param logFile name of the logging file
+ *  \param semSet semaphore set access identifier
+ *  \param region pointer to the shared region
+ *
+ *  \return EXIT_SUCCESS, or EXIT_FAILURE when the id is wrong
+ */
+extern int runGoalie (unsigned int id, char logFile[], int semSet, SHARED_REGION *region);
+
+/**
+ *  \brief Life cycle of a referee, once for each match of the tournament.
+ *
+ *  \param id referee id, which is the pitch it is in charge of
+ *  \param logFile name of the logging file
+ *  \param semSet semaphore set access identifier
+ *  \param region pointer to the shared region
+ *
+ *  \return EXIT_SUCCESS, or EXIT_FAILURE when the id is wrong
+ */
+extern int runReferee (unsigned int id, char logFile[], int semSet, SHARED_REGION *region);
+
+#endif /* ENTITY_H_ */
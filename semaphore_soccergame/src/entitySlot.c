@@ -0,0 +1,138 @@
+/**
+ *  \file entitySlot.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Slots of the players and goalies of a pitch.
+ *
+ *  Lists are singly linked through the <tt>next</tt> field of the slots, with -1 as the end.
+ *
+ *  Defined operations:
+ *     \li resetting the slots for a new match
+ *     \li queueing an entity waiting for a team
+ *     \li forming a team out of the entities waiting longest
+ *     \li waking every member of a team.
+ */
+
+#include <stdio.h>
+
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "entitySlot.h"
+
+/** \brief number of <em>ups</em> carried out by a single semOps */
+#define  WAKEBATCH      SEM_MAXOPS
+
+/* internal functions */
+
+static void listInit(SLOT_LIST *l)
+{
+    l->head = l->tail = -1;
+}
+
+static int dequeue(SHARED_DATA *sh, SLOT_LIST *l)
+{
+    int slot = l->head;
+
+    if (slot != -1) {
+        l->head = SLOT (sh, slot).next;
+        if (l->head == -1) l->tail = -1;
+        SLOT (sh, slot).next = -1;
+    }
+    return slot;
+}
+
+/* external functions */
+
+/**
+ *  \brief Resetting the slots and lists of a pitch for a new match: no entity is waiting or has a team.
+ *
+ *  \param sh pointer to the shared information of the pitch
+ */
+void slotReset (SHARED_DATA *sh)
+{
+    int i, t;
+
+    listInit (&sh->playersWaiting);
+    listInit (&sh->goaliesWaiting);
+    for (t = 0; t < NUMTEAMS; t++) {
+        listInit (&sh->team[t]);
+    }
+    for (i = 0; i < sh->fSt.nPlayers + sh->fSt.nGoalies; i++) {
+        SLOT (sh, i).team = 0;
+        SLOT (sh, i).next = -1;
+    }
+}
+
+/**
+ *  \brief Adding an entity at the end of a list of slots.
+ *
+ *  \param sh pointer to the shared information of the pitch
+ *  \param l pointer to the list
+ *  \param slot slot index of the entity (see PLAYERSLOTID and GOALIESLOTID)
+ */
+void slotEnqueue (SHARED_DATA *sh, SLOT_LIST *l, int slot)
+{
+    SLOT (sh, slot).next = -1;
+    if (l->tail == -1) l->head = slot;
+    else SLOT (sh, l->tail).next = slot;
+    l->tail = slot;
+}
+
+/**
+ *  \brief Forming a team: its captain and the players and goalies waiting longest for a team.
+ *
+ *  The team is recorded in the slot of every member, and the members are linked in the list of the team, the
+ *  captain first. There must be enough entities waiting.
+ *
+ *  \param sh pointer to the shared information of the pitch
+ *  \param team team id (1 or 2)
+ *  \param captain slot index of the captain
+ *  \param nPlayers number of waiting players that join the team
+ *  \param nGoalies number of waiting goalies that join the team
+ */
+void slotFormTeam (SHARED_DATA *sh, int team, int captain, int nPlayers, int nGoalies)
+{
+    SLOT_LIST *l = &sh->team[team - 1];
+    int i, slot;
+
+    SLOT (sh, captain).team = team;
+    slotEnqueue (sh, l, captain);
+    for (i = 0; i < nPlayers + nGoalies; i++) {
+        slot = dequeue (sh, (i < nPlayers) ? &sh->playersWaiting : &sh->goaliesWaiting);
+        SLOT (sh, slot).team = team;
+        slotEnqueue (sh, l, slot);
+    }
+}
+
+/**
+ *  \brief Waking every member of a team with an <em>up</em> on its private semaphore.
+ *
+ *  The <em>ups</em> are carried out in batches of semOps, so the caller does not make a system call per member.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared information of the pitch
+ *  \param team team id (1 or 2)
+ *  \param skip slot index of a member that is not woken (the calling captain), or -1
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int slotWakeTeam (int semgid, SHARED_DATA *sh, int team, int skip)
+{
+    SEMOP ops[WAKEBATCH];
+    unsigned int n = 0;
+    int slot;
+
+    for (slot = sh->team[team - 1].head; slot != -1; slot = SLOT (sh, slot).next) {
+        if (slot == skip) continue;
+        ops[n].sindex = SLOT (sh, slot).sem;
+        ops[n++].delta = 1;
+        if (n == WAKEBATCH) {
+            if (semOps (semgid, ops, n) == -1) return -1;
+            n = 0;
+        }
+    }
+    if ((n > 0) && (semOps (semgid, ops, n) == -1)) return -1;
+    return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ *  \file entitySlot.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Slots of the players and goalies of a pitch.
+ *
+ *  Every player and goalie has a slot of its own in the shared information of its pitch, with its team and a
+ *  private semaphore where it alone waits to be called, to start and to end a match. Slots are linked in the lists
+ *  of the entities waiting for a team and of the members of each team, so that a captain calls and the referee
+ *  starts and ends exactly the entities of a given team. Lists change only within the critical region of the pitch.
+ *
+ *  Defined operations:
+ *     \li resetting the slots for a new match
+ *     \li queueing an entity waiting for a team
+ *     \li forming a team out of the entities waiting longest
+ *     \li waking every member of a team.
+ */
+
+#ifndef ENTITYSLOT_H_
+#define ENTITYSLOT_H_
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Resetting the slots and lists of a pitch for a new match: no entity is waiting or has a team.
+ *
+ *  \param sh pointer to the shared information of the pitch
+ */
+extern void slotReset (SHARED_DATA *sh);
+
+/**
+ *  \brief Adding an entity at the end of a list of slots.
+ *
+ *  \param sh pointer to the shared information of the pitch
+ *  \param l pointer to the list
+ *  \param slot slot index of the entity (see PLAYERSLOTID and GOALIESLOTID)
+ */
+extern void slotEnqueue (SHARED_DATA *sh, SLOT_LIST *l, int slot);
+
+/**
+ *  \brief Forming a team: its captain and the players and goalies waiting longest for a team.
+ *
+ *  The team is recorded in the slot of every member, and the members are linked in the list of the team, the
+ *  captain first. There must be enough entities waiting.
+ *
+ *  \param sh pointer to the shared information of the pitch
+ *  \param team team id (1 or 2)
+ *  \param captain slot index of the captain
+ *  \param nPlayers number of waiting players that join the team
+ *  \param nGoalies number of waiting goalies that join the team
+ */
+extern void slotFormTeam (SHARED_DATA *sh, int team, int captain, int nPlayers, int nGoalies);
+
+/**
+ *  \brief Waking every member of a team with an <em>up</em> on its private semaphore.
+ *
+ *  The <em>ups</em> are carried out in batches of semOps, so the caller does not make a system call per member.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared information of the pitch
+ *  \param team team id (1 or 2)
+ *  \param skip slot index of a member that is not woken (the calling captain), or -1
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int slotWakeTeam (int semgid, SHARED_DATA *sh, int team, int skip);
+
+#endif /* ENTITYSLOT_H_ */
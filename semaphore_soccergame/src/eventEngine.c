@@ -0,0 +1,693 @@
+/**
+ *  \file eventEngine.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Event engine: the life cycles of all entities as state machines of a single process, in virtual time.
+ *
+ *  Each pitch has a queue of the entities ready to run at its present instant and a heap of those waiting for an
+ *  instant to come; the heap is ordered by instant and then by the order the waits were scheduled, so that the
+ *  simulation of a pitch depends on nothing but its seed. An entity blocked on a semaphore is in neither: it is the
+ *  waiter of the semaphore, which is at most one, since every semaphore of a pitch belongs to a single entity
+ *  (private semaphores, the referee's and the captain's), but for the barrier between matches, which is kept by the
+ *  count of entities that reached it.
+ *
+ *  Records are kept per pitch as the change they carry, to be rendered in the state of all entities when merged.
+ *
+ *  Defined operations:
+ *     \li running the simulation
+ *     \li describing the last run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "sharedDataSync.h"
+#include "latency.h"
+#include "pacing.h"
+#include "entitySlot.h"
+#include "taskPool.h"
+#include "eventEngine.h"
+
+/** \brief instant of the next event of a pitch that has none */
+#define  EVT_NEVER      UINT64_MAX
+
+/* points where the life cycle of an entity resumes */
+
+/** \brief reaching the barrier between two matches */
+#define  S_NEXTMATCH    0
+/** \brief arriving */
+#define  S_ARRIVE       1
+/** \brief player or goalie: constituting a team, once arrived */
+#define  S_TEAM         2
+/** \brief player or goalie: called by the captain of its team */
+#define  S_CALLED       3
+/** \brief captain: its teammates registered */
+#define  S_REGISTERED   4
+/** \brief player or goalie: waiting for the referee to start the match */
+#define  S_WAITREFEREE  5
+/** \brief player or goalie: started by the referee */
+#define  S_PLAY         6
+/** \brief referee: waiting for both teams, once arrived */
+#define  S_WAITTEAMS    7
+/** \brief referee: both teams formed */
+#define  S_START        8
+/** \brief referee: all teammates playing */
+#define  S_REFEREE      9
+/** \brief referee: ending the match, once played */
+#define  S_ENDGAME     10
+/** \brief the present match is over for the entity */
+#define  S_MATCHEND    11
+
+/**
+ *  \brief Definition of <em>virtual semaphore</em> data type.
+ */
+typedef struct {
+    /** \brief value */
+    unsigned int value;
+    /** \brief entity of the pitch blocked on the semaphore (-1 for none) */
+    int waiter;
+    /** \brief units the waiter needs */
+    unsigned int need;
+} VSEM;
+
+/**
+ *  \brief Definition of <em>entity object</em> data type.
+ */
+typedef struct {
+    /** \brief delay generator, drawing the delays of the entity programs */
+    PACER pacer;
+    /** \brief instant the present wait started */
+    uint64_t since;
+    /** \brief point where the life cycle resumes */
+    int step;
+    /** \brief protocol phase of the present wait */
+    int phase;
+    /** \brief number of matches the entity finished */
+    int match;
+    /** \brief team of the entity in the present match */
+    int team;
+} EVT_ENTITY;
+
+/**
+ *  \brief Definition of <em>timer</em> data type: an entity waiting for an instant.
+ */
+typedef struct {
+    /** \brief instant the entity resumes */
+    uint64_t t;
+    /** \brief order the wait was scheduled */
+    uint64_t seq;
+    /** \brief entity */
+    int e;
+} EVT_TIMER;
+
+/**
+ *  \brief Definition of <em>change record</em> data type.
+ */
+typedef struct {
+    /** \brief virtual time of the record */
+    uint64_t ts;
+    /** \brief entity of the pitch whose state changed (-1 when the pitch was reset for a new match) */
+    int e;
+    /** \brief new state */
+    unsigned int state;
+} EVT_RECORD;
+
+/**
+ *  \brief Definition of <em>simulated pitch</em> data type.
+ *
+ *  Each one is run by a single worker at a time; pitches of different workers start each a cache line of their own.
+ */
+typedef struct {
+    /** \brief shared information of the pitch */
+    _Alignas (CACHELINE) SHARED_DATA *sh;
+    /** \brief number of entities */
+    int n;
+    /** \brief entity objects: players, goalies and the referee, as in the state of the pitch */
+    EVT_ENTITY *ent;
+    /** \brief entities ready to run at the present instant (a circular queue of n) */
+    int *ready;
+    /** \brief first entity of the queue */
+    int head;
+    /** \brief number of entities in the queue */
+    int nReady;
+    /** \brief entities waiting for an instant (a heap of n) */
+    EVT_TIMER *timer;
+    /** \brief number of entities in the heap */
+    int nTimers;
+    /** \brief number of waits scheduled */
+    uint64_t nScheduled;
+    /** \brief present instant */
+    uint64_t now;
+    /** \brief instant of the next event, once a round is over (EVT_NEVER when there is none) */
+    uint64_t next;
+    /** \brief records not merged yet, in the order they were made */
+    EVT_RECORD *rec;
+    /** \brief number of records */
+    unsigned int nRec;
+    /** \brief room for records */
+    unsigned int maxRec;
+    /** \brief records already merged */
+    unsigned int merged;
+    /** \brief number of entities whose life cycle ended */
+    int ended;
+    /** \brief number of state changes made */
+    unsigned long changes;
+} EVT_PITCH;
+
+/** \brief region being simulated */
+static SHARED_REGION *shr;
+
+/** \brief semaphores of the set, by index */
+static VSEM *vsem;
+
+/** \brief simulated pitches */
+static EVT_PITCH *pitch;
+
+/** \brief records are kept, to be written or checked */
+static bool keep;
+
+/** \brief end of the virtual time pitches may run to in the present round */
+static uint64_t horizon;
+
+/** \brief figures of the last run, for evtReport */
+static unsigned int nWorkersRun;
+static unsigned long changes, rounds, steals;
+static uint64_t virtualNs, wallNs;
+
+/* internal functions */
+
+static uint64_t nowNs (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+static void *allocate (size_t size)
+{
+    void *p;
+
+    if ((p = malloc (size)) == NULL) {
+        perror ("error on allocating the event engine");
+        exit (EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* kind of entity, as the latency stats are kept */
+static int kindOf (EVT_PITCH *p, int e)
+{
+    if (e < p->sh->fSt.nPlayers) return LAT_PLAYERS;
+    return (e < p->n - 1) ? LAT_GOALIES : LAT_REFEREES;
+}
+
+static bool earlier (EVT_TIMER *a, EVT_TIMER *b)
+{
+    return (a->t < b->t) || ((a->t == b->t) && (a->seq < b->seq));
+}
+
+static void ready (EVT_PITCH *p, int e)
+{
+    p->ready[(p->head + p->nReady++) % p->n] = e;
+}
+
+/* the entity resumes after a delay, of the present instant when there is none */
+static void sleepFor (EVT_PITCH *p, int e, uint64_t ns, int step)
+{
+    EVT_TIMER tm = { p->now + ns, p->nScheduled++, e };
+    int i, up;
+
+    p->ent[e].step = step;
+    if (ns == 0) {
+        ready (p, e);
+        return;
+    }
+    for (i = p->nTimers++; i > 0; i = up) {
+        up = (i - 1) / 2;
+        if (!earlier (&tm, &p->timer[up])) break;
+        p->timer[i] = p->timer[up];
+    }
+    p->timer[i] = tm;
+}
+
+static int popTimer (EVT_PITCH *p)
+{
+    EVT_TIMER last = p->timer[--p->nTimers];
+    int e = p->timer[0].e,
+        i = 0, c;
+
+    while ((c = 2 * i + 1) < p->nTimers) {
+        if ((c + 1 < p->nTimers) && earlier (&p->timer[c + 1], &p->timer[c])) c += 1;
+        if (!earlier (&p->timer[c], &last)) break;
+        p->timer[i] = p->timer[c];
+        i = c;
+    }
+    p->timer[i] = last;
+    return e;
+}
+
+/* the change is made in the state of the pitch and kept as a record */
+static void setState (EVT_PITCH *p, int e, unsigned int state)
+{
+    p->sh->fSt.st.stat[e] = state;
+    p->changes += 1;
+    if (!keep) return;
+    if (p->nRec == p->maxRec) {
+        p->maxRec *= 2;
+        if ((p->rec = realloc (p->rec, p->maxRec * sizeof (EVT_RECORD))) == NULL) {
+            perror ("error on allocating the event engine");
+            exit (EXIT_FAILURE);
+        }
+    }
+    p->rec[p->nRec++] = (EVT_RECORD) { p->now, e, state };
+}
+
+/* down by n units: false when the entity blocks, to resume at step once it is woken */
+static bool down (EVT_PITCH *p, int e, unsigned int sem, unsigned int n, int phase, int step)
+{
+    VSEM *s = &vsem[sem];
+    EVT_ENTITY *en = &p->ent[e];
+
+    en->step = step;
+    if (s->value >= n) {
+        s->value -= n;
+        latRecord (&p->sh->lat[kindOf (p, e)], phase, 0);
+        return true;
+    }
+    s->waiter = e;
+    s->need = n;
+    en->since = p->now;
+    en->phase = phase;
+    return false;
+}
+
+static void up (EVT_PITCH *p, unsigned int sem, unsigned int n)
+{
+    VSEM *s = &vsem[sem];
+    int e = s->waiter;
+
+    s->value += n;
+    if ((e >= 0) && (s->value >= s->need)) {
+        s->value -= s->need;
+        s->waiter = -1;
+        latRecord (&p->sh->lat[kindOf (p, e)], p->ent[e].phase, p->now - p->ent[e].since);
+        ready (p, e);
+    }
+}
+
+/* an up on the private semaphore of every member of a team but one (-1 for none) */
+static void wakeTeam (EVT_PITCH *p, int team, int skip)
+{
+    int slot;
+
+    for (slot = p->sh->team[team - 1].head; slot != -1; slot = SLOT (p->sh, slot).next) {
+        if (slot != skip) up (p, SLOT (p->sh, slot).sem, 1);
+    }
+}
+
+/* the barrier between matches: false while the entity waits for the others of its pitch; the last one resets the
+   pitch for the next match, as resetMatch of the generator, and lets them all through */
+static bool nextMatch (EVT_PITCH *p, int e)
+{
+    FULL_STAT *f = &p->sh->fSt;
+    int i;
+
+    p->ent[e].step = S_ARRIVE;
+    p->ent[e].since = p->now;
+    if (++f->matchDone < p->n) return false;
+
+    f->matchDone = 0;
+    f->match++;
+    for (i = 0; i < p->n; i++) {
+        f->st.stat[i] = (i < p->n - 1) ? ARRIVING : ARRIVINGR;
+    }
+    atomic_store_explicit (&f->playersArrived, 0, memory_order_relaxed);
+    atomic_store_explicit (&f->goaliesArrived, 0, memory_order_relaxed);
+    f->playersFree = 0;
+    f->goaliesFree = 0;
+    f->teamId = 1;
+    slotReset (p->sh);
+    if (keep) {
+        setState (p, 0, ARRIVING);
+        p->rec[p->nRec - 1].e = -1;
+        p->changes -= 1;
+    }
+    for (i = 0; i < p->n; i++) {
+        latRecord (&p->sh->lat[kindOf (p, i)], PH_NEXTMATCH, p->now - p->ent[i].since);
+        if (i != e) ready (p, i);
+    }
+    return true;
+}
+
+/* life cycle of a player or goalie (see semSharedMemPlayer.c and semSharedMemGoalie.c), until it waits */
+static void runPlayer (EVT_PITCH *p, int e)
+{
+    SHARED_DATA *sh = p->sh;
+    FULL_STAT *f = &sh->fSt;
+    EVT_ENTITY *en = &p->ent[e];
+    bool goalie = (e >= f->nPlayers);
+    int ticket;
+
+    for (;;) {
+        switch (en->step) {
+            case S_NEXTMATCH:
+                if (!nextMatch (p, e)) return;
+                break;
+            case S_ARRIVE:
+                setState (p, e, ARRIVING);
+                sleepFor (p, e, goalie ? pacerDelay (&en->pacer, 60.0, 200.0) : pacerDelay (&en->pacer, 50.0, 200.0),
+                          S_TEAM);
+                return;
+            case S_TEAM:
+                ticket = atomic_fetch_add_explicit (goalie ? &f->goaliesArrived : &f->playersArrived, 1,
+                                                    memory_order_relaxed);
+                if (ticket >= 2 * (goalie ? f->nTeamGoalies : f->nTeamPlayers)) {
+                    setState (p, e, LATE);
+                    en->step = S_MATCHEND;
+                    break;
+                }
+                if (goalie) f->goaliesFree++;
+                else f->playersFree++;
+                if ((f->playersFree >= f->nTeamPlayers) && (f->goaliesFree >= f->nTeamGoalies)) {
+                    f->playersFree -= f->nTeamPlayers;
+                    f->goaliesFree -= f->nTeamGoalies;
+                    en->team = f->teamId++;
+                    slotFormTeam (sh, en->team, e, f->nTeamPlayers - !goalie, f->nTeamGoalies - goalie);
+                    setState (p, e, FORMING_TEAM);
+                    wakeTeam (p, en->team, e);
+                    if (!down (p, e, sh->playerRegistered[en->team - 1],
+                               (unsigned int) (f->nTeamPlayers + f->nTeamGoalies - 1), PH_REGISTERED, S_REGISTERED))
+                        return;
+                }
+                else {
+                    slotEnqueue (sh, goalie ? &sh->goaliesWaiting : &sh->playersWaiting, e);
+                    setState (p, e, WAITING_TEAM);
+                    if (!down (p, e, SLOT (sh, e).sem, 1, PH_WAITTEAM, S_CALLED)) return;
+                }
+                break;
+            case S_CALLED:
+                en->team = SLOT (sh, e).team;
+                up (p, sh->playerRegistered[en->team - 1], 1);
+                en->step = S_WAITREFEREE;
+                break;
+            case S_REGISTERED:
+                up (p, sh->refereeWaitTeams, 1);
+                en->step = S_WAITREFEREE;
+                break;
+            case S_WAITREFEREE:
+                setState (p, e, (en->team == 1) ? WAITING_START_1 : WAITING_START_2);
+                if (!down (p, e, SLOT (sh, e).sem, 1, PH_WAITREFEREE, S_PLAY)) return;
+                break;
+            case S_PLAY:
+                setState (p, e, (en->team == 1) ? PLAYING_1 : PLAYING_2);
+                up (p, sh->playing, 1);
+                if (!down (p, e, SLOT (sh, e).sem, 1, PH_WAITEND, S_MATCHEND)) return;
+                break;
+            case S_MATCHEND:
+                if (++en->match == f->nMatches) {
+                    p->ended += 1;
+                    return;
+                }
+                en->step = S_NEXTMATCH;
+                break;
+        }
+    }
+}
+
+/* life cycle of the referee (see semSharedMemReferee.c), until it waits */
+static void runReferee (EVT_PITCH *p, int e)
+{
+    SHARED_DATA *sh = p->sh;
+    FULL_STAT *f = &sh->fSt;
+    EVT_ENTITY *en = &p->ent[e];
+
+    for (;;) {
+        switch (en->step) {
+            case S_NEXTMATCH:
+                if (!nextMatch (p, e)) return;
+                break;
+            case S_ARRIVE:
+                setState (p, e, ARRIVINGR);
+                sleepFor (p, e, pacerDelay (&en->pacer, 10.0, 100.0), S_WAITTEAMS);
+                return;
+            case S_WAITTEAMS:
+                setState (p, e, WAITING_TEAMS);
+                if (!down (p, e, sh->refereeWaitTeams, 2, PH_WAITTEAMS, S_START)) return;
+                break;
+            case S_START:
+                setState (p, e, STARTING_GAME);
+                wakeTeam (p, 1, -1);
+                wakeTeam (p, 2, -1);
+                if (!down (p, e, sh->playing, (unsigned int) (2 * (f->nTeamGoalies + f->nTeamPlayers)), PH_PLAYING,
+                           S_REFEREE)) return;
+                break;
+            case S_REFEREE:
+                setState (p, e, REFEREEING);
+                sleepFor (p, e, pacerDelay (&en->pacer, 900.0, 100.0), S_ENDGAME);
+                return;
+            case S_ENDGAME:
+                setState (p, e, ENDING_GAME);
+                wakeTeam (p, 1, -1);
+                wakeTeam (p, 2, -1);
+                en->step = S_MATCHEND;
+                break;
+            case S_MATCHEND:
+                if (++en->match == f->nMatches) {
+                    p->ended += 1;
+                    return;
+                }
+                en->step = S_NEXTMATCH;
+                break;
+        }
+    }
+}
+
+/* task of a round: the events of a pitch up to the horizon, within the budget of steps */
+static void runPitch (void *ctx, unsigned int k)
+{
+    EVT_PITCH *p = &pitch[k];
+    unsigned int budget = EVT_BUDGET;
+    int e;
+
+    while (budget > 0) {
+        if (p->nReady == 0) {
+            if ((p->nTimers == 0) || (p->timer[0].t >= horizon)) break;
+            p->now = p->timer[0].t;
+            ready (p, popTimer (p));
+        }
+        e = p->ready[p->head];
+        p->head = (p->head + 1) % p->n;
+        p->nReady -= 1;
+        if (e == p->n - 1) runReferee (p, e);
+        else runPlayer (p, e);
+        budget -= 1;
+    }
+    p->next = (p->nReady > 0) ? p->now : ((p->nTimers > 0) ? p->timer[0].t : EVT_NEVER);
+}
+
+/* index of entity e of pitch k in the state of all entities */
+static unsigned int globalEntity (unsigned int k, int e)
+{
+    FULL_STAT *all = &shr->fSt;
+    int K = all->nPitches,
+        nP = pitch[k].sh->fSt.nPlayers,
+        nG = pitch[k].sh->fSt.nGoalies;
+
+    if (e < nP) return (unsigned int) PITCHENTITY (e, K, (int) k);
+    if (e < nP + nG) return (unsigned int) (all->nPlayers + PITCHENTITY (e - nP, K, (int) k));
+    return (unsigned int) (all->nPlayers + all->nGoalies) + k;
+}
+
+static bool mergedBefore (unsigned int a, unsigned int b)
+{
+    uint64_t ta = pitch[a].rec[pitch[a].merged].ts,
+             tb = pitch[b].rec[pitch[b].merged].ts;
+
+    return (ta < tb) || ((ta == tb) && (a < b));
+}
+
+/* merging the records up to an instant, in the order of their virtual time and then of their pitch */
+static void mergeRecords (char nFic[], uint64_t upto, bool log, PROTO_CHECK *chk, uint64_t origin,
+                          unsigned char *st, unsigned int *heap)
+{
+    FULL_STAT *all = &shr->fSt;
+    unsigned int nHeap = 0, k, i, c, top, K = shr->nPitches;
+    int e;
+
+    /* heap of the pitches with records to merge, by their first one */
+    for (k = 0; k < K; k++) {
+        if ((pitch[k].merged == pitch[k].nRec) || (pitch[k].rec[pitch[k].merged].ts > upto)) continue;
+        for (i = nHeap++; (i > 0) && mergedBefore (k, heap[(i - 1) / 2]); i = (i - 1) / 2) {
+            heap[i] = heap[(i - 1) / 2];
+        }
+        heap[i] = k;
+    }
+
+    while (nHeap > 0) {
+        EVT_PITCH *p = &pitch[top = heap[0]];
+        EVT_RECORD *r = &p->rec[p->merged++];
+
+        if (r->e >= 0) {
+            all->st.stat[globalEntity (top, r->e)] = r->state;
+            st[globalEntity (top, r->e)] = (unsigned char) r->state;
+        }
+        else for (e = 0; e < p->n; e++) {
+            all->st.stat[globalEntity (top, e)] = (e < p->n - 1) ? ARRIVING : ARRIVINGR;
+            st[globalEntity (top, e)] = (unsigned char) all->st.stat[globalEntity (top, e)];
+        }
+        if (log) saveStateAt (nFic, all, origin + r->ts);
+        else if (chk != NULL) chkRecord (chk, st);
+
+        /* the pitch stays on top while its next record is still the earliest */
+        if ((p->merged == p->nRec) || (p->rec[p->merged].ts > upto)) top = heap[--nHeap];
+        for (i = 0; (c = 2 * i + 1) < nHeap; i = c) {
+            if ((c + 1 < nHeap) && mergedBefore (heap[c + 1], heap[c])) c += 1;
+            if (!mergedBefore (heap[c], top)) break;
+            heap[i] = heap[c];
+        }
+        if (nHeap > 0) heap[i] = top;
+    }
+
+    /* the records left wait for the next merge */
+    for (k = 0; k < K; k++) {
+        EVT_PITCH *p = &pitch[k];
+
+        memmove (p->rec, p->rec + p->merged, (p->nRec - p->merged) * sizeof (EVT_RECORD));
+        p->nRec -= p->merged;
+        p->merged = 0;
+    }
+}
+
+/* external functions */
+
+/**
+ *  \brief Running the simulation of a region laid out and initialized by the generator, until every entity ended.
+ *
+ *  After each round the pitches that have events left are run again, from the earliest instant of their next events;
+ *  records up to that instant are merged, since no later round may make an earlier one.
+ *
+ *  \param nFic name of the logging file
+ *  \param region pointer to the region, in private memory
+ *  \param nWorkers number of worker threads, the calling thread included
+ *  \param log the records are written in the log
+ *  \param chk checker of the records when they are not written (NULL for none)
+ */
+void evtRun (char nFic[], SHARED_REGION *region, unsigned int nWorkers, bool log, PROTO_CHECK *chk)
+{
+    FULL_STAT *all = &region->fSt;
+    unsigned int K = region->nPitches,
+                 nSems = K * SEM_NU + 1 + (unsigned int) (all->nPlayers + all->nGoalies),
+                 k, n, i;
+    unsigned int *task, *heap;
+    unsigned char *st;
+    uint64_t origin = nowNs (),
+             earliest = 0;
+    TASK_POOL pool;
+    int e;
+
+    shr = region;
+    keep = log || (chk != NULL);
+    vsem = allocate (nSems * sizeof (VSEM));
+    for (i = 0; i < nSems; i++) {
+        vsem[i] = (VSEM) { 0, -1, 0 };
+    }
+    task = allocate (K * sizeof (unsigned int));
+    heap = allocate (K * sizeof (unsigned int));
+    st = allocate (all->st.nEntities);
+    for (i = 0; i < all->st.nEntities; i++) {
+        st[i] = (unsigned char) all->st.stat[i];
+    }
+    if ((pitch = aligned_alloc (CACHELINE, K * sizeof (EVT_PITCH))) == NULL) {
+        perror ("error on allocating the event engine");
+        exit (EXIT_FAILURE);
+    }
+
+    /* every entity starts arriving, with the delay generator its program would seed */
+    for (k = 0; k < K; k++) {
+        EVT_PITCH *p = &pitch[k];
+
+        memset (p, 0, sizeof (EVT_PITCH));
+        p->sh = PITCH (shr, k);
+        p->n = (int) p->sh->fSt.st.nEntities;
+        p->ent = allocate ((size_t) p->n * sizeof (EVT_ENTITY));
+        p->ready = allocate ((size_t) p->n * sizeof (int));
+        p->timer = allocate ((size_t) p->n * sizeof (EVT_TIMER));
+        p->maxRec = 16 * (unsigned int) p->n;
+        p->rec = allocate (p->maxRec * sizeof (EVT_RECORD));
+        for (e = 0; e < p->n; e++) {
+            pacerInit (&p->ent[e].pacer, all->seed, all->timeScale, globalEntity (k, e));
+            p->ent[e].step = S_ARRIVE;
+            p->ent[e].match = 0;
+            p->ent[e].team = 0;
+            ready (p, e);
+        }
+        p->next = 0;
+    }
+    if (!log && (chk != NULL)) chkRecord (chk, st);
+
+    nWorkersRun = nWorkers;
+    rounds = 0;
+    poolInit (&pool, nWorkers, K, runPitch, NULL);
+    do {
+        horizon = (earliest > EVT_NEVER - EVT_WINDOW) ? EVT_NEVER : earliest + EVT_WINDOW;
+        for (k = 0, n = 0; k < K; k++) {
+            if (pitch[k].next != EVT_NEVER) task[n++] = k;
+        }
+        poolRound (&pool, task, n);
+        rounds += 1;
+
+        earliest = EVT_NEVER;
+        for (i = 0; i < n; i++) {
+            EVT_PITCH *p = &pitch[task[i]];
+
+            if ((p->next == EVT_NEVER) && (p->ended < p->n)) {
+                fprintf (stderr, "pitch %u is deadlocked in match %d (%d of %d entities ended)\n", task[i],
+                         p->sh->fSt.match + 1, p->ended, p->n);
+                exit (EXIT_FAILURE);
+            }
+            if (p->next < earliest) earliest = p->next;
+        }
+        if (keep) mergeRecords (nFic, earliest, log, chk, origin, st, heap);
+    } while (earliest != EVT_NEVER);
+    steals = poolDestroy (&pool);
+    if (log) closeLog ();
+    wallNs = nowNs () - origin;
+
+    changes = 0;
+    virtualNs = 0;
+    for (k = 0; k < K; k++) {
+        changes += pitch[k].changes;
+        if (pitch[k].now > virtualNs) virtualNs = pitch[k].now;
+        free (pitch[k].ent);
+        free (pitch[k].ready);
+        free (pitch[k].timer);
+        free (pitch[k].rec);
+    }
+    free (pitch);
+    free (vsem);
+    free (task);
+    free (heap);
+    free (st);
+}
+
+/**
+ *  \brief Printing a line describing the last run: workers, state changes and their rate, rounds, steals and virtual
+ *         time simulated.
+ *
+ *  \param fp stream where the line is printed
+ */
+void evtReport (FILE *fp)
+{
+    fprintf (fp, "event engine: %u workers, %lu state changes in %.3f ms (%.0f/s), %lu rounds, %lu steals, "
+             "%.3f ms of virtual time\n", nWorkersRun, changes, (double) wallNs / 1e6,
+             (wallNs > 0) ? (double) changes * 1e9 / (double) wallNs : 0.0, rounds, steals, (double) virtualNs / 1e6);
+}
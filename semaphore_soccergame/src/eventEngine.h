@@ -0,0 +1,68 @@
+/**
+ *  \file eventEngine.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Event engine: the life cycles of all entities as state machines of a single process, in virtual time.
+ *
+ *  For rosters far beyond a process or a thread per entity (option -e of the generator). Every entity is an object
+ *  that resumes its life cycle where it last waited, and runs it until it waits again: on a semaphore, which is the
+ *  semaphore of the set with the same index as seen by a pitch simulated on its own, or for a delay of <tt>pace</tt>,
+ *  which does not sleep but wakes the entity at a later instant of the virtual time of its pitch. The life cycles
+ *  are those of the entity programs, over the same shared information (counters, slots and team lists, latency
+ *  stats) and with the same delays for the same seed; the critical regions never wait, since an entity runs alone
+ *  in its pitch until it waits, and the barrier between matches is opened by the last entity of the pitch to reach it.
+ *
+ *  Pitches are independent, so they are simulated in parallel by a pool of worker threads (see taskPool.h), in
+ *  rounds: in each round every pitch runs its events up to a horizon of virtual time, or up to a budget of steps.
+ *  Between rounds the records of the pitches are merged in the order of their virtual time (pitch by pitch when
+ *  it is the same) and written in the log with the format of the other engines, with timestamps counted from the
+ *  start of the simulation; the records of a round that may still be preceded by those of a later one are kept
+ *  for the next merge. The log is therefore the same for any number of workers and stealing order.
+ *
+ *  Latencies are waits in virtual time; the phases of the critical region and of the records have no samples.
+ *
+ *  Defined operations:
+ *     \li running the simulation
+ *     \li describing the last run.
+ */
+
+#ifndef EVENTENGINE_H_
+#define EVENTENGINE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "sharedDataSync.h"
+#include "protoCheck.h"
+
+/** \brief largest number of steps (resumptions of an entity) of a pitch in a round */
+#define  EVT_BUDGET        4096
+
+/** \brief span of virtual time a pitch may run ahead of the earliest pitch in a round (in ns) */
+#define  EVT_WINDOW        10000000u
+
+/**
+ *  \brief Running the simulation of a region laid out and initialized by the generator, until every entity ended.
+ *
+ *  The initial record of the log must have been written. With a log, the records are written in batches, which
+ *  are all in the file on return; without one, they are only checked, when there is a checker.
+ *
+ *  \param nFic name of the logging file
+ *  \param shr pointer to the region, in private memory
+ *  \param nWorkers number of worker threads, the calling thread included
+ *  \param log the records are written in the log
+ *  \param chk checker of the records when they are not written (NULL for none), since those written are checked
+ *             as the log is told (see checkLog)
+ */
+extern void evtRun (char nFic[], SHARED_REGION *shr, unsigned int nWorkers, bool log, PROTO_CHECK *chk);
+
+/**
+ *  \brief Printing a line describing the last run: workers, state changes and their rate, rounds, steals and virtual
+ *         time simulated.
+ *
+ *  \param fp stream where the line is printed
+ */
+extern void evtReport (FILE *fp);
+
+#endif /* EVENTENGINE_H_ */
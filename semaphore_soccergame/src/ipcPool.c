@@ -0,0 +1,104 @@
+/**
+ *  \file ipcPool.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Generations of the runs that share the IPC pool.
+ *
+ *  The process keeps its generation and the location of the generation of its region. Every check is a relaxed
+ *  load of the latter: it only changes when a new run starts, and from then on the process is stale for good.
+ *
+ *  Defined operations:
+ *     \li laying out a region of the pool for a new generation
+ *     \li joining the generation of the region
+ *     \li telling whether the process is stale
+ *     \li ending a stale process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "ipcPool.h"
+
+/** \brief environment variable where the generator exports the generation of the run */
+#define  ENV_GENERATION    "SOCCERGAME_GENERATION"
+
+/** \brief generation of the region the process is attached to (NULL outside of the pool) */
+static const atomic_uint *present = NULL;
+
+/** \brief generation of the process */
+static unsigned int mine = 0;
+
+/* external functions */
+
+/**
+ *  \brief Laying out a region of the pool for a new generation: it is zeroed, as a new region is, and its generation
+ *         is the next one, which is exported to the entity processes launched from then on.
+ *
+ *  \param shr pointer to the shared region
+ *  \param size size of the region (in bytes)
+ *
+ *  \return generation of the run
+ */
+unsigned int ipcRenew (SHARED_REGION *shr, size_t size)
+{
+    unsigned int generation = atomic_load (&shr->generation) + 1;
+    char value[12];
+
+    if (generation == 0) generation = 1;                                          /* 0 stands for no generation */
+    atomic_store (&shr->generation, generation);
+    memset (shr, 0, offsetof (SHARED_REGION, generation));                     /* all but the generation is zeroed */
+    memset ((char *) shr + offsetof (SHARED_REGION, generation) + sizeof (atomic_uint), 0,
+            size - offsetof (SHARED_REGION, generation) - sizeof (atomic_uint));
+
+    snprintf (value, sizeof (value), "%u", generation);
+    if (setenv (ENV_GENERATION, value, 1) == -1) {
+        perror ("error on exporting the generation of the run");
+        exit (EXIT_FAILURE);
+    }
+    return generation;
+}
+
+/**
+ *  \brief Joining the generation of the region, with the generation exported by the generator (none when it was not
+ *         exported); a process of another generation ends at once.
+ *
+ *  \param shr pointer to the shared region
+ */
+void ipcJoin (SHARED_REGION *shr)
+{
+    char *value = getenv (ENV_GENERATION),
+         *tinp;
+
+    if ((value == NULL) || (value[0] == '\0')) return;
+    mine = (unsigned int) strtoul (value, &tinp, 10);
+    if ((*tinp != '\0') || (mine == 0)) {
+        fprintf (stderr, "Generation of the run \"%s\" is wrong!\n", value);
+        exit (EXIT_FAILURE);
+    }
+    present = &shr->generation;
+    if (ipcStale ()) ipcLeave ();
+}
+
+/**
+ *  \brief Telling whether the process is stale: the region was laid out for a later generation than its own.
+ *
+ *  \return true, when the process must end
+ */
+bool ipcStale (void)
+{
+    return (present != NULL) && (atomic_load_explicit (present, memory_order_relaxed) != mine);
+}
+
+/**
+ *  \brief Ending a stale process, with EXIT_FAILURE.
+ */
+void ipcLeave (void)
+{
+    fprintf (stderr, "stale entity of generation %u: the region is now of generation %u\n", mine,
+             atomic_load_explicit (present, memory_order_relaxed));
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,68 @@
+/**
+ *  \file ipcPool.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Generations of the runs that share the IPC pool.
+ *
+ *  With option -u the generator keeps its shared region and semaphore set once it ends, and the next generator with
+ *  the same key resets them in place instead of creating new ones (see shmemReuse and semReuse), so that a batch of
+ *  runs pays for their creation once, and a run that crashed leaves nothing that makes the next one fail. Entity
+ *  processes left by a previous run may still be attached to them, though: blocked on a semaphore, sleeping in
+ *  <tt>pace</tt> or waiting for the start of operations.
+ *
+ *  Each run of the pool is a new generation, written in the shared region and exported by the generator in the
+ *  environment variable <tt>SOCCERGAME_GENERATION</tt>, inherited by the entity processes it launches. An entity
+ *  that finds the region of another generation, as it connects, once a wait returns or once a pause is over, is
+ *  stale: it gives back the units it took, if any, and ends without touching the region, so that it cannot corrupt
+ *  the present run. Entities outside of the pool, and entity threads, have no generation and are never stale.
+ *
+ *  Defined operations:
+ *     \li laying out a region of the pool for a new generation
+ *     \li joining the generation of the region
+ *     \li telling whether the process is stale
+ *     \li ending a stale process.
+ */
+
+#ifndef IPCPOOL_H_
+#define IPCPOOL_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Laying out a region of the pool for a new generation: it is zeroed, as a new region is, and its generation
+ *         is the next one, which is exported to the entity processes launched from then on.
+ *
+ *  The generation goes up in the region before it is zeroed, so that stale entities never see it go back.
+ *
+ *  \param shr pointer to the shared region
+ *  \param size size of the region (in bytes)
+ *
+ *  \return generation of the run
+ */
+extern unsigned int ipcRenew (SHARED_REGION *shr, size_t size);
+
+/**
+ *  \brief Joining the generation of the region, with the generation exported by the generator (none when it was not
+ *         exported); a process of another generation ends at once.
+ *
+ *  \param shr pointer to the shared region
+ */
+extern void ipcJoin (SHARED_REGION *shr);
+
+/**
+ *  \brief Telling whether the process is stale: the region was laid out for a later generation than its own.
+ *
+ *  \return true, when the process must end
+ */
+extern bool ipcStale (void);
+
+/**
+ *  \brief Ending a stale process, with EXIT_FAILURE.
+ */
+extern void ipcLeave (void);
+
+#endif /* IPCPOOL_H_ */
@@ -0,0 +1,442 @@
+/**
+ *  \file latency.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Timing of the phases of the protocol of the intervening entities.
+ *
+ *  Defined operations:
+ *     \li timed down operations on a semaphore
+ *     \li timed state snapshot
+ *     \li merging of histograms, printing of the summary
+ *     \li loading and saving histograms in a machine-readable file.
+ *
+ *  Samples are added with relaxed atomic operations: the histograms are only read once all entities have ended.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "probDataStruct.h"
+#include "logging.h"
+#include "semaphore.h"
+#include "latency.h"
+#include "ipcPool.h"
+
+/** \brief first line of a histogram file, up to its version */
+#define  LAT_MAGIC        "# SoccerGame latency histograms v"
+/** \brief version of the histogram files written: 2 adds the spin counts, which version 1 files do without */
+#define  LAT_VERSION      2
+
+/** \brief names of the protocol phases, as printed in the summary and in histogram files */
+static const char *phaseName[NUMPHASES] = {
+    "mutex", "waitTeam", "registered", "waitReferee", "waitEnd", "waitTeams", "playing", "nextMatch", "saveState"
+};
+
+/** \brief phases whose waits spin before blocking: the handoffs between entities, and the critical region; the
+           waits between matches last as long as the slowest pitch entity, which is not worth spinning for */
+static const bool spinPhase[NUMPHASES] = {
+    [PH_MUTEX] = true, [PH_WAITTEAM] = true, [PH_REGISTERED] = true, [PH_WAITREFEREE] = true, [PH_WAITEND] = true,
+    [PH_WAITTEAMS] = true, [PH_PLAYING] = true
+};
+
+/** \brief names of the kinds of entities in histogram files */
+static const char *kindName[LAT_KINDS] = { "players", "goalies", "referees" };
+
+/* internal functions */
+
+static uint64_t now(void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+static int bucketOf(uint64_t ns)
+{
+    int msb, e;
+
+    if (ns < (1u << LAT_SUBBITS)) return (int) ns;
+    msb = 63 - __builtin_clzll (ns);
+    if (msb >= LAT_MAXBITS) return LAT_BUCKETS - 1;
+    e = msb - (LAT_SUBBITS - 1);
+    return (e << (LAT_SUBBITS - 1)) + (int) (ns >> e);
+}
+
+static uint64_t bucketTop(int b)
+{
+    int e = (b >> (LAT_SUBBITS - 1)) - 1;
+    uint64_t m;
+
+    if (e <= 0) return (uint64_t) b;
+    m = (uint64_t) (b - (e << (LAT_SUBBITS - 1)));
+    return ((m + 1) << e) - 1;
+}
+
+static void addMin(_Atomic uint64_t *v, uint64_t x)
+{
+    uint64_t old = atomic_load_explicit (v, memory_order_relaxed);
+
+    while ((x < old) && !atomic_compare_exchange_weak_explicit (v, &old, x, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static void addMax(_Atomic uint64_t *v, uint64_t x)
+{
+    uint64_t old = atomic_load_explicit (v, memory_order_relaxed);
+
+    while ((x > old) && !atomic_compare_exchange_weak_explicit (v, &old, x, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static void mergeHist(LAT_HIST *d, uint64_t count, uint64_t sum, uint64_t min, uint64_t max)
+{
+    atomic_fetch_add_explicit (&d->count, count, memory_order_relaxed);
+    atomic_fetch_add_explicit (&d->sum, sum, memory_order_relaxed);
+    addMin (&d->min, min);
+    addMax (&d->max, max);
+}
+
+static void mergeSpin(LAT_HIST *d, uint64_t spun, uint64_t slept)
+{
+    atomic_fetch_add_explicit (&d->spun, spun, memory_order_relaxed);
+    atomic_fetch_add_explicit (&d->slept, slept, memory_order_relaxed);
+}
+
+/* a down which spins when the phase does and there is a budget, counting how the waits that had to wait ended */
+static int timedDown(LAT_STATS *st, int phase, int semgid, unsigned int sindex, unsigned int n)
+{
+    uint64_t t0 = now ();
+    int ret;
+
+    if ((st->spin == 0) || !spinPhase[phase]) {
+        ret = (n == 1) ? semDown (semgid, sindex) : semDownN (semgid, sindex, n);
+    }
+    else if ((ret = semDownSpin (semgid, sindex, n, st->spin)) != -1) {
+        if (ret != SEM_TAKEN) mergeSpin (&st->phase[phase], ret == SEM_SPUN, ret == SEM_SLEPT);
+        ret = 0;
+    }
+    latRecord (st, phase, now () - t0);
+
+    /* a stale entity woken by an up of a later run gives the units back to the entity they were meant for */
+    if ((ret == 0) && ipcStale ()) {
+        semUpN (semgid, sindex, n);
+        ipcLeave ();
+    }
+    return ret;
+}
+
+/* external functions */
+
+/**
+ *  \brief Initialization of latency stats, with no samples and no spinning.
+ *
+ *  \param st pointer to the latency stats
+ */
+void latInit (LAT_STATS *st)
+{
+    int p, b;
+
+    for (p = 0; p < NUMPHASES; p++) {
+        LAT_HIST *h = &st->phase[p];
+
+        atomic_init (&h->count, 0);
+        atomic_init (&h->sum, 0);
+        atomic_init (&h->min, UINT64_MAX);
+        atomic_init (&h->max, 0);
+        atomic_init (&h->spun, 0);
+        atomic_init (&h->slept, 0);
+        for (b = 0; b < LAT_BUCKETS; b++) {
+            atomic_init (&h->bucket[b], 0);
+        }
+    }
+    st->spin = 0;
+}
+
+/**
+ *  \brief Adding a sample to a phase; may be called concurrently by several entities.
+ *
+ *  \param st pointer to the latency stats
+ *  \param phase protocol phase
+ *  \param ns duration of the sample, in ns
+ */
+void latRecord (LAT_STATS *st, int phase, uint64_t ns)
+{
+    LAT_HIST *h = &st->phase[phase];
+
+    mergeHist (h, 1, ns, ns, ns);
+    atomic_fetch_add_explicit (&h->bucket[bucketOf (ns)], 1, memory_order_relaxed);
+}
+
+/**
+ *  \brief Timed <em>down</em> operation on a semaphore of the set, spinning before blocking in the phases that spin.
+ *
+ *  \param st pointer to the latency stats
+ *  \param phase protocol phase the wait belongs to
+ *  \param semgid semaphore set identifier
+ *  \param sindex semaphore index within the set
+ *
+ *  \return the value returned by <tt>semDown</tt>
+ */
+int latDown (LAT_STATS *st, int phase, int semgid, unsigned int sindex)
+{
+    return timedDown (st, phase, semgid, sindex, 1);
+}
+
+/**
+ *  \brief Timed <em>down</em> by <tt>n</tt> units of a semaphore of the set, spinning before blocking in the phases
+ *  that spin.
+ *
+ *  \param st pointer to the latency stats
+ *  \param phase protocol phase the wait belongs to
+ *  \param semgid semaphore set identifier
+ *  \param sindex semaphore index within the set
+ *  \param n number of units
+ *
+ *  \return the value returned by <tt>semDownN</tt>
+ */
+int latDownN (LAT_STATS *st, int phase, int semgid, unsigned int sindex, unsigned int n)
+{
+    return timedDown (st, phase, semgid, sindex, n);
+}
+
+/**
+ *  \brief Timed snapshot of the present full state (see <tt>snapshotState</tt>), counted in PH_SAVESTATE.
+ *
+ *  Only the part done inside the critical region is timed: with the log ring, <tt>saveSnapshot</tt> has
+ *  nothing left to do.
+ *
+ *  \param st pointer to the latency stats
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+void latSnapshot (LAT_STATS *st, char nFic[], FULL_STAT *p_fSt, STATE_SNAPSHOT *snap)
+{
+    uint64_t t0 = now ();
+
+    snapshotState (nFic, p_fSt, snap);
+    latRecord (st, PH_SAVESTATE, now () - t0);
+}
+
+/**
+ *  \brief Merging the samples of latency stats into other ones.
+ *
+ *  \param dst pointer to the latency stats where the samples are added
+ *  \param src pointer to the latency stats whose samples are added
+ */
+void latMerge (LAT_STATS *dst, LAT_STATS *src)
+{
+    int p, b;
+
+    for (p = 0; p < NUMPHASES; p++) {
+        LAT_HIST *d = &dst->phase[p], *s = &src->phase[p];
+
+        mergeHist (d, atomic_load (&s->count), atomic_load (&s->sum), atomic_load (&s->min), atomic_load (&s->max));
+        mergeSpin (d, atomic_load (&s->spun), atomic_load (&s->slept));
+        for (b = 0; b < LAT_BUCKETS; b++) {
+            atomic_fetch_add_explicit (&d->bucket[b], atomic_load (&s->bucket[b]), memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ *  \brief Value below which a fraction of the samples of a histogram fall.
+ *
+ *  It is the highest value of the bucket where the percentile falls, bounded by the longest sample.
+ *
+ *  \param h pointer to the histogram, with at least one sample
+ *  \param q fraction of the samples, within [0, 1]
+ *
+ *  \return the percentile, in ns
+ */
+uint64_t latPercentile (LAT_HIST *h, double q)
+{
+    uint64_t count = atomic_load_explicit (&h->count, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit (&h->max, memory_order_relaxed);
+    uint64_t rank = (uint64_t) (q * (double) count), seen = 0;
+    int b;
+
+    if (rank >= count) rank = count - 1;
+    for (b = 0; b < LAT_BUCKETS; b++) {
+        seen += atomic_load_explicit (&h->bucket[b], memory_order_relaxed);
+        if (seen > rank) {
+            uint64_t top = bucketTop (b);
+            return (top < max) ? top : max;
+        }
+    }
+    return max;
+}
+
+/**
+ *  \brief Name of a protocol phase, as printed in the summary and in histogram files.
+ *
+ *  \param phase protocol phase
+ *
+ *  \return the name of the phase
+ */
+const char *latPhaseName (int phase)
+{
+    return phaseName[phase];
+}
+
+/**
+ *  \brief Printing count/min/mean/p50/p99/p99.9/max of every phase with samples, one line per phase, and the spin
+ *  hit rate of the phases that spun.
+ *
+ *  Percentiles are the highest value of the bucket where they fall. Times are printed in us. The spin hit rate is
+ *  the share of the waits that found their semaphore red and took it while spinning; the column is left out when
+ *  no phase spun.
+ *
+ *  \param fp stream where the summary is printed
+ *  \param title title of the summary
+ *  \param st pointer to the latency stats
+ */
+void latPrint (FILE *fp, const char *title, LAT_STATS *st)
+{
+    bool spun = false;
+    int p;
+
+    for (p = 0; p < NUMPHASES; p++) {
+        if (atomic_load (&st->phase[p].spun) + atomic_load (&st->phase[p].slept) > 0) spun = true;
+    }
+    fprintf (fp, "%s\n", title);
+    fprintf (fp, "  %-12s %10s %11s %11s %11s %11s %11s %11s", "phase (us)", "count", "min", "mean", "p50", "p99",
+             "p99.9", "max");
+    fprintf (fp, spun ? " %9s\n" : "\n", "spin hit");
+    for (p = 0; p < NUMPHASES; p++) {
+        LAT_HIST *h = &st->phase[p];
+        uint64_t count = atomic_load (&h->count),
+                 waits = atomic_load (&h->spun) + atomic_load (&h->slept);
+
+        if (count == 0) continue;
+        fprintf (fp, "  %-12s %10llu %11.3f %11.3f %11.3f %11.3f %11.3f %11.3f", phaseName[p],
+                 (unsigned long long) count, (double) atomic_load (&h->min) / 1e3,
+                 (double) atomic_load (&h->sum) / (double) count / 1e3, (double) latPercentile (h, 0.50) / 1e3,
+                 (double) latPercentile (h, 0.99) / 1e3, (double) latPercentile (h, 0.999) / 1e3,
+                 (double) atomic_load (&h->max) / 1e3);
+        if (!spun) fprintf (fp, "\n");
+        else if (waits == 0) fprintf (fp, " %9s\n", "-");
+        else fprintf (fp, " %8.1f%%\n", 100.0 * (double) atomic_load (&h->spun) / (double) waits);
+    }
+}
+
+/**
+ *  \brief Merging the histograms kept in a histogram file into the stats of each kind of entity.
+ *
+ *  A missing file is taken as an empty one.
+ *
+ *  \param name name of the histogram file
+ *  \param st array with the latency stats of each kind of entity (LAT_KINDS elements)
+ *
+ *  \return number of runs recorded in the file, or -1 if it is not a valid histogram file
+ */
+int latLoad (const char *name, LAT_STATS st[])
+{
+    FILE *fp;
+    char line[64], kind[16], phase[16];
+    int runs, version, subBits, maxBits, k, p, b, n;
+    unsigned long long count, sum, min, max, samples, spun, slept;
+
+    if ((fp = fopen (name, "r")) == NULL) return (errno == ENOENT) ? 0 : -1;
+
+    if ((fgets (line, sizeof (line), fp) == NULL) || (strncmp (line, LAT_MAGIC, strlen (LAT_MAGIC)) != 0) ||
+        (sscanf (line + strlen (LAT_MAGIC), "%d", &version) != 1) || (version < 1) || (version > LAT_VERSION) ||
+        (fscanf (fp, " runs %d subbits %d maxbits %d", &runs, &subBits, &maxBits) != 3) ||
+        (subBits != LAT_SUBBITS) || (maxBits != LAT_MAXBITS)) {
+        fclose (fp);
+        return -1;
+    }
+
+    while (fscanf (fp, " hist %15s %15s %llu %llu %llu %llu", kind, phase, &count, &sum, &min, &max) == 6) {
+        for (k = 0; (k < LAT_KINDS) && (strcmp (kind, kindName[k]) != 0); k++)
+            ;
+        for (p = 0; (p < NUMPHASES) && (strcmp (phase, phaseName[p]) != 0); p++)
+            ;
+        if ((k == LAT_KINDS) || (p == NUMPHASES)) {
+            fclose (fp);
+            return -1;
+        }
+        mergeHist (&st[k].phase[p], count, sum, min, max);
+        while ((n = fscanf (fp, " %d:%llu", &b, &samples)) == 2) {
+            if ((b >= 0) && (b < LAT_BUCKETS)) {
+                atomic_fetch_add_explicit (&st[k].phase[p].bucket[b], (uint32_t) samples, memory_order_relaxed);
+            }
+        }
+    }
+    /* the spin counts follow all histograms */
+    while (fscanf (fp, " spin %15s %15s %llu %llu", kind, phase, &spun, &slept) == 4) {
+        for (k = 0; (k < LAT_KINDS) && (strcmp (kind, kindName[k]) != 0); k++)
+            ;
+        for (p = 0; (p < NUMPHASES) && (strcmp (phase, phaseName[p]) != 0); p++)
+            ;
+        if ((k == LAT_KINDS) || (p == NUMPHASES)) {
+            fclose (fp);
+            return -1;
+        }
+        mergeSpin (&st[k].phase[p], spun, slept);
+    }
+    fclose (fp);
+
+    return runs;
+}
+
+/**
+ *  \brief Writing the stats of each kind of entity into a histogram file, replacing it atomically.
+ *
+ *  The file is a text file: a header line, a line with the number of runs and the histogram layout, then one line
+ *  per kind of entity and phase with samples:
+ *  <tt>hist kind phase count sum min max bucket:samples ...</tt>, with times in ns and only non-empty buckets,
+ *  then one line per kind of entity and phase that spun: <tt>spin kind phase spun slept</tt>.
+ *
+ *  \param name name of the histogram file
+ *  \param st array with the latency stats of each kind of entity (LAT_KINDS elements)
+ *  \param runs number of runs the histograms come from
+ *
+ *  \return 0 upon success, -1 otherwise (the situation is reported in <tt>errno</tt>)
+ */
+int latSave (const char *name, LAT_STATS st[], int runs)
+{
+    FILE *fp;
+    char tmp[256];
+    int k, p, b;
+
+    snprintf (tmp, sizeof (tmp), "%s.tmp", name);
+    if ((fp = fopen (tmp, "w")) == NULL) return -1;
+
+    fprintf (fp, "%s%d\nruns %d subbits %d maxbits %d\n", LAT_MAGIC, LAT_VERSION, runs, LAT_SUBBITS, LAT_MAXBITS);
+    for (k = 0; k < LAT_KINDS; k++) {
+        for (p = 0; p < NUMPHASES; p++) {
+            LAT_HIST *h = &st[k].phase[p];
+
+            if (atomic_load (&h->count) == 0) continue;
+            fprintf (fp, "hist %s %s %llu %llu %llu %llu", kindName[k], phaseName[p],
+                     (unsigned long long) atomic_load (&h->count), (unsigned long long) atomic_load (&h->sum),
+                     (unsigned long long) atomic_load (&h->min), (unsigned long long) atomic_load (&h->max));
+            for (b = 0; b < LAT_BUCKETS; b++) {
+                uint32_t n = atomic_load (&h->bucket[b]);
+
+                if (n != 0) fprintf (fp, " %d:%u", b, n);
+            }
+            fprintf (fp, "\n");
+        }
+    }
+    for (k = 0; k < LAT_KINDS; k++) {
+        for (p = 0; p < NUMPHASES; p++) {
+            LAT_HIST *h = &st[k].phase[p];
+
+            if (atomic_load (&h->spun) + atomic_load (&h->slept) == 0) continue;
+            fprintf (fp, "spin %s %s %llu %llu\n", kindName[k], phaseName[p],
+                     (unsigned long long) atomic_load (&h->spun), (unsigned long long) atomic_load (&h->slept));
+        }
+    }
+
+    if (fclose (fp) == EOF) return -1;
+    return rename (tmp, name);
+}
@@ -0,0 +1,232 @@
+/**
+ *  \file latency.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Timing of the phases of the protocol of the intervening entities.
+ *
+ *  The time every entity spends in each phase (entering the critical region, blocked on each synchronization
+ *  point, recording its state) is measured with CLOCK_MONOTONIC and added to log-linear histograms, in the style
+ *  of HdrHistogram: fixed-size, allocation-free and mergeable. There is one set of histograms per kind of entity
+ *  in the shared information of each pitch, updated with atomic operations; the generator merges them once all
+ *  entities have ended, prints a summary and may merge them into a histogram file shared by several runs.
+ *
+ *  The waits of the handoff phases, most of which are very short, may spin for a while before blocking (see
+ *  <tt>semDownSpin</tt>), with the budget of the run (option -w of the generator); how many of those that found
+ *  their semaphore red ended while spinning is counted with the samples, so that the budget can be tuned.
+ *
+ *  Defined operations:
+ *     \li timed down operations on a semaphore
+ *     \li timed state snapshot
+ *     \li merging of histograms, percentiles, printing of the summary
+ *     \li loading and saving histograms in a machine-readable file.
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "logging.h"
+
+/* Protocol phases */
+
+/** \brief entering the critical region (<tt>sh->mutex</tt>) */
+#define  PH_MUTEX          0
+/** \brief player or goalie blocked waiting for a team (its private semaphore) */
+#define  PH_WAITTEAM       1
+/** \brief team captain blocked waiting for the registration of the teammates (<tt>playerRegistered</tt> of its team) */
+#define  PH_REGISTERED     2
+/** \brief player or goalie blocked waiting for the referee to start the match (its private semaphore) */
+#define  PH_WAITREFEREE    3
+/** \brief player or goalie blocked waiting for the referee to end the match (its private semaphore) */
+#define  PH_WAITEND        4
+/** \brief referee blocked waiting for both teams (<tt>refereeWaitTeams</tt>) */
+#define  PH_WAITTEAMS      5
+/** \brief referee blocked waiting for all teammates to be playing (<tt>playing</tt>) */
+#define  PH_PLAYING        6
+/** \brief any entity blocked between two matches of a tournament (<tt>waitMatchEnd</tt>, <tt>waitMatchStart</tt>) */
+#define  PH_NEXTMATCH      7
+/** \brief recording the state (<tt>snapshotState</tt>, inside the critical region) */
+#define  PH_SAVESTATE      8
+
+/** \brief number of protocol phases */
+#define  NUMPHASES         9
+
+/* Kinds of entities */
+
+/** \brief players */
+#define  LAT_PLAYERS       0
+/** \brief goalies */
+#define  LAT_GOALIES       1
+/** \brief referees */
+#define  LAT_REFEREES      2
+
+/** \brief number of kinds of entities */
+#define  LAT_KINDS         3
+
+/** \brief log2 of the number of sub-buckets of each power of two: values are kept within 1/16 of their size */
+#define  LAT_SUBBITS       5
+/** \brief log2 of the largest value kept apart, in ns (about 68 s); larger values go to the last bucket */
+#define  LAT_MAXBITS       36
+/** \brief number of buckets of a histogram */
+#define  LAT_BUCKETS       ((LAT_MAXBITS - LAT_SUBBITS + 2) << (LAT_SUBBITS - 1))
+
+/**
+ *  \brief Definition of <em>latency histogram</em> data type.
+ *
+ *  Values below 2^LAT_SUBBITS ns have a bucket each; above that, every power of two is split into
+ *  2^(LAT_SUBBITS-1) equal buckets.
+ */
+typedef struct {
+    /** \brief number of samples (from a cache line of its own, as each histogram is updated by many entities) */
+    _Alignas (CACHELINE) _Atomic uint64_t count;
+    /** \brief sum of the samples, in ns */
+    _Atomic uint64_t sum;
+    /** \brief shortest sample, in ns */
+    _Atomic uint64_t min;
+    /** \brief longest sample, in ns */
+    _Atomic uint64_t max;
+    /** \brief number of waits that found the semaphore red and took it while spinning */
+    _Atomic uint64_t spun;
+    /** \brief number of waits that found the semaphore red and blocked */
+    _Atomic uint64_t slept;
+    /** \brief number of samples in each bucket */
+    _Atomic uint32_t bucket[LAT_BUCKETS];
+} LAT_HIST;
+
+/**
+ *  \brief Definition of <em>latency stats</em> data type: the histograms of all phases.
+ */
+typedef struct {
+    /** \brief histogram of each phase */
+    LAT_HIST phase[NUMPHASES];
+    /** \brief largest number of polls of a semaphore before blocking in the phases that spin (0 for none), set once
+               the stats are initialized */
+    unsigned int spin;
+} LAT_STATS;
+
+/**
+ *  \brief Initialization of latency stats, with no samples and no spinning.
+ *
+ *  \param st pointer to the latency stats
+ */
+extern void latInit (LAT_STATS *st);
+
+/**
+ *  \brief Adding a sample to a phase; may be called concurrently by several entities.
+ *
+ *  \param st pointer to the latency stats
+ *  \param phase protocol phase
+ *  \param ns duration of the sample, in ns
+ */
+extern void latRecord (LAT_STATS *st, int phase, uint64_t ns);
+
+/**
+ *  \brief Timed <em>down</em> operation on a semaphore of the set, spinning before blocking in the phases that spin.
+ *
+ *  A stale entity of the IPC pool (see ipcPool.h) gives back the units it took and ends instead of returning.
+ *
+ *  \param st pointer to the latency stats
+ *  \param phase protocol phase the wait belongs to
+ *  \param semgid semaphore set identifier
+ *  \param sindex semaphore index within the set
+ *
+ *  \return the value returned by <tt>semDown</tt>
+ */
+extern int latDown (LAT_STATS *st, int phase, int semgid, unsigned int sindex);
+
+/**
+ *  \brief Timed <em>down</em> by <tt>n</tt> units of a semaphore of the set, spinning before blocking in the phases
+ *  that spin.
+ *
+ *  A stale entity of the IPC pool (see ipcPool.h) gives back the units it took and ends instead of returning.
+ *
+ *  \param st pointer to the latency stats
+ *  \param phase protocol phase the wait belongs to
+ *  \param semgid semaphore set identifier
+ *  \param sindex semaphore index within the set
+ *  \param n number of units
+ *
+ *  \return the value returned by <tt>semDownN</tt>
+ */
+extern int latDownN (LAT_STATS *st, int phase, int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Timed snapshot of the present full state (see <tt>snapshotState</tt>), counted in PH_SAVESTATE.
+ *
+ *  \param st pointer to the latency stats
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+extern void latSnapshot (LAT_STATS *st, char nFic[], FULL_STAT *p_fSt, STATE_SNAPSHOT *snap);
+
+/**
+ *  \brief Merging the samples of latency stats into other ones.
+ *
+ *  \param dst pointer to the latency stats where the samples are added
+ *  \param src pointer to the latency stats whose samples are added
+ */
+extern void latMerge (LAT_STATS *dst, LAT_STATS *src);
+
+/**
+ *  \brief Value below which a fraction of the samples of a histogram fall.
+ *
+ *  \param h pointer to the histogram, with at least one sample
+ *  \param q fraction of the samples, within [0, 1]
+ *
+ *  \return the percentile, in ns
+ */
+extern uint64_t latPercentile (LAT_HIST *h, double q);
+
+/**
+ *  \brief Name of a protocol phase, as printed in the summary and in histogram files.
+ *
+ *  \param phase protocol phase
+ *
+ *  \return the name of the phase
+ */
+extern const char *latPhaseName (int phase);
+
+/**
+ *  \brief Printing count/min/mean/p50/p99/p99.9/max of every phase with samples, one line per phase, and the spin
+ *  hit rate of the phases that spun.
+ *
+ *  \param fp stream where the summary is printed
+ *  \param title title of the summary
+ *  \param st pointer to the latency stats
+ */
+extern void latPrint (FILE *fp, const char *title, LAT_STATS *st);
+
+/**
+ *  \brief Merging the histograms kept in a histogram file into the stats of each kind of entity.
+ *
+ *  A missing file is taken as an empty one.
+ *
+ *  \param name name of the histogram file
+ *  \param st array with the latency stats of each kind of entity (LAT_KINDS elements)
+ *
+ *  \return number of runs recorded in the file, or -1 if it is not a valid histogram file
+ */
+extern int latLoad (const char *name, LAT_STATS st[]);
+
+/**
+ *  \brief Writing the stats of each kind of entity into a histogram file, replacing it atomically.
+ *
+ *  The file is a text file: a header line, a line with the number of runs and the histogram layout, then one line
+ *  per kind of entity and phase with samples:
+ *  <tt>hist kind phase count sum min max bucket:samples ...</tt>, with times in ns and only non-empty buckets,
+ *  then one line per kind of entity and phase that spun: <tt>spin kind phase spun slept</tt>.
+ *
+ *  \param name name of the histogram file
+ *  \param st array with the latency stats of each kind of entity (LAT_KINDS elements)
+ *  \param runs number of runs the histograms come from
+ *
+ *  \return 0 upon success, -1 otherwise (the situation is reported in <tt>errno</tt>)
+ */
+extern int latSave (const char *name, LAT_STATS st[], int runs);
+
+#endif /* LATENCY_H_ */
@@ -0,0 +1,212 @@
+/**
+ *  \file lockProf.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Contention profile of the critical region of each pitch (<tt>sh->mutex</tt>).
+ *
+ *  Defined operations:
+ *     \li initialization of the counters
+ *     \li entering and leaving the critical region of a pitch, or entering it only if it is free
+ *     \li merging of the counters of several pitches
+ *     \li printing of the sites, ranked by total hold time.
+ *
+ *  An entity holds one region at a time, so that the instants it entered it and the time it waited are kept by the
+ *  entity itself, private to each thread, until it leaves the region.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "semaphore.h"
+#include "latency.h"
+#include "lockProf.h"
+
+/** \brief kind of entity of each call site, as printed in the profile */
+static const char *siteKind[LK_SITES] = {
+    "players", "players", "players", "players", "players", "players", "players",
+    "goalies", "goalies", "goalies", "goalies", "goalies", "goalies", "goalies",
+    "referees", "referees", "referees", "referees", "referees", "referees", "referees",
+    "generator"
+};
+
+/** \brief name of each call site, as printed in the profile */
+static const char *siteName[LK_SITES] = {
+    "arrive", "captain", "queue", "waitReferee", "play", "matchDone", "matchReady",
+    "arrive", "captain", "queue", "waitReferee", "play", "matchDone", "matchReady",
+    "arrive", "waitTeams", "startGame", "play", "endGame", "matchDone", "matchReady",
+    "matchBarrier"
+};
+
+/** \brief instant the caller entered the region it holds, in ns */
+static _Thread_local uint64_t entered;
+
+/** \brief time the caller waited to enter the region it holds, in ns */
+static _Thread_local uint64_t waited;
+
+/* internal functions */
+
+static uint64_t now(void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+static void addSite(LOCK_SITE *d, uint64_t count, uint64_t wait, uint64_t maxWait, uint64_t hold, uint64_t maxHold)
+{
+    d->count += count;
+    d->wait += wait;
+    d->hold += hold;
+    if (maxWait > d->maxWait) d->maxWait = maxWait;
+    if (maxHold > d->maxHold) d->maxHold = maxHold;
+}
+
+/* external functions */
+
+/**
+ *  \brief Initialization of lock stats, with no samples and no profiling.
+ *
+ *  \param lk pointer to the lock stats
+ */
+void lockInit (LOCK_STATS *lk)
+{
+    int s;
+
+    lk->on = false;
+    for (s = 0; s < LK_SITES; s++) {
+        lk->site[s] = (LOCK_SITE) { 0, 0, 0, 0, 0 };
+    }
+}
+
+/**
+ *  \brief Entering the critical region: timed <em>down</em> of its semaphore, counted in PH_MUTEX (see
+ *  <tt>latDown</tt>).
+ *
+ *  \param lk pointer to the lock stats of the region
+ *  \param lat pointer to the latency stats of the kind of the caller
+ *  \param semgid semaphore set identifier
+ *  \param sindex index of the semaphore of the region within the set
+ *
+ *  \return the value returned by <tt>semDown</tt>
+ */
+int lockDown (LOCK_STATS *lk, LAT_STATS *lat, int semgid, unsigned int sindex)
+{
+    uint64_t t0;
+    int ret;
+
+    if (!lk->on) return latDown (lat, PH_MUTEX, semgid, sindex);
+
+    t0 = now ();
+    ret = latDown (lat, PH_MUTEX, semgid, sindex);
+    entered = now ();
+    waited = entered - t0;
+    return ret;
+}
+
+/**
+ *  \brief Entering the critical region only if it is free (see <tt>semTryDown</tt>), for a caller that must never
+ *  block on it; the region is then left with <tt>lockUp</tt>, as one entered with <tt>lockDown</tt>.
+ *
+ *  A region entered this way was not waited for: only its hold is counted.
+ *
+ *  \param lk pointer to the lock stats of the region
+ *  \param semgid semaphore set identifier
+ *  \param sindex index of the semaphore of the region within the set
+ *
+ *  \return the value returned by <tt>semTryDown</tt>: -1 with EAGAIN when the region is held
+ */
+int lockTryDown (LOCK_STATS *lk, int semgid, unsigned int sindex)
+{
+    int ret = semTryDown (semgid, sindex);
+
+    if (lk->on && (ret == 0)) {
+        entered = now ();
+        waited = 0;
+    }
+    return ret;
+}
+
+/**
+ *  \brief Leaving the critical region: the wait and the hold of the caller are added to the counters of its call
+ *  site, then its semaphore is <em>up</em>ped.
+ *
+ *  The counters are updated while the region is still held, so that plain additions do.
+ *
+ *  \param lk pointer to the lock stats of the region
+ *  \param site call site the region was held from
+ *  \param semgid semaphore set identifier
+ *  \param sindex index of the semaphore of the region within the set
+ *
+ *  \return the value returned by <tt>semUp</tt>
+ */
+int lockUp (LOCK_STATS *lk, int site, int semgid, unsigned int sindex)
+{
+    if (lk->on) {
+        uint64_t hold = now () - entered;
+
+        addSite (&lk->site[site], 1, waited, waited, hold, hold);
+    }
+    return semUp (semgid, sindex);
+}
+
+/**
+ *  \brief Merging the counters of lock stats into other ones; profiling is on in the result if it is in either.
+ *
+ *  \param dst pointer to the lock stats where the counters are added
+ *  \param src pointer to the lock stats whose counters are added
+ */
+void lockMerge (LOCK_STATS *dst, LOCK_STATS *src)
+{
+    int s;
+
+    dst->on = dst->on || src->on;
+    for (s = 0; s < LK_SITES; s++) {
+        LOCK_SITE *p = &src->site[s];
+
+        addSite (&dst->site[s], p->count, p->wait, p->maxWait, p->hold, p->maxHold);
+    }
+}
+
+/**
+ *  \brief Printing the call sites that held the region, one line per site, from the longest total hold time down.
+ *
+ *  Each line has the kind of entity and the name of the site, the number of times it held the region, its total
+ *  hold time (ms) and share of the hold time of all sites, its mean and longest hold (us), then its total wait to
+ *  enter the region (ms) and its mean and longest wait (us).
+ *
+ *  \param fp stream where the profile is printed
+ *  \param lk pointer to the lock stats
+ */
+void lockPrint (FILE *fp, LOCK_STATS *lk)
+{
+    int order[LK_SITES];
+    uint64_t total = 0;
+    int i, j, s;
+
+    /* insertion sort of the sites by total hold time, the longest first */
+    for (i = 0; i < LK_SITES; i++) {
+        for (j = i; (j > 0) && (lk->site[order[j - 1]].hold < lk->site[i].hold); j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+        total += lk->site[i].hold;
+    }
+
+    fprintf (fp, "critical region, by call site\n");
+    fprintf (fp, "  %-10s %-13s %10s %11s %7s %11s %11s %11s %11s %11s\n", "kind", "site", "count", "hold (ms)", "share",
+             "mean (us)", "max (us)", "wait (ms)", "mean (us)", "max (us)");
+    for (i = 0; i < LK_SITES; i++) {
+        LOCK_SITE *p = &lk->site[s = order[i]];
+
+        if (p->count == 0) continue;
+        fprintf (fp, "  %-10s %-13s %10llu %11.3f %6.1f%% %11.3f %11.3f %11.3f %11.3f %11.3f\n", siteKind[s],
+                 siteName[s], (unsigned long long) p->count, (double) p->hold / 1e6,
+                 (total > 0) ? 100.0 * (double) p->hold / (double) total : 0.0,
+                 (double) p->hold / (double) p->count / 1e3, (double) p->maxHold / 1e3, (double) p->wait / 1e6,
+                 (double) p->wait / (double) p->count / 1e3, (double) p->maxWait / 1e3);
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ *  \file lockProf.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Contention profile of the critical region of each pitch (<tt>sh->mutex</tt>).
+ *
+ *  With option -M of the generator, every critical region records the time its entity waited to enter it and held
+ *  it, attributed to its call site: the function of the entity that went through it, and, when it could take either
+ *  of two paths, the path it took. The site is named as the region is left, since only then is the path known.
+ *  Each site belongs to one kind of entity, so that the profile is by call site and by kind of entity.
+ *
+ *  The counters of each site are in the shared information of each pitch and are updated just before the region is
+ *  left, while it is still held: the mutex they measure is what protects them. The wait is the time spent in
+ *  <tt>latDown</tt>, the hold the time until the counters are updated. The generator, which drains the log ring that
+ *  entities inside the region may wait for, only enters a region that is free, and waits for none. Without -M,
+ *  entering and leaving a region are the plain semaphore operations, with no clock read.
+ *
+ *  Defined operations:
+ *     \li initialization of the counters
+ *     \li entering and leaving the critical region of a pitch, or entering it only if it is free
+ *     \li merging of the counters of several pitches
+ *     \li printing of the sites, ranked by total hold time.
+ */
+
+#ifndef LOCKPROF_H_
+#define LOCKPROF_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "latency.h"
+
+/* Call sites of the critical region */
+
+/** \brief player arriving (<tt>arrive</tt>) */
+#define  LK_PL_ARRIVE          0
+/** \brief player forming a team, as its captain (<tt>playerConstituteTeam</tt>) */
+#define  LK_PL_CAPTAIN         1
+/** \brief player queueing for a team (<tt>playerConstituteTeam</tt>) */
+#define  LK_PL_QUEUE           2
+/** \brief player waiting for the referee to start the match (<tt>waitReferee</tt>) */
+#define  LK_PL_WAITREFEREE     3
+/** \brief player starting to play (<tt>playUntilEnd</tt>) */
+#define  LK_PL_PLAY            4
+/** \brief player reporting the end of its match (<tt>waitNextMatch</tt>) */
+#define  LK_PL_MATCHDONE       5
+/** \brief player reporting it is ready for the next match (<tt>waitNextMatch</tt>) */
+#define  LK_PL_MATCHREADY      6
+/** \brief goalie arriving (<tt>arrive</tt>) */
+#define  LK_GL_ARRIVE          7
+/** \brief goalie forming a team, as its captain (<tt>goalieConstituteTeam</tt>) */
+#define  LK_GL_CAPTAIN         8
+/** \brief goalie queueing for a team (<tt>goalieConstituteTeam</tt>) */
+#define  LK_GL_QUEUE           9
+/** \brief goalie waiting for the referee to start the match (<tt>waitReferee</tt>) */
+#define  LK_GL_WAITREFEREE     10
+/** \brief goalie starting to play (<tt>playUntilEnd</tt>) */
+#define  LK_GL_PLAY            11
+/** \brief goalie reporting the end of its match (<tt>waitNextMatch</tt>) */
+#define  LK_GL_MATCHDONE       12
+/** \brief goalie reporting it is ready for the next match (<tt>waitNextMatch</tt>) */
+#define  LK_GL_MATCHREADY      13
+/** \brief referee arriving (<tt>arrive</tt>) */
+#define  LK_RF_ARRIVE          14
+/** \brief referee waiting for the teams (<tt>waitForTeams</tt>) */
+#define  LK_RF_WAITTEAMS       15
+/** \brief referee starting the match (<tt>startGame</tt>) */
+#define  LK_RF_STARTGAME       16
+/** \brief referee refereeing (<tt>play</tt>) */
+#define  LK_RF_PLAY            17
+/** \brief referee ending the match (<tt>endGame</tt>) */
+#define  LK_RF_ENDGAME         18
+/** \brief referee reporting the end of its match (<tt>waitNextMatch</tt>) */
+#define  LK_RF_MATCHDONE       19
+/** \brief referee reporting it is ready for the next match (<tt>waitNextMatch</tt>) */
+#define  LK_RF_MATCHREADY      20
+/** \brief generator advancing the barrier between two matches (<tt>matchBarrier</tt>) */
+#define  LK_GEN_BARRIER        21
+
+/** \brief number of call sites */
+#define  LK_SITES              22
+
+/**
+ *  \brief Definition of <em>call site counters</em> data type.
+ */
+typedef struct {
+    /** \brief number of times the region was held */
+    uint64_t count;
+    /** \brief total time spent waiting to enter the region, in ns */
+    uint64_t wait;
+    /** \brief longest wait, in ns */
+    uint64_t maxWait;
+    /** \brief total time the region was held, in ns */
+    uint64_t hold;
+    /** \brief longest hold, in ns */
+    uint64_t maxHold;
+} LOCK_SITE;
+
+/**
+ *  \brief Definition of <em>lock stats</em> data type: the counters of all call sites of the region of a pitch.
+ */
+typedef struct {
+    /** \brief the region is profiled (option -M), set once the stats are initialized */
+    bool on;
+    /** \brief counters of each call site */
+    LOCK_SITE site[LK_SITES];
+} LOCK_STATS;
+
+/**
+ *  \brief Initialization of lock stats, with no samples and no profiling.
+ *
+ *  \param lk pointer to the lock stats
+ */
+extern void lockInit (LOCK_STATS *lk);
+
+/**
+ *  \brief Entering the critical region: timed <em>down</em> of its semaphore, counted in PH_MUTEX (see
+ *  <tt>latDown</tt>).
+ *
+ *  \param lk pointer to the lock stats of the region
+ *  \param lat pointer to the latency stats of the kind of the caller
+ *  \param semgid semaphore set identifier
+ *  \param sindex index of the semaphore of the region within the set
+ *
+ *  \return the value returned by <tt>semDown</tt>
+ */
+extern int lockDown (LOCK_STATS *lk, LAT_STATS *lat, int semgid, unsigned int sindex);
+
+/**
+ *  \brief Entering the critical region only if it is free (see <tt>semTryDown</tt>), for a caller that must never
+ *  block on it; the region is then left with <tt>lockUp</tt>, as one entered with <tt>lockDown</tt>.
+ *
+ *  \param lk pointer to the lock stats of the region
+ *  \param semgid semaphore set identifier
+ *  \param sindex index of the semaphore of the region within the set
+ *
+ *  \return the value returned by <tt>semTryDown</tt>: -1 with EAGAIN when the region is held
+ */
+extern int lockTryDown (LOCK_STATS *lk, int semgid, unsigned int sindex);
+
+/**
+ *  \brief Leaving the critical region: the wait and the hold of the caller are added to the counters of its call
+ *  site, then its semaphore is <em>up</em>ped.
+ *
+ *  \param lk pointer to the lock stats of the region
+ *  \param site call site the region was held from
+ *  \param semgid semaphore set identifier
+ *  \param sindex index of the semaphore of the region within the set
+ *
+ *  \return the value returned by <tt>semUp</tt>
+ */
+extern int lockUp (LOCK_STATS *lk, int site, int semgid, unsigned int sindex);
+
+/**
+ *  \brief Merging the counters of lock stats into other ones; profiling is on in the result if it is in either.
+ *
+ *  \param dst pointer to the lock stats where the counters are added
+ *  \param src pointer to the lock stats whose counters are added
+ */
+extern void lockMerge (LOCK_STATS *dst, LOCK_STATS *src);
+
+/**
+ *  \brief Printing the call sites that held the region, one line per site, from the longest total hold time down.
+ *
+ *  \param fp stream where the profile is printed
+ *  \param lk pointer to the lock stats
+ */
+extern void lockPrint (FILE *fp, LOCK_STATS *lk);
+
+#endif /* LOCKPROF_H_ */
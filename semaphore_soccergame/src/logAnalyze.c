@@ -0,0 +1,533 @@
+/**
+ *  \file logAnalyze.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Streaming analyzer of logging files.
+ *
+ *  Reads logging files in the text layout of <tt>saveState</tt> or in the compact binary format, for any roster
+ *  (taken from the header of the file), and prints
+ *    \li the filtered view of <tt>filter_log.awk</tt>, where a field that did not change since the previous line is
+ *        shown as "."
+ *    \li metrics of the run: time spent by every entity in each state (in ms for binary logs, which have timestamps,
+ *        in records for text logs), late entities and the order in which teams were formed
+ *    \li violations of the protocol, as found by the checker the generator runs with option -c (see protoCheck.h).
+ *
+ *  Usage: logAnalyze [-f] [-s] [-c] [-P team players] [-G team goalies] [logfile ...]
+ *    \li -f filtered view (the default, when neither -s nor -c is given)
+ *    \li -s metrics of every logging file
+ *    \li -c protocol checks; the program ends with EXIT_FAILURE if any violation is found
+ *    \li -P n, -G n number of players and goalies in each team, for the checks (default NUMTEAMPLAYERS and
+ *        NUMTEAMGOALIES).
+ *
+ *  Files are mapped into memory; if no logging file is given, the log is read from stdin, in large chunks.
+ *  Players and goalies are dealt round-robin over the pitches, one referee each, as in the generator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "probConst.h"
+#include "logging.h"
+
+/** \brief size of the stdio buffers and of the chunks read from stdin */
+#define  IOBUFSIZE      (1 << 20)
+
+/** \brief largest number of states of a kind of entity */
+#define  MAXSTATES      8
+
+/** \brief states of players and goalies, in the order of the time-in-state table */
+static const char pgStates[] = { ARRIVING, WAITING_TEAM, FORMING_TEAM, WAITING_START_1, WAITING_START_2, PLAYING_1,
+                                 PLAYING_2, LATE, '\0' };
+
+/** \brief states of referees, in the order of the time-in-state table */
+static const char rfStates[] = { ARRIVINGR, WAITING_TEAMS, STARTING_GAME, REFEREEING, ENDING_GAME, '\0' };
+
+/**
+ *  \brief Definition of <em>team formation</em> data type.
+ */
+typedef struct {
+    /** \brief record where the captain started forming the team */
+    long rec;
+    /** \brief entity id of the captain, over all kinds of entities */
+    int captain;
+    /** \brief team formed (1 or 2) */
+    int team;
+} FORMATION;
+
+/* options */
+static bool filter = false,                                                                     /* filtered view */
+            stats = false,                                                                 /* metrics of the run */
+            check = false;                                                                   /* protocol checks */
+static int nTeamPlayers = NUMTEAMPLAYERS,
+           nTeamGoalies = NUMTEAMGOALIES;
+
+/* roster of the present logging file */
+static int nPlayers, nGoalies, nReferees, n;
+static int fieldW;                                                          /* width of a field of a text line */
+
+/* analysis of the present logging file */
+static bool header;                                                                        /* roster already known */
+static bool timed;                                                                   /* records have timestamps */
+static long records;                                                                        /* records analyzed */
+static unsigned char *cur;                                                            /* states of the last record */
+static char (*prev)[8];                                                           /* fields of the last line shown */
+static uint64_t *inState;                                                  /* time of each entity in each state */
+static uint64_t lastTs;                                                           /* timestamp of the last record */
+static long *forming;                                              /* record where each entity started forming */
+static bool *wasLate;                                                          /* entity arrived late at least once */
+static long lateArrivals;                                                               /* late arrivals in total */
+static FORMATION *formation;                                                                      /* teams formed */
+static long nFormation, maxFormation;
+static PROTO_CHECK chk;                                                                   /* protocol checker */
+static long totalViolations;                                                   /* violations found in all files */
+
+/* internal functions */
+
+static bool isPlayer (int e)  { return e < nPlayers; }
+static bool isReferee (int e) { return e >= nPlayers + nGoalies; }
+
+static int pitchOf (int e)
+{
+    if (isReferee (e)) return e - nPlayers - nGoalies;
+    return (isPlayer (e) ? e : e - nPlayers) % nReferees;
+}
+
+static void entityName (int e, char *name)
+{
+    if (isPlayer (e)) sprintf (name, "P%0*d", fieldW - 2, e);
+    else if (!isReferee (e)) sprintf (name, "G%0*d", fieldW - 2, e - nPlayers);
+    else sprintf (name, "R%0*d", fieldW - 2, e - nPlayers - nGoalies + 1);
+}
+
+static const char *statesOf (int e)
+{
+    return isReferee (e) ? rfStates : pgStates;
+}
+
+static int stateIndex (int e, unsigned char c)
+{
+    const char *s = strchr (statesOf (e), c);
+
+    return ((c == '\0') || (s == NULL)) ? -1 : (int) (s - statesOf (e));
+}
+
+/* team of a player or goalie state: 1, 2 or 0 for none */
+static int teamOf (unsigned char c)
+{
+    if ((c == WAITING_START_1) || (c == PLAYING_1)) return 1;
+    if ((c == WAITING_START_2) || (c == PLAYING_2)) return 2;
+    return 0;
+}
+
+static void reset (void)
+{
+    free (cur); free (prev); free (inState); free (forming); free (wasLate); free (formation);
+    cur = NULL; prev = NULL; inState = NULL; forming = NULL; wasLate = NULL; formation = NULL;
+    if (header && check) chkFree (&chk);
+    header = false;
+    timed = false;
+    records = lateArrivals = nFormation = maxFormation = 0;
+}
+
+/* width of each field of a text line, as in the log: a blank, the kind of entity and the digits of the largest id,
+   two at least */
+static int fieldWidth (int nP, int nG, int nR)
+{
+    int id = nP - 1, w = 4;
+
+    if (nG - 1 > id) id = nG - 1;
+    if (nR > id) id = nR;
+    for (id /= 100; id > 0; id /= 10) w++;
+    return w;
+}
+
+static void setRoster (int nP, int nG, int nR)
+{
+    int e;
+
+    nPlayers = nP;
+    nGoalies = nG;
+    nReferees = nR;
+    n = nP + nG + nR;
+    fieldW = fieldWidth (nP, nG, nR);
+    if (((cur = malloc ((size_t) n)) == NULL) || ((prev = calloc ((size_t) n, sizeof (*prev))) == NULL) ||
+        ((inState = calloc ((size_t) n * MAXSTATES, sizeof (uint64_t))) == NULL) ||
+        ((forming = malloc ((size_t) n * sizeof (long))) == NULL) ||
+        ((wasLate = calloc ((size_t) n, sizeof (bool))) == NULL)) {
+        perror ("error on allocating memory");
+        exit (EXIT_FAILURE);
+    }
+    for (e = 0; e < n; e++) {
+        forming[e] = -1;
+    }
+    if (check) chkInit (&chk, nP, nG, nR, nTeamPlayers, nTeamGoalies, stdout);
+    header = true;
+}
+
+/* prints a line of fields with the widths used by filter_log.awk (wider for ids of three digits or more), built in
+   a buffer rather than field by field */
+static void printFiltered (char **field)
+{
+    static char *line = NULL;
+    static size_t size = 0;
+    size_t len = 0, l;
+    const char *f;
+    int e, w;
+
+    if (size < (size_t) n * 9 + 2) {
+        size = (size_t) n * 9 + 2;
+        if ((line = realloc (line, size)) == NULL) {
+            perror ("error on allocating memory");
+            exit (EXIT_FAILURE);
+        }
+    }
+    for (e = 0; e < n; e++) {
+        /* the first goalie and the first referee are preceded by the group separator */
+        w = ((e == nPlayers) || (e == nPlayers + nGoalies)) ? fieldW + 1 : fieldW;
+        f = (strcmp (field[e], prev[e]) == 0) ? "." : field[e];
+        l = strlen (f);
+        if (l < (size_t) w) {
+            memset (line + len, ' ', (size_t) w - l);
+            len += (size_t) w - l;
+        }
+        memcpy (line + len, f, l);
+        len += l;
+        line[len++] = ' ';
+        if (f == field[e]) memcpy (prev[e], f, l + 1);                               /* fields are shorter than 8 */
+    }
+    line[len++] = '\n';
+    fwrite (line, 1, len, stdout);
+}
+
+static void printHeaderLines (void)
+{
+    char name[n][8];
+    char *field[n];
+    int e;
+
+    for (e = 0; e < n; e++) {
+        entityName (e, name[e]);
+        field[e] = name[e];
+    }
+    printFiltered (field);
+}
+
+/* analyzes one record with the states of all entities */
+static void record (const unsigned char *st, uint64_t ts)
+{
+    char fields[n][2];
+    char *field[n];
+    int e, i;
+
+    if (filter) {
+        for (e = 0; e < n; e++) {
+            fields[e][0] = (char) st[e];
+            fields[e][1] = '\0';
+            field[e] = fields[e];
+        }
+        printFiltered (field);
+    }
+    if (check) chkRecord (&chk, st);
+
+    if (records == 0) {
+        memcpy (cur, st, (size_t) n);
+        lastTs = ts;
+        records += 1;
+        return;
+    }
+
+    /* the time since the last record was spent in the states it recorded */
+    for (e = 0; e < n; e++) {
+        if ((i = stateIndex (e, cur[e])) >= 0)
+            inState[(size_t) e * MAXSTATES + (size_t) i] += timed ? ts - lastTs : 1;
+    }
+    lastTs = ts;
+
+    for (e = 0; e < n; e++) {
+        if (st[e] == cur[e]) continue;
+        if (!isReferee (e)) {
+            if (st[e] == LATE) {
+                wasLate[e] = true;
+                lateArrivals += 1;
+            }
+            if (st[e] == FORMING_TEAM) forming[e] = records;
+            else if ((cur[e] == FORMING_TEAM) && (teamOf (st[e]) != 0)) {
+                if (nFormation == maxFormation) {
+                    maxFormation = (maxFormation == 0) ? 64 : 2 * maxFormation;
+                    if ((formation = realloc (formation, (size_t) maxFormation * sizeof (FORMATION))) == NULL) {
+                        perror ("error on allocating memory");
+                        exit (EXIT_FAILURE);
+                    }
+                }
+                formation[nFormation].rec = forming[e];
+                formation[nFormation].captain = e;
+                formation[nFormation].team = teamOf (st[e]);
+                nFormation += 1;
+            }
+        }
+        cur[e] = st[e];
+    }
+    records += 1;
+}
+
+static int byRecord (const void *a, const void *b)
+{
+    long ra = ((const FORMATION *) a)->rec, rb = ((const FORMATION *) b)->rec;
+
+    return (ra > rb) - (ra < rb);
+}
+
+static void printTable (const char *title, const char *states, int first, int last)
+{
+    char name[8];
+    int e, i;
+
+    printf ("time in state (%s) - %s\n  entity", timed ? "ms" : "records", title);
+    for (i = 0; states[i] != '\0'; i++) {
+        printf (" %10c", states[i]);
+    }
+    printf ("\n");
+    for (e = first; e < last; e++) {
+        entityName (e, name);
+        printf ("  %-6s", name);
+        for (i = 0; states[i] != '\0'; i++) {
+            uint64_t v = inState[(size_t) e * MAXSTATES + (size_t) i];
+
+            if (timed) printf (" %10.3f", (double) v / 1e6);
+            else printf (" %10llu", (unsigned long long) v);
+        }
+        printf ("\n");
+    }
+}
+
+static void printStats (const char *name)
+{
+    char ename[8];
+    long i, late = 0;
+    int e;
+
+    printf ("%s: %ld records, %d players, %d goalies, %d referees\n", name, records, nPlayers, nGoalies, nReferees);
+    for (e = 0; e < n; e++) {
+        if (wasLate[e]) late += 1;
+    }
+    printf ("late arrivals %ld, by %ld entities:", lateArrivals, late);
+    for (e = 0; e < n; e++) {
+        if (wasLate[e]) {
+            entityName (e, ename);
+            printf (" %s", ename);
+        }
+    }
+    printf ("\n");
+
+    qsort (formation, (size_t) nFormation, sizeof (FORMATION), byRecord);
+    printf ("teams formed %ld, in order:\n", nFormation);
+    for (i = 0; i < nFormation; i++) {
+        entityName (formation[i].captain, ename);
+        printf ("  record %8ld  pitch %3d  team %d  captain %s\n", formation[i].rec, pitchOf (formation[i].captain),
+                formation[i].team, ename);
+    }
+    printTable ("players", pgStates, 0, nPlayers);
+    printTable ("goalies", pgStates, nPlayers, nPlayers + nGoalies);
+    printTable ("referees", rfStates, nPlayers + nGoalies, n);
+}
+
+/* tells whether a text line is the header line, and takes the roster from it */
+static bool textHeader (const char *line, size_t len)
+{
+    int count[3] = { 0, 0, 0 };
+    size_t i = 0;
+
+    while (i < len) {
+        if (isspace ((unsigned char) line[i])) {
+            i += 1;
+            continue;
+        }
+        const char *kind = strchr ("PGR", line[i]);
+
+        if ((kind == NULL) || (i + 2 >= len) || !isdigit ((unsigned char) line[i + 1]))
+            return false;
+        count[kind - "PGR"] += 1;
+        for (i += 1; (i < len) && isdigit ((unsigned char) line[i]); i++) ;
+    }
+    if ((count[0] == 0) || (count[1] == 0) || (count[2] == 0)) return false;
+    setRoster (count[0], count[1], count[2]);
+    return true;
+}
+
+/* analyzes one text line */
+static void textLine (const char *line, size_t len)
+{
+    unsigned char st[n > 0 ? n : 1];
+    int m = 0;
+    size_t i;
+
+    if (!header) {
+        if (textHeader (line, len)) {
+            if (filter) printHeaderLines ();
+        }
+        else if (filter) printf ("%.*s\n", (int) len, line);
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        if (isspace ((unsigned char) line[i])) continue;
+        if ((m == n) || ((i + 1 < len) && !isspace ((unsigned char) line[i + 1]))) {
+            m = -1;                                                           /* not a record: shown as it is */
+            break;
+        }
+        st[m++] = (unsigned char) line[i];
+    }
+    if (m == n) record (st, 0);
+    else if (filter) printf ("%.*s\n", (int) len, line);
+}
+
+/* analyzes as much of a chunk of the log as makes whole lines or records; returns the number of bytes used */
+static size_t feed (const char *data, size_t len, bool eof)
+{
+    size_t used = 0;
+
+    if ((records == 0) && !header && !timed && (len >= sizeof (LOGBIN_HEADER)) &&
+        (memcmp (data, LOGBIN_MAGIC, 4) == 0)) {
+        LOGBIN_HEADER hdr;
+
+        memcpy (&hdr, data, sizeof (hdr));
+        if (hdr.version != LOGBIN_VERSION) {
+            fprintf (stderr, "unsupported binary log version %u\n", hdr.version);
+            exit (EXIT_FAILURE);
+        }
+        setRoster (hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+        timed = true;
+        if (filter) {
+            printf ("%21cSoccerGame - Description of the internal state\n\n", ' ');
+            printHeaderLines ();
+        }
+        used = sizeof (hdr);
+    }
+
+    if (timed) {
+        size_t recSize = LOGBIN_RECHDR + (size_t) n;
+        uint64_t ts;
+
+        for (; used + recSize <= len; used += recSize) {
+            memcpy (&ts, data + used + sizeof (uint32_t), sizeof (ts));
+            record ((const unsigned char *) data + used + LOGBIN_RECHDR, ts);
+        }
+        return used;
+    }
+
+    for (;;) {
+        const char *nl = memchr (data + used, '\n', len - used);
+        size_t l;
+
+        if (nl == NULL) {
+            if (!eof || (used == len)) return used;
+            l = len - used;                                                          /* last line, unterminated */
+        }
+        else l = (size_t) (nl - (data + used));
+        textLine (data + used, l);
+        used += (nl == NULL) ? l : l + 1;
+    }
+}
+
+/* analyzes a whole logging file, mapped into memory or, for stdin or a pipe, read in chunks */
+static void analyze (const char *name, int fd)
+{
+    struct stat st;
+    static char buf[IOBUFSIZE];
+    size_t len = 0, used;
+    ssize_t got;
+
+    reset ();
+    if ((fstat (fd, &st) == 0) && S_ISREG (st.st_mode) && (st.st_size > 0)) {
+        void *data = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED) {
+            perror ("error on mapping the log file");
+            exit (EXIT_FAILURE);
+        }
+        madvise (data, (size_t) st.st_size, MADV_SEQUENTIAL);
+        feed (data, (size_t) st.st_size, true);
+        munmap (data, (size_t) st.st_size);
+    }
+    else {
+        while ((got = read (fd, buf + len, sizeof (buf) - len)) > 0) {
+            len += (size_t) got;
+            used = feed (buf, len, false);
+            memmove (buf, buf + used, len - used);
+            len -= used;
+            if (len == sizeof (buf)) {
+                fprintf (stderr, "%s: line too long\n", name);
+                exit (EXIT_FAILURE);
+            }
+        }
+        if (got == -1) {
+            perror ("error on reading log file");
+            exit (EXIT_FAILURE);
+        }
+        feed (buf, len, true);
+    }
+
+    if (!header) {
+        fprintf (stderr, "%s: not a SoccerGame log\n", name);
+        exit (EXIT_FAILURE);
+    }
+    if (stats) printStats (name);
+    if (check) {
+        if (chk.violations > CHK_MAXREPORTED) printf ("... %ld more\n", chk.violations - CHK_MAXREPORTED);
+        printf ("%s: %ld protocol violations\n", name, chk.violations);
+        totalViolations += chk.violations;
+    }
+}
+
+static int getTeamSize (char *arg, char *argv0)
+{
+    char *end;
+    long v = strtol (arg, &end, 0);
+
+    if ((*end != '\0') || (v < 1) || (v > MAXENTITIES / 2)) {
+        fprintf (stderr, "%s: wrong team size \"%s\"\n", argv0, arg);
+        exit (EXIT_FAILURE);
+    }
+    return (int) v;
+}
+
+int main (int argc, char *argv[])
+{
+    int opt, i, fd;
+
+    while ((opt = getopt (argc, argv, "fscP:G:")) != -1) {
+        switch (opt) {
+            case 'f': filter = true; break;
+            case 's': stats = true; break;
+            case 'c': check = true; break;
+            case 'P': nTeamPlayers = getTeamSize (optarg, argv[0]); break;
+            case 'G': nTeamGoalies = getTeamSize (optarg, argv[0]); break;
+            default:
+                fprintf (stderr, "Usage: %s [-f] [-s] [-c] [-P team players] [-G team goalies] [logfile ...]\n",
+                         argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (!stats && !check) filter = true;
+    setvbuf (stdout, NULL, _IOFBF, IOBUFSIZE);
+
+    if (optind == argc) analyze ("stdin", STDIN_FILENO);
+    for (i = optind; i < argc; i++) {
+        if ((fd = open (argv[i], O_RDONLY)) == -1) {
+            perror ("error on opening log file");
+            return EXIT_FAILURE;
+        }
+        analyze (argv[i], fd);
+        close (fd);
+    }
+
+    return (totalViolations == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,167 @@
+/**
+ *  \file logDecode.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Decoder of the compact binary logging format.
+ *
+ *  Reads a logging file written with <tt>probSemSharedMemSoccerGame -b</tt> and prints it in the text layout
+ *  of <tt>saveState</tt>, or in the filtered view of <tt>filter_log.awk</tt>, where a field that did not change
+ *  since the previous line is shown as ".".
+ *
+ *  Usage: logDecode [-f] [-t] [logfile]
+ *    \li -f filtered view
+ *    \li -t prefix each record with its time, in ms since the first record.
+ *
+ *  If no logging file is given, the log is read from stdin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+/** \brief size of the stdio buffers */
+#define  IOBUFSIZE      (1 << 20)
+
+/** \brief width of each field of a text line: a blank, the kind and the digits of the largest id, two at least */
+static int fieldWidth (int nPlayers, int nGoalies, int nReferees)
+{
+    int id = nPlayers - 1, w = 4;
+
+    if (nGoalies - 1 > id) id = nGoalies - 1;
+    if (nReferees > id) id = nReferees;
+    for (id /= 100; id > 0; id /= 10) w++;
+    return w;
+}
+
+/** \brief print a line of fields with the widths used by filter_log.awk (wider for ids of three digits or more) */
+static void printFiltered (char **field, char **prev, int nPlayers, int nGoalies, int nReferees)
+{
+    int n = nPlayers + nGoalies + nReferees;
+    int fw = fieldWidth (nPlayers, nGoalies, nReferees);
+    int i, w;
+
+    for (i = 0; i < n; i++) {
+        /* the first goalie and the first referee are preceded by the group separator */
+        w = ((i == nPlayers) || (i == nPlayers + nGoalies)) ? fw + 1 : fw;
+        if (strcmp (field[i], prev[i]) == 0)
+            printf ("%*s ", w, ".");
+        else printf ("%*s ", w, field[i]);
+        strcpy (prev[i], field[i]);
+    }
+    printf ("\n");
+}
+
+int main (int argc, char *argv[])
+{
+    FILE *in = stdin;                                                                    /* logging file */
+    LOGBIN_HEADER hdr;                                                                        /* file header */
+    bool filter = false,                                                                   /* filtered view */
+         times = false;                                                               /* print timestamps */
+    int opt, n, i, w;
+    size_t recSize;
+    unsigned char *rec;                                                                    /* raw record */
+    char **field, **prev;                                                       /* fields of present line */
+    uint32_t seq;
+    uint64_t ts, ts0 = 0;
+    bool first = true;
+
+    while ((opt = getopt (argc, argv, "ft")) != -1) {
+        switch (opt) {
+            case 'f': filter = true; break;
+            case 't': times = true; break;
+            default:
+                fprintf (stderr, "Usage: %s [-f] [-t] [logfile]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((optind < argc) && ((in = fopen (argv[optind], "rb")) == NULL)) {
+        perror ("error on opening log file");
+        return EXIT_FAILURE;
+    }
+    setvbuf (in, NULL, _IOFBF, IOBUFSIZE);
+    setvbuf (stdout, NULL, _IOFBF, IOBUFSIZE);
+
+    if ((fread (&hdr, sizeof (hdr), 1, in) != 1) || (memcmp (hdr.magic, LOGBIN_MAGIC, sizeof (hdr.magic)) != 0)) {
+        fprintf (stderr, "not a binary SoccerGame log\n");
+        return EXIT_FAILURE;
+    }
+    if (hdr.version != LOGBIN_VERSION) {
+        fprintf (stderr, "unsupported binary log version %u\n", hdr.version);
+        return EXIT_FAILURE;
+    }
+
+    n = hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+    w = fieldWidth (hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+    recSize = LOGBIN_RECHDR + (size_t) n;
+    rec = malloc (recSize);
+    field = malloc ((size_t) n * sizeof (char *));
+    prev = malloc ((size_t) n * sizeof (char *));
+    if ((rec == NULL) || (field == NULL) || (prev == NULL)) {
+        perror ("error on allocating memory");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < n; i++) {
+        field[i] = malloc (8);
+        prev[i] = malloc (8);
+        prev[i][0] = '\0';
+    }
+
+    /* title line + blank line + header line */
+    printf ("%21cSoccerGame - Description of the internal state\n\n", ' ');
+    for (i = 0; i < n; i++) {
+        if (i < hdr.nPlayers) sprintf (field[i], "P%0*d", w - 2, i);
+        else if (i < hdr.nPlayers + hdr.nGoalies) sprintf (field[i], "G%0*d", w - 2, i - hdr.nPlayers);
+        else sprintf (field[i], "R%0*d", w - 2, i - hdr.nPlayers - hdr.nGoalies + 1);
+    }
+    if (filter) {
+        if (times) printf ("%12s ", "");
+        printFiltered (field, prev, hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+    }
+    else {
+        if (times) printf ("%12s", "");
+        for (i = 0; i < n; i++) {
+            if ((i == hdr.nPlayers) || (i == hdr.nPlayers + hdr.nGoalies)) printf (" ");
+            printf (" %s", field[i]);
+        }
+        printf (" \n");
+    }
+
+    /* records */
+    while (fread (rec, recSize, 1, in) == 1) {
+        memcpy (&seq, rec, sizeof (seq));
+        memcpy (&ts, rec + sizeof (seq), sizeof (ts));
+        if (first) {
+            ts0 = ts;
+            first = false;
+        }
+        if (times) printf ("%12.3f ", (double) (ts - ts0) / 1e6);
+
+        if (filter) {
+            for (i = 0; i < n; i++) {
+                field[i][0] = (char) rec[LOGBIN_RECHDR + i];
+                field[i][1] = '\0';
+            }
+            printFiltered (field, prev, hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+        }
+        else {
+            for (i = 0; i < n; i++) {
+                if ((i == hdr.nPlayers) || (i == hdr.nPlayers + hdr.nGoalies)) putchar (' ');
+                printf ("%*c", w, rec[LOGBIN_RECHDR + i]);
+            }
+            putchar ('\n');
+        }
+    }
+
+    if (ferror (in)) {
+        perror ("error on reading log file");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -7,7 +7,28 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li writing the present full state with a given time, in batches
+ *     \li taking a snapshot of the present full state, to be written later outside the critical region
+ *     \li queueing snapshots in a shared memory ring and draining them into the file
+ *     \li flushing and closing the logging file.
+ *
+ *  Each process opens the logging file only once, on first use, and keeps the descriptor until it exits.
+ *  Records are assembled in a user-space buffer and reach the file through a single <tt>write</tt>.
+ *
+ *  Every record has a fixed size and carries a sequence number taken inside the critical region, so on a
+ *  named logging file it is written at its own offset (header size + sequence number * record size) with
+ *  <tt>pwrite</tt>. The line order thus follows the order of the state changes even when the record is
+ *  written after the critical region has been left. On stdout records are written as soon as they are taken.
+ *
+ *  Optionally the log is written in a compact binary format (see LOGBIN_HEADER), one byte per entity state plus
+ *  sequence number and timestamp per record; the <tt>logDecode</tt> tool turns it back into the text layout.
+ *
+ *  A process attached to a log ring does no file work at all: its snapshots are stored in the ring, in shared
+ *  memory, and a single consumer (the generator) drains the ring and writes the lines in batches.
+ *
+ *  A process may also have every record it writes checked against the invariants of the protocol (see
+ *  protoCheck.h): the generator does it on the records it drains, at no cost for the entities.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -16,6 +37,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
 
 #include <sys/types.h>
 #include <unistd.h>
@@ -23,65 +48,327 @@
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+
+/** \brief size of the user-space buffer where log records are assembled */
+#define  LOGBUFSIZE     (1 << 20)
+
+/** \brief access permission of the logging file: user r-w, group and others r */
+#define  LOGMASK        0644
+
+/** \brief descriptor of the logging file (-1 while it is not open) */
+static int logFd = -1;
+
+/** \brief records are written at their own offset (named logging file) instead of at the end of the file */
+static bool logPositional = false;
+
+/** \brief size of the file header in bytes (valid when logPositional is set) */
+static off_t logHeaderSize = 0;
+
+/** \brief records are written in the binary format */
+static bool logBinary = false;
+
+/** \brief user-space buffer where log records are assembled */
+static char logBuf[LOGBUFSIZE];
+
+/** \brief number of bytes in the buffer still waiting to be written */
+static size_t logLen = 0;
+
+/** \brief offset of the records in the buffer written in batches by saveStateAt (-1 when they are appended, or
+           there are none) */
+static off_t logBatchOffset = -1;
+
+/** \brief log ring the thread produces into (NULL when records are written directly); per thread, so that the
+           generator keeps writing its own records while entity threads produce into the ring */
+static _Thread_local LOG_RING *logRing = NULL;
+
+/** \brief checker of the records written by the process (NULL when they are not checked) */
+static PROTO_CHECK *logCheck = NULL;
 
 /* internal functions */
 
-static FILE *openLog(char nFic[], char mode[])
+static size_t printHeader(FULL_STAT *p_fSt);
+
+static void openLog(char nFic[], FULL_STAT *p_fSt, bool truncate)
 {
-    FILE *fic;
-    char *fName;                                                                                      /* log file name */
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+
+    if (logFd != -1) {
+        if (!truncate) return;
+        closeLog ();
+    }
+
+    logBinary = (p_fSt->logFormat == LOG_BINARY);
 
     if ((nFic == NULL) || (strlen (nFic) == 0)) {
-        return stdout;
+        logFd = STDOUT_FILENO;
+        logPositional = false;
     }
     else  {
-        fName = nFic;
+        if (truncate) flags |= O_TRUNC;
+        if ((logFd = open (nFic, flags, LOGMASK)) == -1) {
+            perror ("error on opening log file");
+            exit (EXIT_FAILURE);
+        }
+        logPositional = true;
+
+        /* the header is rebuilt in the (empty) buffer only to learn its size */
+        logHeaderSize = (off_t) printHeader (p_fSt);
+        logLen = 0;
     }
 
-    fprintf(stderr,"%d opening log %s %s\n",getpid(),nFic,mode);
+    static bool registered = false;
+    if (!registered) {
+        atexit (closeLog);
+        registered = true;
+    }
+}
 
-    if ((fic = fopen (fName, mode)) == NULL) {
-        perror ("error on opening log file");
-        exit (EXIT_FAILURE);
+static void flushLogAt(off_t off)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < logLen) {
+        if (off < 0)
+            n = write (logFd, logBuf + done, logLen - done);
+        else n = pwrite (logFd, logBuf + done, logLen - done, off + (off_t) done);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror ("error on writing to log file");
+            exit (EXIT_FAILURE);
+        }
+        done += (size_t) n;
     }
-    return fic;
+    logLen = 0;
 }
 
-static void closeLog(FILE *fic)
+static void putField(int width, char c)
 {
-    if(fic==stderr || fic == stdout) {
-         fflush(fic);
-         return;
+    if (logLen + (size_t) width > LOGBUFSIZE) {
+        fprintf (stderr, "log record does not fit in the buffer\n");
+        exit (EXIT_FAILURE);
     }
 
-    if (fclose (fic) == EOF) {
-        perror ("error on closing of log file");
+    memset (logBuf + logLen, ' ', (size_t) width - 1);
+    logLen += (size_t) width - 1;
+    logBuf[logLen++] = c;
+}
+
+static void putBytes(const void *data, size_t n)
+{
+    if (logLen + n > LOGBUFSIZE) {
+        fprintf (stderr, "log record does not fit in the buffer\n");
         exit (EXIT_FAILURE);
     }
+    memcpy (logBuf + logLen, data, n);
+    logLen += n;
 }
 
-static void printHeader(FILE *fic, FULL_STAT *p_fSt)
+static void putText(const char *txt)
 {
-    
+    putBytes (txt, strlen (txt));
+}
+
+static uint64_t timeStamp(void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ULL + (uint64_t) t.tv_nsec;
+}
+
+/* width of each field of a text line: a blank, the kind of entity and the digits of the largest id, two at least */
+static int fieldWidth(int nPlayers, int nGoalies, int nReferees)
+{
+    int id = nPlayers - 1, w = 4;
+
+    if (nGoalies - 1 > id) id = nGoalies - 1;
+    if (nReferees > id) id = nReferees;
+    for (id /= 100; id > 0; id /= 10) w++;
+    return w;
+}
+
+static size_t printHeader(FULL_STAT *p_fSt)
+{
+    char field[16];
+    size_t start = logLen;
+    int w = fieldWidth (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);
+
+    if (logBinary) {
+        LOGBIN_HEADER hdr;
+
+        memcpy (hdr.magic, LOGBIN_MAGIC, sizeof (hdr.magic));
+        hdr.version = LOGBIN_VERSION;
+        hdr.nPlayers = (uint16_t) p_fSt->nPlayers;
+        hdr.nGoalies = (uint16_t) p_fSt->nGoalies;
+        hdr.nReferees = (uint16_t) p_fSt->nReferees;
+        putBytes (&hdr, sizeof (hdr));
+        return logLen - start;
+    }
+
+    putField (21, ' ');
+    putText ("SoccerGame - Description of the internal state\n\n");
+
     int p;
     for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic, " %s%02d", "P", p);
+        snprintf(field, sizeof(field), " %s%0*d", "P", w - 2, p);
+        putText(field);
     }
 
-    fprintf(fic," ");
+    putText(" ");
 
     int g;
     for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic, " %s%02d", "G", g);
+        snprintf(field, sizeof(field), " %s%0*d", "G", w - 2, g);
+        putText(field);
+    }
+
+    putText(" ");
+
+    int r;
+    for(r=0; r < p_fSt->nReferees; r++) {
+        snprintf(field, sizeof(field), " %s%0*d", "R", w - 2, r + 1);
+        putText(field);
+    }
+
+    putText(" ");
+
+    putText("\n");
+
+    return logLen - start;
+}
+
+static size_t recordSize(int nPlayers, int nGoalies, int nReferees)
+{
+    size_t w;
+
+    if (logBinary) return LOGBIN_RECHDR + (size_t) nPlayers + (size_t) nGoalies + (size_t) nReferees;
+    w = (size_t) fieldWidth (nPlayers, nGoalies, nReferees);
+    return w * (size_t) nPlayers + 1 + w * (size_t) nGoalies + 1 + w * (size_t) nReferees + 1;
+}
+
+static void printState(const unsigned char *st, int nPlayers, int nGoalies, int nReferees, uint32_t seq, uint64_t ts)
+{
+    if (logCheck != NULL) chkRecord (logCheck, st);
+
+    if (logBinary) {
+        putBytes (&seq, sizeof (seq));
+        putBytes (&ts, sizeof (ts));
+        putBytes (st, (size_t) (nPlayers + nGoalies + nReferees));
+        return;
+    }
+
+    int w = fieldWidth (nPlayers, nGoalies, nReferees);
+
+    int p;
+    for(p=0; p < nPlayers; p++) {
+        putField(w, (char) st[p]);
+    }
+
+    putText(" ");
+
+    int g;
+    for(g=0; g < nGoalies; g++) {
+        putField(w, (char) st[nPlayers + g]);
     }
 
-    fprintf(fic," ");
+    putText(" ");
 
-    fprintf(fic," %s%02d","R",1);
+    int r;
+    for(r=0; r < nReferees; r++) {
+        putField(w, (char) st[nPlayers + nGoalies + r]);
+    }
 
-    fprintf(fic," ");
+    putText("\n");
+}
 
-    fprintf(fic,"\n");
+static off_t recordOffset(unsigned int seq, int nPlayers, int nGoalies, int nReferees)
+{
+    return logPositional ? logHeaderSize + (off_t) seq * (off_t) recordSize (nPlayers, nGoalies, nReferees) : -1;
+}
+
+static void writeSnapshot(STATE_SNAPSHOT *snap)
+{
+    printState (snap->st, snap->nPlayers, snap->nGoalies, snap->nReferees, snap->seq, snap->ts);
+    flushLogAt (recordOffset (snap->seq, snap->nPlayers, snap->nGoalies, snap->nReferees));
+}
+
+static LOG_SLOT *ringSlot(LOG_RING *ring, unsigned int pos)
+{
+    return (LOG_SLOT *) (ring->slots + (size_t) (pos & (ring->nSlots - 1)) * ring->slotSize);
+}
+
+static LOG_SLOT *reserveSlot(LOG_RING *ring, unsigned int *pos)
+{
+    LOG_SLOT *slot;
+
+    *pos = atomic_fetch_add_explicit (&ring->tail, 1, memory_order_relaxed);
+    slot = ringSlot (ring, *pos);
+
+    /* wait for the consumer to free the slot if the ring is full */
+    while (atomic_load_explicit (&slot->seq, memory_order_acquire) != *pos) {
+        sched_yield ();
+    }
+    return slot;
+}
+
+static void pushRing(LOG_RING *ring, FULL_STAT *p_fSt, uint64_t ts)
+{
+    STAT *st = &p_fSt->st;
+    unsigned int pos;
+    LOG_SLOT *slot = reserveSlot (ring, &pos);
+    unsigned int e;
+
+    for (e = 0; e < st->nEntities; e++) {
+        slot->st[e] = (unsigned char) st->stat[e];
+    }
+    slot->ts = ts;
+    slot->pitch = (unsigned int) p_fSt->pitch;
+    slot->entity = -1;
+    atomic_store_explicit (&slot->seq, pos + 1, memory_order_release);
+}
+
+static void pushEntity(LOG_RING *ring, FULL_STAT *p_fSt, unsigned int e, unsigned int state, uint64_t ts)
+{
+    unsigned int pos;
+    LOG_SLOT *slot = reserveSlot (ring, &pos);
+
+    slot->st[0] = (unsigned char) state;
+    slot->ts = ts;
+    slot->pitch = (unsigned int) p_fSt->pitch;
+    slot->entity = (int) e;
+    atomic_store_explicit (&slot->seq, pos + 1, memory_order_release);
+}
+
+static unsigned int globalEntity(FULL_STAT *p_fSt, int k, int nP, int nG, int i)
+{
+    int K = p_fSt->nPitches;
+
+    if (i < nP) return (unsigned int) PITCHENTITY (i, K, k);
+    if (i < nP + nG) return (unsigned int) (p_fSt->nPlayers + PITCHENTITY (i - nP, K, k));
+    return (unsigned int) (p_fSt->nPlayers + p_fSt->nGoalies + k);
+}
+
+static void mergeSlot(FULL_STAT *p_fSt, LOG_SLOT *slot, unsigned char *prev)
+{
+    int K = p_fSt->nPitches, k = (int) slot->pitch;
+    int nP = PITCHSHARE (p_fSt->nPlayers, K, k), nG = PITCHSHARE (p_fSt->nGoalies, K, k);
+    int i;
+
+    if (slot->entity >= 0) {
+        p_fSt->st.stat[globalEntity (p_fSt, k, nP, nG, slot->entity)] = slot->st[0];
+        return;
+    }
+
+    /* only the states changed since the previous record of the pitch are merged, so that a pitch record does not
+       undo the change of a single entity recorded outside of the critical region */
+    for (i = 0; i < nP + nG + 1; i++) {
+        if (slot->st[i] != prev[i]) {
+            p_fSt->st.stat[globalEntity (p_fSt, k, nP, nG, i)] = slot->st[i];
+            prev[i] = slot->st[i];
+        }
+    }
 }
 
 /* external functions */
@@ -96,20 +383,20 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
  *       \li a title line
  *       \li a blank line.
  *
+ *  When <tt>p_fSt->logFormat</tt> is LOG_BINARY, the header is a LOGBIN_HEADER and all records are
+ *  written in the binary format.
+ *
  *  \param nFic name of the logging file
  */
 void createLog (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
-
-    fic = openLog(nFic,"w");
+    openLog (nFic, p_fSt, true);
 
-    /* title line + blank line */
+    /* title line + blank line + header line */
 
-    fprintf (fic, "%21cSoccerGame - Description of the internal state\n\n", ' ');
-    printHeader(fic, p_fSt);
+    printHeader (p_fSt);
 
-    closeLog(fic);
+    flushLogAt (logPositional ? 0 : -1);
 }
 
 /**
@@ -127,28 +414,265 @@ void createLog (char nFic[], FULL_STAT *p_fSt)
  */
 void saveState (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
+    STATE_SNAPSHOT snap;
 
-    fic = openLog(nFic,"a");
+    snapshotState (nFic, p_fSt, &snap);
+    saveSnapshot (nFic, &snap);
+}
 
-    int p;
-    for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic,"%4c",p_fSt->st.playerStat[p]);
+/**
+ *  \brief Writing the present full state as a record of a given time, in batches.
+ *
+ *  The record is rendered into the user-space buffer, which is written at the offset of its first record whenever
+ *  it cannot take another one, and by closeLog.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param ts time of the record, in ns
+ */
+void saveStateAt (char nFic[], FULL_STAT *p_fSt, uint64_t ts)
+{
+    int nP = p_fSt->nPlayers, nG = p_fSt->nGoalies, nR = p_fSt->nReferees;
+    static unsigned char *st = NULL;                                                 /* state of all entities, one byte each */
+    unsigned int e;
+
+    openLog (nFic, p_fSt, false);
+    if ((st == NULL) && ((st = malloc (p_fSt->st.nEntities)) == NULL)) {
+        perror ("error on allocating the log state");
+        exit (EXIT_FAILURE);
+    }
+
+    if (logLen + recordSize (nP, nG, nR) > LOGBUFSIZE) {
+        flushLogAt (logBatchOffset);
+    }
+    if (logLen == 0) logBatchOffset = recordOffset (p_fSt->logSeq, nP, nG, nR);
+    for (e = 0; e < p_fSt->st.nEntities; e++) {
+        st[e] = (unsigned char) p_fSt->st.stat[e];
     }
+    printState (st, nP, nG, nR, p_fSt->logSeq, ts);
+    p_fSt->logSeq++;
+}
 
-    fprintf(fic," ");
+/**
+ *  \brief Taking a snapshot of the present full state.
+ *
+ *  Must be called inside the critical region, right after the state change that is to be recorded.
+ *  The state of all entities is copied together with the next sequence number, which fixes the position
+ *  of the record in the logging file. When the log is stdout, the record is written immediately.
+ *  When the process is attached to a log ring, the state is stored in the next position of the ring instead.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+void snapshotState (char nFic[], FULL_STAT *p_fSt, STATE_SNAPSHOT *snap)
+{
+    if (logRing != NULL) {
+        pushRing (logRing, p_fSt, timeStamp ());
+        snap->pending = false;
+        return;
+    }
 
-    int g;
-    for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic,"%4c",p_fSt->st.goalieStat[g]);
+    openLog (nFic, p_fSt, false);
+
+    snap->seq = p_fSt->logSeq++;
+    snap->nPlayers = p_fSt->nPlayers;
+    snap->nGoalies = p_fSt->nGoalies;
+    snap->nReferees = p_fSt->nReferees;
+    if ((snap->st = malloc (p_fSt->st.nEntities)) == NULL) {
+        perror ("error on allocating the log snapshot");
+        exit (EXIT_FAILURE);
+    }
+    for (unsigned int e = 0; e < p_fSt->st.nEntities; e++) {
+        snap->st[e] = (unsigned char) p_fSt->st.stat[e];
+    }
+    snap->ts = timeStamp ();
+    snap->pending = logPositional;
+
+    if (!snap->pending) {
+        writeSnapshot (snap);
+        free (snap->st);
+    }
+}
+
+/**
+ *  \brief Recording a change of the state of a single entity made outside of the critical region.
+ *
+ *  The record carries only the new state of the entity, which is merged into the state of all entities when it
+ *  is drained; <tt>p_fSt</tt> is not changed. Without a log ring there is no way to place the record without the
+ *  critical region, so the process fails.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the pitch of the entity
+ *  \param e index of the entity in the state of the pitch
+ *  \param state new state of the entity
+ */
+void snapshotEntity (char nFic[], FULL_STAT *p_fSt, unsigned int e, unsigned int state)
+{
+    if (logRing == NULL) {
+        fprintf (stderr, "a change of state outside of the critical region needs a log ring (%s)\n", nFic);
+        exit (EXIT_FAILURE);
+    }
+    pushEntity (logRing, p_fSt, e, state, timeStamp ());
+}
+
+/**
+ *  \brief Writing a snapshot previously taken as a single line of the logging file.
+ *
+ *  May be called outside the critical region: the line is placed according to its sequence number.
+ *  Nothing is done if the record was already written when the snapshot was taken.
+ *
+ *  \param nFic name of the logging file (unused: the record goes to the file the process opened)
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+void saveSnapshot (char nFic[], STATE_SNAPSHOT *snap)
+{
+    (void) nFic;
+
+    if (!snap->pending) return;
+
+    writeSnapshot (snap);
+    free (snap->st);
+    snap->pending = false;
+}
+
+/**
+ *  \brief Checking the protocol on every record the process writes from then on.
+ *
+ *  Records are checked in the order they are rendered, which is the order of the file for the records drained
+ *  from a log ring and those written by the generator; it is meant for the consumer of the ring.
+ *
+ *  \param chk pointer to the checker, initialized for the roster of the log (NULL to stop checking)
+ */
+void checkLog (PROTO_CHECK *chk)
+{
+    logCheck = chk;
+}
+
+/**
+ *  \brief Flushing and closing the logging file.
+ *
+ *  Any buffered bytes are written before the descriptor is released, at their own offset when they are records
+ *  written in batches by saveStateAt. The function is registered with
+ *  <tt>atexit</tt> on first use of the log, so it runs at process exit; calling it explicitly is harmless.
+ */
+void closeLog (void)
+{
+    if (logFd == -1) return;
+
+    if (logLen > 0) flushLogAt (logBatchOffset);
+    logBatchOffset = -1;
+    if ((logFd != STDOUT_FILENO) && (close (logFd) == -1)) {
+        perror ("error on closing of log file");
     }
+    logFd = -1;
+}
 
-    fprintf(fic," ");
+/**
+ *  \brief Size of a log ring for a given number of intervening entities.
+ *
+ *  The ring has up to LOGRING_SLOTS slots, fewer for large rosters so that it stays within LOGRING_BYTES.
+ *
+ *  \param nEntities largest number of intervening entities in a pitch
+ *
+ *  \return size of the ring in bytes
+ */
+size_t logRingSize (unsigned int nEntities)
+{
+    size_t slotSize = (sizeof (LOG_SLOT) + nEntities + CACHELINE - 1) & ~(size_t) (CACHELINE - 1);
+    size_t nSlots = LOGRING_SLOTS;
 
-    fprintf(fic,"%4c",p_fSt->st.refereeStat);
+    while ((nSlots > 16) && (nSlots * slotSize > LOGRING_BYTES)) {
+        nSlots /= 2;
+    }
+    return sizeof (LOG_RING) + nSlots * slotSize;
+}
 
-    fprintf(fic,"\n");
+/**
+ *  \brief Initialization of a log ring, to be done once by its consumer before any producer attaches to it.
+ *
+ *  \param ring pointer to the log ring, with at least <tt>logRingSize (nEntities)</tt> bytes
+ *  \param nEntities largest number of intervening entities in a pitch
+ */
+void initLogRing (LOG_RING *ring, unsigned int nEntities)
+{
+    unsigned int i;
 
-    closeLog(fic);
+    ring->slotSize = (unsigned int) ((sizeof (LOG_SLOT) + nEntities + CACHELINE - 1) & ~(size_t) (CACHELINE - 1));
+    ring->nSlots = (unsigned int) ((logRingSize (nEntities) - sizeof (LOG_RING)) / ring->slotSize);
+    for (i = 0; i < ring->nSlots; i++) {
+        atomic_init (&ringSlot (ring, i)->seq, i);
+    }
+    ring->head = 0;
+    atomic_init (&ring->tail, 0);
 }
 
+/**
+ *  \brief Attaching the calling thread to a log ring as a producer.
+ *
+ *  \param ring pointer to the log ring
+ */
+void attachLogRing (LOG_RING *ring)
+{
+    logRing = ring;
+}
+
+/**
+ *  \brief Draining the records available in a log ring into the logging file.
+ *
+ *  Records are taken in position order: the state of the pitch each one carries, or the state of the single entity,
+ *  is merged into the state of all entities, which is rendered into the user-space buffer, written whenever it cannot take another line and once
+ *  more at the end. Each drained record is freed for the producer that will reuse its slot.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the state of all entities of all pitches, updated with the drained records
+ *  \param ring pointer to the log ring
+ *
+ *  \return number of records written
+ */
+unsigned int drainLog (char nFic[], FULL_STAT *p_fSt, LOG_RING *ring)
+{
+    int nP = p_fSt->nPlayers, nG = p_fSt->nGoalies, nR = p_fSt->nReferees;
+    size_t recSize;
+    unsigned int n = 0;
+    unsigned int first = p_fSt->logSeq;                                        /* record number of the first line in the buffer */
+    static unsigned char *st = NULL;                                                 /* state of all entities, one byte each */
+    static unsigned char *prev = NULL;                        /* state carried by the previous record of each pitch */
+    unsigned int e;
+
+    openLog (nFic, p_fSt, false);
+    recSize = recordSize (nP, nG, nR);
+    if ((st == NULL) && ((st = malloc (p_fSt->st.nEntities)) == NULL)) {
+        perror ("error on allocating the log state");
+        exit (EXIT_FAILURE);
+    }
+    if ((prev == NULL) && ((prev = calloc ((size_t) p_fSt->nPitches, ring->slotSize)) == NULL)) {
+        perror ("error on allocating the log state");
+        exit (EXIT_FAILURE);
+    }
+
+    for (;;) {
+        LOG_SLOT *slot = ringSlot (ring, ring->head);
+
+        if (atomic_load_explicit (&slot->seq, memory_order_acquire) != ring->head + 1) break;
+
+        if (logLen + recSize > LOGBUFSIZE) {
+            flushLogAt (recordOffset (first, nP, nG, nR));
+            first = p_fSt->logSeq;
+        }
+        mergeSlot (p_fSt, slot, prev + (size_t) slot->pitch * ring->slotSize);
+        for (e = 0; e < p_fSt->st.nEntities; e++) {
+            st[e] = (unsigned char) p_fSt->st.stat[e];
+        }
+        printState (st, nP, nG, nR, p_fSt->logSeq, slot->ts);
+        p_fSt->logSeq++;
+
+        atomic_store_explicit (&slot->seq, ring->head + ring->nSlots, memory_order_release);
+        ring->head++;
+        n++;
+    }
+
+    if (logLen > 0) flushLogAt (recordOffset (first, nP, nG, nR));
+
+    return n;
+}
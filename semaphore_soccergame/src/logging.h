@@ -7,7 +7,11 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li writing the present full state with a given time, in batches
+ *     \li taking a snapshot of the present full state, to be written later outside the critical region
+ *     \li queueing snapshots in a shared memory ring and draining them into the file
+ *     \li flushing and closing the logging file.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -15,7 +19,115 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
 #include "probDataStruct.h"
+#include "protoCheck.h"
+
+/** \brief log records written as text lines */
+#define  LOG_TEXT         0
+/** \brief log records written in the compact binary format */
+#define  LOG_BINARY       1
+
+/** \brief magic number at the start of a binary logging file */
+#define  LOGBIN_MAGIC     "SGLB"
+/** \brief version of the binary logging format */
+#define  LOGBIN_VERSION   1
+/** \brief size of the fixed part of a binary record: sequence number (4 bytes) + timestamp (8 bytes) */
+#define  LOGBIN_RECHDR    12
+
+/**
+ *  \brief Definition of <em>binary logging file header</em> data type.
+ *
+ *  The header is followed by fixed-size records made of
+ *     \li the sequence number of the record (uint32_t)
+ *     \li the time the state was recorded, in ns of CLOCK_MONOTONIC (uint64_t)
+ *     \li one byte per entity with its state: players, goalies and referees, in this order.
+ *
+ *  All fields are in host byte order and without padding.
+ */
+typedef struct {
+    /** \brief magic number, LOGBIN_MAGIC */
+    char magic[4];
+    /** \brief format version, LOGBIN_VERSION */
+    uint16_t version;
+    /** \brief total number of players */
+    uint16_t nPlayers;
+    /** \brief total number of goalies */
+    uint16_t nGoalies;
+    /** \brief total number of referees */
+    uint16_t nReferees;
+} LOGBIN_HEADER;
+
+/** \brief upper bound for the number of slots in the log ring */
+#define  LOGRING_SLOTS    1024
+/** \brief upper bound for the memory taken by the slots of the log ring (in bytes) */
+#define  LOGRING_BYTES    (4 << 20)
+
+/**
+ *  \brief Definition of <em>log ring slot</em> data type.
+ */
+typedef struct {
+    /** \brief slot position: equal to p while free for position p, p+1 once the record for position p is stored */
+    atomic_uint seq;
+    /** \brief time of the record, in ns of CLOCK_MONOTONIC */
+    uint64_t ts;
+    /** \brief pitch the record comes from */
+    unsigned int pitch;
+    /** \brief entity of that pitch whose state alone the record carries, or -1 when it carries the state of all of
+               them (see snapshotEntity) */
+    int entity;
+    /** \brief state of the entities of that pitch at the time of the record, one byte each (only the first one
+               when the record carries the state of a single entity) */
+    unsigned char st[];
+} LOG_SLOT;
+
+/**
+ *  \brief Definition of <em>log ring</em> data type.
+ *
+ *  Multi-producer single-consumer ring of fixed-size binary state records, kept in shared memory.
+ *  Producers reserve a position with an atomic fetch-add on <tt>tail</tt>; the single consumer merges the
+ *  state of the pitch carried by each record into the state of all entities and renders it in position order.
+ *  The slot size depends on the number of entities of a pitch, so the ring is sized with <tt>logRingSize</tt>.
+ *  The read-only sizes, the position of the producers, the position of the consumer and each slot start a cache
+ *  line of their own, so that producers storing adjacent records do not share lines.
+ */
+typedef struct {
+    /** \brief number of slots (power of two) */
+    unsigned int nSlots;
+    /** \brief size of each slot in bytes (a whole number of cache lines) */
+    unsigned int slotSize;
+    /** \brief next position to be reserved by a producer */
+    _Alignas (CACHELINE) atomic_uint tail;
+    /** \brief next position to be drained by the consumer */
+    _Alignas (CACHELINE) unsigned int head;
+    /** \brief record slots */
+    _Alignas (CACHELINE) unsigned char slots[];
+} LOG_RING;
+
+/**
+ *  \brief Definition of <em>snapshot of the state of the intervening entities</em> data type.
+ *
+ *  It is taken inside the critical region and written to the logging file after leaving it.
+ */
+typedef struct {
+    /** \brief sequence number of the record, defines its position in the logging file */
+    unsigned int seq;
+    /** \brief time of the record, in ns of CLOCK_MONOTONIC */
+    uint64_t ts;
+    /** \brief total number of players */
+    int nPlayers;
+    /** \brief total number of goalies */
+    int nGoalies;
+    /** \brief total number of referees */
+    int nReferees;
+    /** \brief copy of the state of all intervening entities, one byte each (allocated by snapshotState) */
+    unsigned char *st;
+    /** \brief record still has to be written */
+    bool pending;
+} STATE_SNAPSHOT;
 
 /**
  *  \brief File initialization.
@@ -27,6 +139,9 @@
  *       \li a title line
  *       \li a blank line.
  *
+ *  When <tt>p_fSt->logFormat</tt> is LOG_BINARY, the header is a LOGBIN_HEADER and all records are
+ *  written in the binary format.
+ *
  *  \param nFic name of the logging file
  */
 extern void createLog (char nFic[], FULL_STAT *p_fSt);
@@ -41,4 +156,111 @@ extern void createLog (char nFic[], FULL_STAT *p_fSt);
  */
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief Writing the present full state as a record of a given time, in batches.
+ *
+ *  Meant for a process that is the only writer of the log and takes no snapshots (the event engine, whose
+ *  records carry virtual time): the record gets the next sequence number and is written with the records that
+ *  follow it, once the buffer cannot take another one or when the log is closed.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param ts time of the record, in ns
+ */
+extern void saveStateAt (char nFic[], FULL_STAT *p_fSt, uint64_t ts);
+
+/**
+ *  \brief Taking a snapshot of the present full state.
+ *
+ *  Must be called inside the critical region, right after the state change that is to be recorded.
+ *  The snapshot gets the next sequence number, so the total order of the records is preserved.
+ *  When the log is stdout, the record is written immediately.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+extern void snapshotState (char nFic[], FULL_STAT *p_fSt, STATE_SNAPSHOT *snap);
+
+/**
+ *  \brief Recording a change of the state of a single entity made outside of the critical region.
+ *
+ *  The calling thread must be attached to a log ring. The record carries only the new state of the entity, which
+ *  is merged into the state of all entities when it is drained; <tt>p_fSt</tt> is not changed, and the records
+ *  of the whole pitch taken later do not undo the change while they leave the state of that entity as it was.
+ *  It is meant for entities that leave the match right away (late players and goalies) and do not change their
+ *  state again before the next match.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the pitch of the entity
+ *  \param e index of the entity in the state of the pitch
+ *  \param state new state of the entity
+ */
+extern void snapshotEntity (char nFic[], FULL_STAT *p_fSt, unsigned int e, unsigned int state);
+
+/**
+ *  \brief Writing a snapshot previously taken as a single line of the logging file.
+ *
+ *  Meant to be called after leaving the critical region.
+ *
+ *  \param nFic name of the logging file
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+extern void saveSnapshot (char nFic[], STATE_SNAPSHOT *snap);
+
+/**
+ *  \brief Checking the protocol on every record the process writes from then on.
+ *
+ *  \param chk pointer to the checker, initialized for the roster of the log (NULL to stop checking)
+ */
+extern void checkLog (PROTO_CHECK *chk);
+
+/**
+ *  \brief Flushing and closing the logging file.
+ *
+ *  Any buffered bytes are written before the descriptor is released.
+ *  Registered with <tt>atexit</tt> on first use of the log, so it runs at process exit.
+ */
+extern void closeLog (void);
+
+/**
+ *  \brief Size of a log ring for a given number of intervening entities.
+ *
+ *  \param nEntities largest number of intervening entities in a pitch
+ *
+ *  \return size of the ring in bytes
+ */
+extern size_t logRingSize (unsigned int nEntities);
+
+/**
+ *  \brief Initialization of a log ring, to be done once by its consumer before any producer attaches to it.
+ *
+ *  \param ring pointer to the log ring, with at least <tt>logRingSize (nEntities)</tt> bytes
+ *  \param nEntities largest number of intervening entities in a pitch
+ */
+extern void initLogRing (LOG_RING *ring, unsigned int nEntities);
+
+/**
+ *  \brief Attaching the calling thread to a log ring as a producer.
+ *
+ *  From then on <tt>snapshotState</tt> stores the snapshot in the ring instead of writing it to the
+ *  logging file, and <tt>saveSnapshot</tt> has nothing left to do.
+ *
+ *  \param ring pointer to the log ring
+ */
+extern void attachLogRing (LOG_RING *ring);
+
+/**
+ *  \brief Draining the records available in a log ring into the logging file.
+ *
+ *  Only one process may drain a given ring. Records are rendered in position order and written in batches.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the state of all entities of all pitches, updated with the drained records
+ *  \param ring pointer to the log ring
+ *
+ *  \return number of records written
+ */
+extern unsigned int drainLog (char nFic[], FULL_STAT *p_fSt, LOG_RING *ring);
+
 #endif /* LOGGING_H_ */
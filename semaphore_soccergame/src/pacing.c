@@ -0,0 +1,100 @@
+/**
+ *  \file pacing.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Pacing delays of the intervening entities.
+ *
+ *  The generator of each entity is a splitmix64 sequence, kept per thread so that the thread engine draws the same
+ *  delays as the process engine; the event engine keeps one per entity object, and draws them again.
+ *
+ *  Defined operations:
+ *     \li seeding the generator of the calling entity
+ *     \li pausing for a scaled random time
+ *     \li seeding the generator of an entity object, and drawing its delays.
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include "pacing.h"
+#include "ipcPool.h"
+
+/** \brief delay generator of the calling entity */
+static _Thread_local PACER self = { 0, 1.0 };
+
+/* internal functions */
+
+static uint64_t next(PACER *p)
+{
+    uint64_t z = (p->state += 0x9e3779b97f4a7c15u);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+/* scaled delay in [base, base + range) us */
+static double draw(PACER *p, double base, double range)
+{
+    double u = (double) (next (p) >> 11) / (double) (1ull << 53);             /* uniform in [0, 1) */
+
+    return p->scale * (range * u + base);
+}
+
+/* external functions */
+
+/**
+ *  \brief Seeding the delay generator of the calling process or thread.
+ *
+ *  \param seed seed of the run
+ *  \param timeScale factor applied to every delay (0 for none)
+ *  \param entity entity id, unique over all kinds of entities (its column in the log)
+ */
+void pacingInit (unsigned int seed, double timeScale, unsigned int entity)
+{
+    pacerInit (&self, seed, timeScale, entity);
+}
+
+/**
+ *  \brief Pausing for a random time, uniformly distributed in <tt>[base, base + range)</tt> us before scaling.
+ *
+ *  \param base shortest delay, in us
+ *  \param range width of the interval of delays, in us
+ */
+void pace (double base, double range)
+{
+    double us = draw (&self, base, range);
+
+    if (self.scale > 0.0) usleep ((useconds_t) us);
+    if (ipcStale ()) ipcLeave ();                   /* a later run started in the IPC pool while the entity slept */
+}
+
+/**
+ *  \brief Seeding the delay generator of an entity object, as pacingInit seeds that of the calling entity.
+ *
+ *  \param p pointer to the generator
+ *  \param seed seed of the run
+ *  \param timeScale factor applied to every delay (0 for none)
+ *  \param entity entity id, unique over all kinds of entities (its column in the log)
+ */
+void pacerInit (PACER *p, unsigned int seed, double timeScale, unsigned int entity)
+{
+    p->state = ((uint64_t) seed << 32) | entity;
+    p->state = next (p);
+    p->scale = timeScale;
+}
+
+/**
+ *  \brief Drawing the next delay of an entity object, the one <tt>pace</tt> would pause for.
+ *
+ *  \param p pointer to the generator
+ *  \param base shortest delay, in us
+ *  \param range width of the interval of delays, in us
+ *
+ *  \return scaled delay, in ns
+ */
+uint64_t pacerDelay (PACER *p, double base, double range)
+{
+    return (uint64_t) (draw (p, base, range) * 1e3);
+}
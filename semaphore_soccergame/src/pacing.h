@@ -0,0 +1,75 @@
+/**
+ *  \file pacing.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Pacing delays of the intervening entities.
+ *
+ *  Entities pause for a random time while arriving and while the referee plays the match. Each entity draws its
+ *  delays from its own generator, seeded from the seed of the run and the entity id, so that a run can be repeated
+ *  with the same delays whatever the process ids or the thread schedule; all delays are multiplied by the time scale
+ *  of the run, and a time scale of 0 removes them so that only the synchronization paths are exercised.
+ *
+ *  Defined operations:
+ *     \li seeding the generator of the calling entity
+ *     \li pausing for a scaled random time
+ *     \li seeding the generator of an entity object, and drawing its delays (for the event engine, whose entities
+ *         do not pause but are woken in virtual time).
+ */
+
+#ifndef PACING_H_
+#define PACING_H_
+
+#include <stdint.h>
+
+/**
+ *  \brief Definition of <em>delay generator</em> data type.
+ */
+typedef struct {
+    /** \brief state of the splitmix64 sequence */
+    uint64_t state;
+    /** \brief factor applied to every delay (0 for none) */
+    double scale;
+} PACER;
+
+/**
+ *  \brief Seeding the delay generator of the calling process or thread.
+ *
+ *  \param seed seed of the run
+ *  \param timeScale factor applied to every delay (0 for none)
+ *  \param entity entity id, unique over all kinds of entities (its column in the log)
+ */
+extern void pacingInit (unsigned int seed, double timeScale, unsigned int entity);
+
+/**
+ *  \brief Pausing for a random time, uniformly distributed in <tt>[base, base + range)</tt> us before scaling.
+ *
+ *  A stale entity of the IPC pool (see ipcPool.h) ends once the pause is over.
+ *
+ *  \param base shortest delay, in us
+ *  \param range width of the interval of delays, in us
+ */
+extern void pace (double base, double range);
+
+/**
+ *  \brief Seeding the delay generator of an entity object, as pacingInit seeds that of the calling entity.
+ *
+ *  \param p pointer to the generator
+ *  \param seed seed of the run
+ *  \param timeScale factor applied to every delay (0 for none)
+ *  \param entity entity id, unique over all kinds of entities (its column in the log)
+ */
+extern void pacerInit (PACER *p, unsigned int seed, double timeScale, unsigned int entity);
+
+/**
+ *  \brief Drawing the next delay of an entity object, the one <tt>pace</tt> would pause for.
+ *
+ *  \param p pointer to the generator
+ *  \param base shortest delay, in us
+ *  \param range width of the interval of delays, in us
+ *
+ *  \return scaled delay, in ns
+ */
+extern uint64_t pacerDelay (PACER *p, double base, double range);
+
+#endif /* PACING_H_ */
@@ -11,20 +11,36 @@
 #ifndef PROBCONST_H_
 #define PROBCONST_H_
 
-/* Generic parameters */
+/* Generic parameters (defaults, the generator may change them on the command line) */
  
 /** \brief total number of players */
 #define  NUMPLAYERS       10
 /** \brief total number of goalies */
 #define  NUMGOALIES        3
-/** \brief total number of referees */
+/** \brief number of referees in each pitch */
 #define  NUMREFEREES       1
 
+/** \brief number of pitches where matches are played at the same time */
+#define  NUMPITCHES        1
+
 /** \brief number of players in each team */
 #define  NUMTEAMPLAYERS     4
 /** \brief number of goalies in teach team */
 #define  NUMTEAMGOALIES     1
 
+/** \brief number of teams in each match */
+#define  NUMTEAMS           2
+
+/** \brief upper bound for the total number of players or goalies */
+#define  MAXENTITIES    10000
+/** \brief upper bound for the number of pitches */
+#define  MAXPITCHES      1000
+/** \brief upper bound for the factor applied to the delays of the entities */
+#define  MAXTIMESCALE     100
+
+/** \brief size of a cache line (in bytes): data written by different entities is kept in different lines */
+#define  CACHELINE         64
+
 
 /* Player/Goalie state constants */
 
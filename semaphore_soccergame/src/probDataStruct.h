@@ -14,29 +14,39 @@
 #define PROBDATASTRUCT_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
 
 #include "probConst.h"
 
 /**
  *  \brief Definition of <em>state of the intervening entities</em> data type.
+ *
+ *  The number of entities is only known at run time, so the states are kept in a flexible array:
+ *  players first, then goalies, then referees. Use PLAYERSTAT, GOALIESTAT and REFEREESTAT to reach them, and the
+ *  operations of stateSeq.h to change them.
  */
 typedef struct {
-    /** \brief players state */
-    unsigned int playerStat[NUMPLAYERS];
-    /** \brief goalies state */
-    unsigned int goalieStat[NUMGOALIES];
-    /** \brief referees state */
-    unsigned int refereeStat;
+    /** \brief total number of intervening entities (players + goalies + referees) */
+    unsigned int nEntities;
+    /** \brief sequence lock of the states: odd while they are being changed, twice the number of changes made
+               otherwise (see stateSeq.h) */
+    atomic_uint seq;
+    /** \brief state of each entity */
+    unsigned int stat[];
 
 } STAT;
 
 
 /**
  *  \brief Definition of <em>full state of the problem</em> data type.
+ *
+ *  It ends with the flexible array of states, so it must be the last member of any enclosing structure
+ *  and its size is given by FULL_STAT_SIZE. The configuration, the counters and the states start each in a
+ *  cache line of their own.
  */
 typedef struct
-{   /** \brief state of all intervening entities */
-    STAT st;
+{   /* configuration of the run, written by the generator before the entities start and read-only afterwards */
 
     /** \brief total number of players */
     int nPlayers;
@@ -47,10 +57,37 @@ typedef struct
     /** \brief total number of referees */
     int nReferees;
 
-    /** \brief number of players that already arrived */
-    int playersArrived;
-    /** \brief number of goalies that already arrived */
-    int goaliesArrived;
+    /** \brief number of players in each team */
+    int nTeamPlayers;
+
+    /** \brief number of goalies in each team */
+    int nTeamGoalies;
+
+    /** \brief number of pitches */
+    int nPitches;
+    /** \brief pitch whose state is described (-1 for the state of all entities, as seen by the log) */
+    int pitch;
+
+    /** \brief format of the log records (LOG_TEXT or LOG_BINARY, see logging.h) */
+    int logFormat;
+
+    /** \brief number of matches of the tournament - initial value=1 */
+    int nMatches;
+
+    /** \brief seed of the delay generators of the entities (see pacing.h) */
+    unsigned int seed;
+    /** \brief factor applied to the delays of the entities while arriving and playing (0 for no delays) */
+    double timeScale;
+    /** \brief largest number of polls of a semaphore before blocking in the waits that spin (see latency.h) */
+    unsigned int spin;
+
+    /* counters updated by the entities, in a cache line of their own so that writing them does not evict the
+       configuration from the caches of the readers */
+
+    /** \brief number of players that already arrived (arrival tickets, taken without the critical region) */
+    _Alignas (CACHELINE) atomic_int playersArrived;
+    /** \brief number of goalies that already arrived (arrival tickets, taken without the critical region) */
+    atomic_int goaliesArrived;
     /** \brief number of players that arrived and are free (no team) */
     int playersFree;
     /** \brief number of goalies that arrived and are free (no team) */
@@ -60,7 +97,42 @@ typedef struct
     /** \brief id of team that will be formed next - initial value=1 */    
     int teamId;
 
+    /** \brief number of log records already taken (sequence number of the next record) - initial value=0 */
+    unsigned int logSeq;
+
+    /** \brief number of the match being played - initial value=0 */
+    int match;
+    /** \brief number of entities that finished the present match */
+    int matchDone;
+    /** \brief number of entities that went through the first turnstile between matches */
+    int matchReady;
+
+    /** \brief state of all intervening entities, from a cache line of its own */
+    _Alignas (CACHELINE) STAT st;
+
 } FULL_STAT;
 
+/* the configuration fits in the first cache line, and the counters in the second one */
+_Static_assert (offsetof (FULL_STAT, playersArrived) == CACHELINE, "FULL_STAT configuration must take one cache line");
+_Static_assert (offsetof (FULL_STAT, st) == 2 * CACHELINE, "FULL_STAT counters must take one cache line");
+
+/** \brief size in bytes of a FULL_STAT for <tt>n</tt> intervening entities */
+#define  FULL_STAT_SIZE(n)         (sizeof (FULL_STAT) + (size_t) (n) * sizeof (unsigned int))
+
+/** \brief state of player <tt>id</tt> */
+#define  PLAYERSTAT(p_fSt, id)     ((p_fSt)->st.stat[(id)])
+/** \brief state of goalie <tt>id</tt> */
+#define  GOALIESTAT(p_fSt, id)     ((p_fSt)->st.stat[(p_fSt)->nPlayers + (id)])
+/** \brief state of referee <tt>id</tt> */
+#define  REFEREESTAT(p_fSt, id)    ((p_fSt)->st.stat[(p_fSt)->nPlayers + (p_fSt)->nGoalies + (id)])
+
+/* Players and goalies are dealt round-robin over the pitches: entity id of a kind plays in pitch id % K, where it
+   is entity id / K of that kind; referee k is the referee of pitch k. */
+
+/** \brief number of the <tt>n</tt> entities of a kind playing in pitch <tt>k</tt> out of <tt>K</tt> */
+#define  PITCHSHARE(n, K, k)       (((n) - (k) + (K) - 1) / (K))
+/** \brief id, among all entities of its kind, of entity <tt>i</tt> of that kind in pitch <tt>k</tt> out of <tt>K</tt> */
+#define  PITCHENTITY(i, K, k)      ((i) * (K) + (k))
+
 
 #endif /* PROBDATASTRUCT_H_ */
@@ -11,6 +11,55 @@
  *  Upon execution, one parameter is requested:
  *    \li name of the logging file.
  *
+ *  Options:
+ *    \li -b write the log in the compact binary format (see logDecode)
+ *    \li -p n total number of players (default NUMPLAYERS)
+ *    \li -g n total number of goalies (default NUMGOALIES)
+ *    \li -P n number of players in each team (default NUMTEAMPLAYERS)
+ *    \li -G n number of goalies in each team (default NUMTEAMGOALIES)
+ *    \li -m n number of matches of the tournament played by the same processes (default 1)
+ *    \li -k n number of pitches, each with its own referee, where matches are played at the same time
+ *             (default NUMPITCHES); players and goalies are dealt round-robin over the pitches
+ *    \li -l file merge the latency histograms of the run into a histogram file (created if missing)
+ *    \li -f fast startup: the IPC resources are private and their identifiers are passed on the command line to the
+ *         entity processes, generated with <tt>posix_spawn</tt>, which attach them without a key nor a look up
+ *    \li -t run the entities as threads of the generator, sharing its semaphore set and shared region, instead
+ *         of generating one process per entity
+ *    \li -s n seed of the delay generators of the entities (default: the process id), so that a run can be repeated
+ *             with the same delays
+ *    \li -x f factor applied to the delays of the entities while arriving and playing (default 1)
+ *    \li -z no pacing, the same as <tt>-x 0</tt>: entities do not pause, so that only synchronization is measured
+ *    \li -r file append a benchmark record of the run to a report file (see writeReport)
+ *    \li -d ms deadline of every match (default none): when a match of some pitch does not end in time, the entities
+ *             are killed, the IPC resources destroyed and the generator ends with EXIT_FAILURE
+ *    \li -c check the invariants of the protocol on every record written (see protoCheck.h); violations are
+ *         reported on stderr and make the generator end with EXIT_FAILURE
+ *    \li -a policy pin every entity to a processor (see affinity.h): <tt>pack</tt> all on a single package,
+ *             <tt>spread</tt> one per core or <tt>referee</tt> every referee on a core of its own; the shared region
+ *             is bound to the memory node of the entities
+ *    \li -F referees run with the real-time scheduling policy SCHED_FIFO
+ *    \li -w n the waits of the handoffs between entities and of the critical region poll their semaphore up to n
+ *        times before blocking (default 0, see semDownSpin), which pays when entities have idle cores to run on
+ *    \li -e n run the entities as state machines of the generator, in virtual time, on a pool of n worker threads
+ *             (see eventEngine.h), instead of generating one process or thread per entity; neither semaphores nor
+ *             shared memory are created, and the log has the same format, with timestamps counted from the start
+ *    \li -n no log (only with <tt>-e</tt>): records are only checked, with <tt>-c</tt>, since each one carries the
+ *         state of every entity
+ *    \li -u IPC pool: the shared region and the semaphore set are kept once the run ends, and those left by a previous
+ *         run are reset in place instead of created anew (see ipcPool.h), so that a batch of runs creates them once
+ *         and a run that crashed does not make the next one fail
+ *    \li -M profile the contention of the critical region of each pitch: the time every call site waited for it and
+ *         held it is recorded (see lockProf.h), and ranked by total hold time once the run ends.
+ *
+ *  Once all entities have ended, a summary of the time they spent in each phase of the protocol is printed on
+ *  stderr (see latency.h). With <tt>-l file</tt> the latency histograms of the run are also merged into a histogram
+ *  file, so that they can be accumulated over many runs. With <tt>-M</tt> the contention profile of the critical
+ *  regions, merged over all pitches, follows it.
+ *  With <tt>-r file</tt> the times of the run and the latencies of its phases are appended to a benchmark report
+ *  (see run/bench.sh, driven by <tt>make bench</tt>).
+ *  Entity processes are reaped as they end (see supervisor.h); those that do not end successfully are reported on
+ *  stderr, and make the generator end with EXIT_FAILURE.
+ *
  *  \author Nuno Lau - December 2024
  */
 
@@ -22,7 +71,14 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <spawn.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -30,6 +86,16 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entity.h"
+#include "pacing.h"
+#include "entitySlot.h"
+#include "stateSeq.h"
+#include "supervisor.h"
+#include "affinity.h"
+#include "taskPool.h"
+#include "eventEngine.h"
+#include "ipcPool.h"
+#include "lockProf.h"
 
 /** \brief name of player program */
 #define   PLAYER               "./player"
@@ -40,9 +106,71 @@
 /** \brief name of referee program */
 #define   REFEREE              "./referee"
 
-void launch_processes(char *bin, char *prefix, int nProc, char *logFilename, int *pids)
+/** \brief pause between polls of an empty log ring (in us) */
+#define   LOGDRAIN_PERIOD      200
+
+/** \brief stack size of an entity thread (in bytes) */
+#define   THREAD_STACK         (64 << 10)
+
+/** \brief semaphore implementation the generator was built with, as named in benchmark reports */
+#ifndef   SEMAPHORE_IMPL
+#define   SEMAPHORE_IMPL       "sysv"
+#endif
+
+/** \brief shared memory implementation the generator was built with, as named in benchmark reports */
+#ifndef   SHMEM_IMPL
+#define   SHMEM_IMPL           "sysv"
+#endif
+
+/** \brief build configuration the generator was built with (see the Makefile), as named in benchmark reports */
+#ifndef   BUILD_CONFIG
+#define   BUILD_CONFIG         "debug"
+#endif
+
+/** \brief command line usage */
+#define   USAGE                "Usage: %s [-b] [-f] [-t] [-z] [-s seed] [-x time scale] [-p players] [-g goalies] [-P team players] [-G team goalies] [-m matches] [-k pitches] [-l histogram file] [-r report file] [-d deadline] [-c] [-a pack|spread|referee] [-F] [-w spins] [-e workers] [-n] [-u] [-M] [logfile]\n"
+
+/* instants of the run measured for benchmark reports */
+
+/** \brief before creating the shared region */
+#define   T_START              0
+/** \brief shared region, log file and semaphore set created and initialized */
+#define   T_SETUP              1
+/** \brief all intervening entities generated */
+#define   T_SPAWN              2
+/** \brief all intervening entities ended */
+#define   T_RUN                3
+/** \brief semaphore set and shared region destroyed */
+#define   T_TEARDOWN           4
+
+/** \brief number of measured instants */
+#define   T_NU                 5
+
+/**
+ *  \brief Definition of <em>entity thread arguments</em> data type.
+ */
+typedef struct {
+    /** \brief life cycle of the entity */
+    int (*run) (unsigned int id, char logFile[], int semSet, SHARED_REGION *region);
+    /** \brief entity id */
+    unsigned int id;
+    /** \brief name of the logging file */
+    char *logFile;
+    /** \brief semaphore set access identifier */
+    int semgid;
+    /** \brief pointer to the shared region */
+    SHARED_REGION *shr;
+} ENTITY_ARGS;
+
+/** \brief environment of the generator, passed on to spawned entities */
+extern char **environ;
+
+/** \brief number of entity threads that ended their life cycle */
+static atomic_uint threadsDone;
+
+void launch_processes(char *bin, char *prefix, int nProc, int nPitches, char *logFilename, int *pids)
 {
-    char idstr[3];
+    char idstr[12];
     char errorFilename[128];
     int p;
     for (p = 0; p < nProc; p++) {           
@@ -52,15 +180,360 @@ void launch_processes(char *bin, char *prefix, int nProc, char *logFilename, int
         }
         sprintf(idstr,"%d", p);
         sprintf(errorFilename,"error_%s%02d", prefix, p); 
-        if (pids[p] == 0)
+        if (pids[p] == 0) {
+            sigprocmask (SIG_SETMASK, supSigMask (), NULL);
             if (execl (bin, bin, idstr, logFilename, errorFilename, NULL) < 0) { 
                 perror ("error on the generation of the process");
                 exit (EXIT_FAILURE);
             }
+        }
+        /* referees are dealt one per pitch, players and goalies round-robin */
+        supChild (pids[p], prefix[0], (unsigned int) p, (unsigned int) ((prefix[0] == 'R') ? p : p % nPitches));
+        affProcess (pids[p], prefix[0], (unsigned int) p);
+    }
+}
+
+
+
+/**
+ *  \brief Generation of entity processes for the fast startup (option -f).
+ *
+ *  Entities are generated with <tt>posix_spawn</tt>, which does not copy the address space of the generator, and get
+ *  the identifiers of the semaphore set and the shared region as two more parameters, after the name of the error
+ *  file; descriptors of private resources are inherited.
+ */
+static void spawn_processes (char *bin, char *prefix, int nProc, int nPitches, char *logFilename, int semgid, int shmid,
+                             int *pids)
+{
+    char idstr[12], semstr[12], shmstr[12];
+    char errorFilename[128];
+    char *argv[] = { bin, idstr, logFilename, errorFilename, semstr, shmstr, NULL };
+    posix_spawnattr_t attr;
+    pid_t pid;
+    int p, err;
+
+    posix_spawnattr_init (&attr);
+    posix_spawnattr_setsigmask (&attr, supSigMask ());
+    posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGMASK);
+    sprintf (semstr, "%d", semgid);
+    sprintf (shmstr, "%d", shmid);
+    for (p = 0; p < nProc; p++) {
+        sprintf (idstr, "%d", p);
+        sprintf (errorFilename, "error_%s%02d", prefix, p);
+        if ((err = posix_spawn (&pid, bin, NULL, &attr, argv, environ)) != 0) {
+            fprintf (stderr, "error on the generation of the process: %s\n", strerror (err));
+            exit (EXIT_FAILURE);
+        }
+        pids[p] = (int) pid;
+        supChild (pid, prefix[0], (unsigned int) p, (unsigned int) ((prefix[0] == 'R') ? p : p % nPitches));
+        affProcess (pid, prefix[0], (unsigned int) p);
     }
+    posix_spawnattr_destroy (&attr);
 }
 
+/**
+ *  \brief Body of an entity thread: the life cycle of the entity, as in its own program.
+ */
+static void *entityThread (void *arg)
+{
+    ENTITY_ARGS *a = arg;
+
+    if (a->run (a->id, a->logFile, a->semgid, a->shr) != EXIT_SUCCESS) {
+        exit (EXIT_FAILURE);
+    }
+    atomic_fetch_add_explicit (&threadsDone, 1, memory_order_release);
+    return NULL;
+}
+
+/**
+ *  \brief Generation of entity threads, the counterpart of launch_processes for the thread engine.
+ */
+static void launch_threads (int (*run) (unsigned int, char [], int, SHARED_REGION *), char kind, int nThr,
+                            char *logFilename, int semgid, SHARED_REGION *shr, ENTITY_ARGS *args, pthread_t *tids)
+{
+    pthread_attr_t attr;
+    int p, err;
+
+    pthread_attr_init (&attr);
+    pthread_attr_setstacksize (&attr, THREAD_STACK);
+    for (p = 0; p < nThr; p++) {
+        args[p].run = run;
+        args[p].id = (unsigned int) p;
+        args[p].logFile = logFilename;
+        args[p].semgid = semgid;
+        args[p].shr = shr;
+        affThread (&attr, kind, (unsigned int) p);
+        if ((err = pthread_create (&tids[p], &attr, entityThread, &args[p])) != 0) {
+            fprintf (stderr, "error on the creation of the thread: %s\n", strerror (err));
+            exit (EXIT_FAILURE);
+        }
+    }
+    pthread_attr_destroy (&attr);
+}
+
+/**
+ *  \brief Present time of CLOCK_MONOTONIC, in ns.
+ */
+static uint64_t nowNs (void)
+{
+    struct timespec t;
 
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+/**
+ *  \brief Append one record with the measures of the run to a benchmark report.
+ *
+ *  The report is a CSV file, whose header line is written when the file is empty, or a JSON Lines file if its name
+ *  ends in <tt>.json</tt>. The columns are: engine (thread, process, spawn for the fast startup, or event), semaphore and
+ *  shared memory implementations, build configuration (debug, release, profile or pgo), roster sizes, seed, time
+ *  scale, spin budget and number of matches played; time (ms) spent setting up the IPC, generating the entities, running and
+ *  tearing down, and the wall time; matches per second of running time; then count, mean, p50, p99 and p99.9 (us) of every protocol phase,
+ *  merged over all kinds of entities and all pitches. Columns never change order, nor are they left out when a
+ *  phase has no samples, so that reports of different builds can be compared line by line.
+ */
+static void writeReport (const char *name, const char *engine, FULL_STAT *p_fSt, uint64_t t[], LAT_STATS lat[])
+{
+    static LAT_STATS all;                                                  /* protocol phases of all entities */
+    FILE *fp;
+    bool json;
+    size_t len = strlen (name);
+    int matches = p_fSt->nMatches * p_fSt->nPitches,
+        k, p;
+    double runMs = (double) (t[T_RUN] - t[T_SPAWN]) / 1e6;
+
+    latInit (&all);
+    for (k = 0; k < LAT_KINDS; k++) {
+        latMerge (&all, &lat[k]);
+    }
+
+    json = (len >= 5) && (strcmp (name + len - 5, ".json") == 0);
+    if ((fp = fopen (name, "a")) == NULL) {
+        perror ("error on opening the report file");
+        exit (EXIT_FAILURE);
+    }
+
+    if (json) {
+        fprintf (fp, "{\"engine\":\"%s\",\"semaphore\":\"%s\",\"shmem\":\"%s\",\"build\":\"%s\",\"players\":%d,\"goalies\":%d,\"teamPlayers\":%d,"
+                 "\"teamGoalies\":%d,\"pitches\":%d,\"seed\":%u,\"timeScale\":%g,\"spin\":%u,"
+                 "\"matches\":%d,",
+                 engine, SEMAPHORE_IMPL, SHMEM_IMPL, BUILD_CONFIG, p_fSt->nPlayers, p_fSt->nGoalies,
+                 p_fSt->nTeamPlayers, p_fSt->nTeamGoalies, p_fSt->nPitches, p_fSt->seed, p_fSt->timeScale, p_fSt->spin,
+                 matches);
+        fprintf (fp, "\"setup_ms\":%.3f,\"spawn_ms\":%.3f,\"run_ms\":%.3f,\"teardown_ms\":%.3f,\"wall_ms\":%.3f,"
+                 "\"matches_per_s\":%.3f",
+                 (double) (t[T_SETUP] - t[T_START]) / 1e6, (double) (t[T_SPAWN] - t[T_SETUP]) / 1e6, runMs,
+                 (double) (t[T_TEARDOWN] - t[T_RUN]) / 1e6, (double) (t[T_TEARDOWN] - t[T_START]) / 1e6,
+                 (runMs > 0.0) ? 1e3 * matches / runMs : 0.0);
+        for (p = 0; p < NUMPHASES; p++) {
+            LAT_HIST *h = &all.phase[p];
+            uint64_t count = atomic_load (&h->count);
+            const char *ph = latPhaseName (p);
+
+            fprintf (fp, ",\"%s_count\":%llu,\"%s_mean_us\":%.3f,\"%s_p50_us\":%.3f,\"%s_p99_us\":%.3f,"
+                     "\"%s_p999_us\":%.3f", ph, (unsigned long long) count,
+                     ph, (count == 0) ? 0.0 : (double) atomic_load (&h->sum) / (double) count / 1e3,
+                     ph, (count == 0) ? 0.0 : (double) latPercentile (h, 0.50) / 1e3,
+                     ph, (count == 0) ? 0.0 : (double) latPercentile (h, 0.99) / 1e3,
+                     ph, (count == 0) ? 0.0 : (double) latPercentile (h, 0.999) / 1e3);
+        }
+        fprintf (fp, "}\n");
+    }
+    else {
+        if (ftell (fp) == 0) {
+            fprintf (fp, "engine,semaphore,shmem,build,players,goalies,teamPlayers,teamGoalies,pitches,seed,timeScale,spin,matches,"
+                     "setup_ms,spawn_ms,run_ms,teardown_ms,wall_ms,matches_per_s");
+            for (p = 0; p < NUMPHASES; p++) {
+                const char *ph = latPhaseName (p);
+
+                fprintf (fp, ",%s_count,%s_mean_us,%s_p50_us,%s_p99_us,%s_p999_us", ph, ph, ph, ph, ph);
+            }
+            fprintf (fp, "\n");
+        }
+        fprintf (fp, "%s,%s,%s,%s,%d,%d,%d,%d,%d,%u,%g,%u,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f",
+                 engine, SEMAPHORE_IMPL, SHMEM_IMPL, BUILD_CONFIG, p_fSt->nPlayers, p_fSt->nGoalies,
+                 p_fSt->nTeamPlayers, p_fSt->nTeamGoalies, p_fSt->nPitches, p_fSt->seed, p_fSt->timeScale, p_fSt->spin, matches,
+                 (double) (t[T_SETUP] - t[T_START]) / 1e6, (double) (t[T_SPAWN] - t[T_SETUP]) / 1e6, runMs,
+                 (double) (t[T_TEARDOWN] - t[T_RUN]) / 1e6, (double) (t[T_TEARDOWN] - t[T_START]) / 1e6,
+                 (runMs > 0.0) ? 1e3 * matches / runMs : 0.0);
+        for (p = 0; p < NUMPHASES; p++) {
+            LAT_HIST *h = &all.phase[p];
+            uint64_t count = atomic_load (&h->count);
+
+            fprintf (fp, ",%llu,%.3f,%.3f,%.3f,%.3f", (unsigned long long) count,
+                     (count == 0) ? 0.0 : (double) atomic_load (&h->sum) / (double) count / 1e3,
+                     (count == 0) ? 0.0 : (double) latPercentile (h, 0.50) / 1e3,
+                     (count == 0) ? 0.0 : (double) latPercentile (h, 0.99) / 1e3,
+                     (count == 0) ? 0.0 : (double) latPercentile (h, 0.999) / 1e3);
+        }
+        fprintf (fp, "\n");
+    }
+
+    if (fclose (fp) == EOF) {
+        perror ("error on writing the report file");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Parse a roster size given on the command line, exiting on an invalid value.
+ */
+static int getSize (char *arg, char *what, int min, int max)
+{
+    char *tinp;                                                                  /* numerical parameters test flag */
+    long n = strtol (arg, &tinp, 0);
+
+    if ((*tinp != '\0') || (n < min) || (n > max)) {
+        fprintf (stderr, "Invalid %s \"%s\" (must be in %d..%d)\n", what, arg, min, max);
+        exit (EXIT_FAILURE);
+    }
+    return (int) n;
+}
+
+/**
+ *  \brief Parse a time scale given on the command line, exiting on an invalid value.
+ */
+static double getScale (char *arg)
+{
+    char *tinp;                                                                  /* numerical parameters test flag */
+    double f = strtod (arg, &tinp);
+
+    if ((*tinp != '\0') || !(f >= 0.0) || (f > MAXTIMESCALE)) {
+        fprintf (stderr, "Invalid time scale \"%s\" (must be in 0..%d)\n", arg, MAXTIMESCALE);
+        exit (EXIT_FAILURE);
+    }
+    return f;
+}
+
+/**
+ *  \brief Reset the problem internal status for a new match: every entity is arriving and no team was formed.
+ */
+static void resetMatch (FULL_STAT *p_fSt)
+{
+    int p, g;
+
+    seqWriteBegin (&p_fSt->st);
+    for (p = 0; p < p_fSt->nPlayers; p++) {
+        PLAYERSTAT (p_fSt, p)        = ARRIVING;             // loop to iterate through all players, setting their status to arriving
+    }
+    for (g = 0; g < p_fSt->nGoalies; g++) {
+        GOALIESTAT (p_fSt, g)        = ARRIVING;             // similar to the players loop
+    }
+    REFEREESTAT (p_fSt, 0) = ARRIVINGR;                      /*referee is arriving*/
+    seqWriteEnd (&p_fSt->st);
+
+    p_fSt->playersArrived   = 0;
+    p_fSt->goaliesArrived   = 0;
+    p_fSt->playersFree      = 0;
+    p_fSt->goaliesFree      = 0;
+    p_fSt->teamId           = 1;
+}
+
+/**
+ *  \brief Copy the state of the entities of a pitch into the state of all entities recorded in the log.
+ */
+static void mergePitch (FULL_STAT *p_all, FULL_STAT *p_pitch)
+{
+    int K = p_pitch->nPitches, k = p_pitch->pitch;
+    int i;
+
+    for (i = 0; i < p_pitch->nPlayers; i++) {
+        PLAYERSTAT (p_all, PITCHENTITY (i, K, k)) = PLAYERSTAT (p_pitch, i);
+    }
+    for (i = 0; i < p_pitch->nGoalies; i++) {
+        GOALIESTAT (p_all, PITCHENTITY (i, K, k)) = GOALIESTAT (p_pitch, i);
+    }
+    REFEREESTAT (p_all, k) = REFEREESTAT (p_pitch, 0);
+}
+
+/**
+ *  \brief Barrier between two matches of a tournament, advanced without blocking from the generator polling loop.
+ *
+ *  Each pitch has its own barrier. Once every entity of the pitch has finished the present match, the records of that match are drained, the internal status is
+ *  reset and logged and the entities are let through the first turnstile; once all of them went through it, the second
+ *  one releases them into the next match. The second turnstile keeps an entity that is late in the next match from
+ *  taking the place of another one that did not yet leave the previous barrier.
+ *
+ *  The generator never blocks on the critical region of a pitch: an entity inside it may be waiting for a slot of
+ *  the log ring, which only the generator frees. A region that is held is skipped, and the barrier is advanced by a
+ *  later poll, once the log ring was drained again.
+ *
+ *  \param nFic name of the logging file
+ *  \param shr pointer to the shared region
+ *  \param sh pointer to the shared information of the pitch
+ *  \param semgid semaphore set access identifier
+ */
+static void matchBarrier (char nFic[], SHARED_REGION *shr, SHARED_DATA *sh, int semgid)
+{
+    int n = (int) sh->fSt.st.nEntities;
+
+    if (lockTryDown (&sh->lock, semgid, sh->mutex) == -1) {                                   /* enter critical region */
+        if (errno == EAGAIN) return;                                                    /* held: the next poll retries */
+        perror ("error on the down operation for semaphore access");
+        exit (EXIT_FAILURE);
+    }
+
+    if (sh->fSt.matchDone == n) {
+        drainLog (nFic, &shr->fSt, LOGRING (shr));
+        sh->fSt.matchDone = 0;
+        sh->fSt.match++;
+        resetMatch (&sh->fSt);
+        slotReset (sh);
+        mergePitch (&shr->fSt, &sh->fSt);
+        saveState (nFic, &shr->fSt);
+        if (semUpN (semgid, sh->waitMatchEnd, (unsigned int) n) == -1) {
+            perror ("error on the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
+    }
+    else if (sh->fSt.matchReady == n) {
+        sh->fSt.matchReady = 0;
+        if (semUpN (semgid, sh->waitMatchStart, (unsigned int) n) == -1) {
+            perror ("error on the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    if (lockUp (&sh->lock, LK_GEN_BARRIER, semgid, sh->mutex) == -1) {                         /* exit critical region */
+        perror ("error on the up operation for semaphore access");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Ending a run that exceeded a deadline: the entity processes are killed and the IPC resources destroyed.
+ *
+ *  The records still in the log ring are drained first, so that the log shows where the run got stuck. Entity
+ *  threads (thread engine) end with the generator.
+ *
+ *  \param nFic name of the logging file
+ *  \param shr pointer to the shared region
+ *  \param semgid semaphore set access identifier
+ *  \param shmid shared memory access identifier
+ *  \param threads the entities are threads of the generator
+ *  \param pool the IPC resources are kept for the next run of the pool, which resets them
+ *  \param t0 start of operations, the instant exits are reported from
+ */
+static void abortRun (char nFic[], SHARED_REGION *shr, int semgid, int shmid, bool threads, bool pool, uint64_t t0)
+{
+    drainLog (nFic, &shr->fSt, LOGRING (shr));
+    atomic_store (&shr->run, RUN_OVER);
+    if (!threads) {
+        supKill ();
+        supReport (stderr, t0);
+    }
+    if (!pool && (semDestroy (semgid) == -1)) {
+        perror ("error on destructing the semaphore set");
+    }
+    if (shmemDettach (shr) == -1) { 
+        perror ("error on unmapping the shared region off the process address space");
+    }
+    if (!pool && (shmemDestroy (shmid) == -1)) { 
+        perror ("error on destructing the shared region");
+    }
+    exit (EXIT_FAILURE);
+}
 
 /**
  *  \brief Main program.
@@ -73,124 +546,512 @@ int main (int argc, char *argv[])
     char nFic[51];                                                                              /*name of logging file */
     int shmid,                                                                      /* shared memory access identifier */
         semgid;                                                                     /* semaphore set access identifier */
-    unsigned int  m;                                                                             /* counting variables */
-    SHARED_DATA *sh;                                                                /* pointer to shared memory region */
-    int pidPL[NUMPLAYERS],                                                         /* players process identifier array */
-        pidGL[NUMGOALIES],                                                         /* goalies process identifier array */
-        pidRF;                                                                           /* referee process identifier */
+    unsigned int  m,                                                                             /* counting variables */
+                  drained;                                                        /* number of log records drained */
+    SHARED_REGION *shr;                                                             /* pointer to shared memory region */
+    SHARED_DATA *sh;                                                          /* pointer to the shared data of a pitch */
+    int *pidPL,                                                                    /* players process identifier array */
+        *pidGL,                                                                    /* goalies process identifier array */
+        *pidRF;                                                                    /* referees process identifier array */
+    pthread_t *tids = NULL;                                                   /* entity threads (thread engine) */
+    ENTITY_ARGS *args = NULL;                                                /* entity thread arguments (thread engine) */
+    static LAT_STATS lat[LAT_KINDS];                                /* time spent in each phase, by kind of entity */
+    static LOCK_STATS lock;                      /* time each call site waited for and held the critical regions */
+    char *latFile = NULL,                                                 /* file where histograms are accumulated */
+         *reportFile = NULL;                                         /* file where benchmark records are appended */
+    uint64_t t[T_NU];                                                          /* measured instants of the run */
+    FULL_STAT config;                                               /* sizes of the simulation, for the report */
+    unsigned int deadline = 0,                                              /* deadline of every match, in ms */
+                 failed = 0;                                    /* entity processes that did not end successfully */
+    int *matchSeen;                                                /* match of each pitch, as last seen (deadline) */
+    uint64_t *matchStart;                                               /* instant it was first seen (deadline) */
+    PROTO_CHECK chk;                                                      /* checker of the protocol (option -c) */
+    bool threads = false,                                                /* entities run as threads of the generator */
+         check = false,                                               /* the protocol is checked on every record */
+         fifo = false,                                                 /* referees run with the policy SCHED_FIFO */
+         fast = false,                                    /* private IPC resources, passed on to spawned entities */
+         noLog = false,                                                  /* no log is written (event engine) */
+         pool = false,                                      /* the IPC resources are reused and kept (option -u) */
+         profile = false,                               /* the critical regions are profiled (option -M) */
+         progress;                                                        /* some entity ended since the last poll */
+    int nPlayers = NUMPLAYERS,                                                                 /* total number of players */
+        nGoalies = NUMGOALIES,                                                                 /* total number of goalies */
+        nTeamPlayers = NUMTEAMPLAYERS,                                                   /* number of players in each team */
+        nTeamGoalies = NUMTEAMGOALIES,                                                   /* number of goalies in each team */
+        nMatches = 1,                                                                /* number of matches of the tournament */
+        nPitches = NUMPITCHES,                                                                     /* number of pitches */
+        k;                                                                                           /* pitch counter */
+    unsigned int seed = (unsigned int) getpid ();                       /* seed of the delay generators of the entities */
+    double timeScale = 1.0;                                            /* factor applied to the delays of the entities */
+    unsigned int spin = 0;                                    /* polls of a semaphore before blocking (option -w) */
+    unsigned int workers = 0;                       /* worker threads of the event engine (option -e), 0 for none */
+    unsigned int generation = 0;                                 /* run of the IPC pool (option -u), 0 for none */
+    unsigned int privSems = 0;                              /* number of private semaphores of players and goalies */
+    unsigned int nEntities,                                                       /* total number of intervening entities */
+                 pitchEntities;                                           /* largest number of entities in a pitch */
+    size_t shSize;                                                                           /* size of the shared region */
     int key;                                                           /*access key to shared memory and semaphore set */
-    int status,                                                                                    /* execution status */
-        info;                                                                                               /* info id */
+    int opt,                                                                                 /* command line option */
+        placement = AFF_NONE,                                           /* placement policy of the entities */
+        logFormat = LOG_TEXT;                                                                /* format of log records */
+
+    /* getting options */
+    while ((opt = getopt (argc, argv, "bcfFMntuza:s:x:p:g:P:G:m:k:l:r:d:w:e:")) != -1) {
+        switch (opt) {
+            case 'b':
+                logFormat = LOG_BINARY;
+                break;
+            case 'c':
+                check = true;
+                break;
+            case 'f':
+                fast = true;
+                break;
+            case 'F':
+                fifo = true;
+                break;
+            case 'a':
+                if ((placement = affPolicy (optarg)) == -1) {
+                    fprintf (stderr, "Invalid placement policy \"%s\" (must be pack, spread or referee)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 't':
+                threads = true;
+                break;
+            case 'z':
+                timeScale = 0.0;
+                break;
+            case 's':
+                seed = (unsigned int) getSize (optarg, "seed", 0, INT_MAX);
+                break;
+            case 'x':
+                timeScale = getScale (optarg);
+                break;
+            case 'r':
+                reportFile = optarg;
+                break;
+            case 'p':
+                nPlayers = getSize (optarg, "number of players", 1, MAXENTITIES);
+                break;
+            case 'g':
+                nGoalies = getSize (optarg, "number of goalies", 1, MAXENTITIES);
+                break;
+            case 'P':
+                nTeamPlayers = getSize (optarg, "number of players per team", 1, MAXENTITIES / 2);
+                break;
+            case 'G':
+                nTeamGoalies = getSize (optarg, "number of goalies per team", 1, MAXENTITIES / 2);
+                break;
+            case 'm':
+                nMatches = getSize (optarg, "number of matches", 1, INT_MAX);
+                break;
+            case 'l':
+                latFile = optarg;
+                break;
+            case 'd':
+                deadline = (unsigned int) getSize (optarg, "deadline", 1, INT_MAX);
+                break;
+            case 'k':
+                nPitches = getSize (optarg, "number of pitches", 1, MAXPITCHES);
+                break;
+            case 'w':
+                spin = (unsigned int) getSize (optarg, "spin budget", 0, INT_MAX);
+                break;
+            case 'e':
+                workers = (unsigned int) getSize (optarg, "number of workers", 1, POOL_MAXWORKERS);
+                break;
+            case 'n':
+                noLog = true;
+                break;
+            case 'u':
+                pool = true;
+                break;
+            case 'M':
+                profile = true;
+                break;
+            default:
+                fprintf (stderr, USAGE, argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if ((nPlayers / nPitches < 2 * nTeamPlayers) || (nGoalies / nPitches < 2 * nTeamGoalies)) {
+        fprintf (stderr, "There must be enough players and goalies for two teams in each pitch\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((workers > 0) && (threads || fast || fifo || (placement != AFF_NONE) || (deadline > 0) || (spin > 0) || profile)) {
+        fprintf (stderr, "The event engine (-e) runs neither processes nor threads: -t, -f, -F, -a, -d, -w and -M do not apply\n");
+        exit (EXIT_FAILURE);
+    }
+    if (pool && (fast || (workers > 0))) {
+        fprintf (stderr, "The IPC pool (-u) is reached by its key: neither private resources (-f) nor the event engine (-e) use it\n");
+        exit (EXIT_FAILURE);
+    }
+    if (noLog && (workers == 0)) {
+        fprintf (stderr, "Only the event engine (-e) runs without a log (-n)\n");
+        exit (EXIT_FAILURE);
+    }
+    nEntities = (unsigned int) (nPlayers + nGoalies + nPitches * NUMREFEREES);
+    affInit (placement, fifo, (unsigned int) nPlayers, (unsigned int) nGoalies, (unsigned int) (nPitches * NUMREFEREES));
+    pitchEntities = (unsigned int) (PITCHSHARE (nPlayers, nPitches, 0) + PITCHSHARE (nGoalies, nPitches, 0) + NUMREFEREES);
 
     /* getting log file name */
-    if(argc==2) {                   // if the programm runs with exactly one argument
-        strcpy(nFic, argv[1]);      // copies the argument into logging file
+    if(argc==optind+1) {            // if the programm runs with exactly one argument
+        strcpy(nFic, argv[optind]); // copies the argument into logging file
     }               
     else strcpy(nFic, "");          // else initializes the name of logging file as an empty string
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+    t[T_START] = nowNs ();
+
+    /* getting key value: private resources, reached only through their identifiers, for the fast startup and the
+       event engine, which does not even create them */
+    if (fast || (workers > 0)) {
+        key = IPC_PRIVATE;
+    }
+    else if ((key = ftok (".", 'a')) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
 
-    /* creating and initializing the shared memory region and the log file */
-    if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1) {      // if the creation of the shared memory fails 
+    /* layout of the shared region: header with the state of all entities, shared data of each pitch, log ring */
+    size_t pitchOffset = (offsetof (SHARED_REGION, fSt) + FULL_STAT_SIZE (nEntities) + CACHELINE - 1) & ~(size_t) (CACHELINE - 1);
+    size_t slotOffset = (offsetof (SHARED_DATA, fSt) + FULL_STAT_SIZE (pitchEntities) + CACHELINE - 1) & ~(size_t) (CACHELINE - 1);
+    size_t pitchSize = slotOffset + (size_t) pitchEntities * sizeof (ENTITY_SLOT);
+    size_t logRingOffset = pitchOffset + (size_t) nPitches * pitchSize;
+    shSize = logRingOffset + logRingSize (pitchEntities);
+
+    /* creating and initializing the shared memory region and the log file; the region of the event engine is
+       private memory, zeroed as a new shared memory region is */
+    if (workers > 0) {
+        shmid = -1;
+        shSize = (shSize + CACHELINE - 1) & ~(size_t) (CACHELINE - 1);
+        if ((shr = aligned_alloc (CACHELINE, shSize)) == NULL) {
+            perror ("error on allocating the region of the event engine");
+            exit (EXIT_FAILURE);
+        }
+        memset (shr, 0, shSize);
+    }
+    else if ((shmid = pool ? shmemReuse (key, (unsigned int) shSize) : shmemCreate (key, (unsigned int) shSize)) == -1) {
         perror ("error on creating the shared memory region");          // exits the program
         exit (EXIT_FAILURE);
     }
-    if (shmemAttach (shmid, (void **) &sh) == -1) {                     // if the attaching fails, exits 
+    else if (shmemAttach (shmid, (void **) &shr) == -1) {                    // if the attaching fails, exits 
         perror ("error on mapping the shared region on the process address space");
         exit (EXIT_FAILURE);
     }
+    affBindMemory (shr, shSize);                            // next to the entities, before it is initialized 
+    if (pool) generation = ipcRenew (shr, shSize);          // a region of the pool is zeroed for the new run
+    shr->nPitches      = (unsigned int) nPitches;
+    shr->pitchOffset   = pitchOffset;
+    shr->pitchSize     = pitchSize;
+    shr->logRingOffset = logRingOffset;
+    atomic_init (&shr->run, RUN_SETUP);
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                
+    /* initialize problem internal status, as seen by the log: all entities of all pitches */
+    shr->fSt.nPlayers         = nPlayers;                   // initialize sizes, counters and ids                          
+    shr->fSt.nGoalies         = nGoalies;                 
+    shr->fSt.nReferees        = nPitches * NUMREFEREES;
+    shr->fSt.nTeamPlayers     = nTeamPlayers;
+    shr->fSt.nTeamGoalies     = nTeamGoalies;
+    shr->fSt.nPitches         = nPitches;
+    shr->fSt.pitch            = -1;
+    shr->fSt.st.nEntities     = nEntities;
+    shr->fSt.nMatches         = nMatches;
+    shr->fSt.logSeq           = 0;
+    shr->fSt.logFormat        = logFormat;
+    shr->fSt.seed             = seed;
+    shr->fSt.timeScale        = timeScale;
+    shr->fSt.spin             = spin;
 
-    /* initialize problem internal status */
-    int p;
-    for (p = 0; p < NUMPLAYERS; p++) {
-        sh->fSt.st.playerStat[p]        = ARRIVING;          // loop to iterate through all players, setting their status to arriving
-    }
-    int g;
-    for (g = 0; g < NUMGOALIES; g++) {
-        sh->fSt.st.goalieStat[g]        = ARRIVING;          // similar to the players loop
-    }
-    sh->fSt.st.refereeStat = ARRIVINGR;                      /*referee is arriving*/
-    
-    sh->fSt.nPlayers         = NUMPLAYERS;                  // initialize counters and ids                          
-    sh->fSt.nGoalies         = NUMGOALIES;                 
-    sh->fSt.playersArrived   = 0;                                             
-    sh->fSt.goaliesArrived   = 0;                                             
-    sh->fSt.playersFree      = 0;                                             
-    sh->fSt.goaliesFree      = 0;                                             
-    sh->fSt.teamId           = 1;                                             
+    /* initialize the internal status of each pitch */
+    for (k = 0; k < nPitches; k++) {
+        sh = PITCH (shr, k);
+        sh->fSt.nPlayers         = PITCHSHARE (nPlayers, nPitches, k);
+        sh->fSt.nGoalies         = PITCHSHARE (nGoalies, nPitches, k);
+        sh->fSt.nReferees        = NUMREFEREES;
+        sh->fSt.nTeamPlayers     = nTeamPlayers;
+        sh->fSt.nTeamGoalies     = nTeamGoalies;
+        sh->fSt.nPitches         = nPitches;
+        sh->fSt.pitch            = k;
+        sh->fSt.st.nEntities     = (unsigned int) (sh->fSt.nPlayers + sh->fSt.nGoalies + NUMREFEREES);
+        atomic_init (&sh->fSt.st.seq, 0);
+
+        sh->slotOffset           = slotOffset;
+        resetMatch (&sh->fSt);
+        slotReset (sh);
+        sh->fSt.nMatches         = nMatches;
+        sh->fSt.match            = 0;
+        sh->fSt.matchDone        = 0;
+        sh->fSt.matchReady       = 0;
+        sh->fSt.logSeq           = 0;
+        sh->fSt.logFormat        = logFormat;
+        sh->fSt.seed             = seed;
+        sh->fSt.timeScale        = timeScale;
+        sh->fSt.spin             = spin;
+        mergePitch (&shr->fSt, &sh->fSt);
+        for (m = 0; m < LAT_KINDS; m++) {
+            latInit (&sh->lat[m]);
+            sh->lat[m].spin = spin;
+        }
+        lockInit (&sh->lock);
+        sh->lock.on = profile;
+
+        /* initialize semaphore ids: each pitch has its own group */
+        sh->mutex                       = SEMINDEX (k, MUTEX);      /* mutual exclusion semaphore id */
+        sh->refereeWaitTeams            = SEMINDEX (k, REFEREEWAITTEAMS);
+        sh->playerRegistered[0]         = SEMINDEX (k, PLAYERREGISTERED);
+        sh->playerRegistered[1]         = SEMINDEX (k, PLAYERREGISTERED2);
+        sh->playing                     = SEMINDEX (k, PLAYING);
+        sh->waitMatchEnd                = SEMINDEX (k, WAITMATCHEND);
+        sh->waitMatchStart              = SEMINDEX (k, WAITMATCHSTART);
+
+        /* private semaphores of the players and goalies of the pitch, after those of all pitches */
+        for (m = 0; m < (unsigned int) (sh->fSt.nPlayers + sh->fSt.nGoalies); m++) {
+            SLOT (sh, m).sem            = PRIVSEMINDEX (nPitches, privSems + m);
+        }
+        privSems += m;
+    }
 
     /* create log file */
-    createLog (nFic, &sh->fSt);                             // crete a log file to record the program execution and system state
-    saveState(nFic,&sh->fSt);                               // save the current state to the log for record keeping
-
-    /* initialize semaphore ids */
-    sh->mutex                       = MUTEX;                /* mutual exclusion semaphore id */
-    sh->playersWaitTeam             = PLAYERSWAITTEAM;
-    sh->goaliesWaitTeam             = GOALIESWAITTEAM;
-    sh->playersWaitReferee          = PLAYERSWAITREFEREE;
-    sh->playersWaitEnd              = PLAYERSWAITEND;
-    sh->refereeWaitTeams            = REFEREEWAITTEAMS;
-    sh->playerRegistered            = PLAYERREGISTERED;
-    sh->playing                     = PLAYING;                  
- 
-     /* creating and initializing the semaphore set */
-    if ((semgid = semCreate (key, SEM_NU)) == -1) { 
+    if (!noLog) createLog (nFic, &shr->fSt);                // crete a log file to record the program execution and system state
+    if (check) {
+        chkInit (&chk, nPlayers, nGoalies, nPitches * NUMREFEREES, nTeamPlayers, nTeamGoalies, stderr);
+        checkLog (&chk);
+    }
+    if (!noLog) saveState(nFic,&shr->fSt);                  // save the current state to the log for record keeping
+    initLogRing (LOGRING (shr), pitchEntities);             // entities store their records in the ring, drained below
+
+     /* creating and initializing the semaphore set: the event engine has semaphores of its own, with the same indices */
+    if (workers > 0) {
+        semgid = -1;
+    }
+    else if (pool) {
+        /* a set of the pool is reset in place; a new region gets a new set too, since entities left attached to the
+           region it replaced cannot tell they are stale, but lose the set they were using */
+        if (((semgid = semReuse (key, (unsigned int) nPitches * SEM_NU + privSems)) == -1) ||
+            ((generation == 1) && ((semDestroy (semgid) == -1) ||
+                                   ((semgid = semCreate (key, (unsigned int) nPitches * SEM_NU + privSems)) == -1)))) {
+            perror ("error on reusing the semaphore set");
+            exit (EXIT_FAILURE);
+        }
+    }
+    else if ((semgid = semCreate (key, (unsigned int) nPitches * SEM_NU + privSems)) == -1) { 
         perror ("error on creating the semaphore set");
         exit (EXIT_FAILURE);
     }
-    if (semUp (semgid, sh->mutex) == -1) {                             /* enabling access to critical region */
-        perror ("error on executing the up operation for semaphore access");
-        exit (EXIT_FAILURE);
+    for (k = 0; (workers == 0) && (k < nPitches); k++) {
+        if (semUp (semgid, PITCH (shr, k)->mutex) == -1) {             /* enabling access to critical region */
+            perror ("error on executing the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    t[T_SETUP] = nowNs ();
+
+    if (workers > 0) {
+        /* the entities of the event engine are objects, created as it starts */
+    }
+    else if (threads) {
+        /* generation of intervening entities threads, in the same order as the processes below */
+        if (((tids = malloc ((size_t) nEntities * sizeof (pthread_t))) == NULL) ||
+            ((args = malloc ((size_t) nEntities * sizeof (ENTITY_ARGS))) == NULL)) {
+            perror ("error on allocating the thread arrays");
+            exit (EXIT_FAILURE);
+        }
+        launch_threads (runPlayer, 'P', nPlayers, nFic, semgid, shr, args, tids);
+        launch_threads (runGoalie, 'G', nGoalies, nFic, semgid, shr, args + nPlayers, tids + nPlayers);
+        launch_threads (runReferee, 'R', nPitches, nFic, semgid, shr, args + nPlayers + nGoalies, tids + nPlayers + nGoalies);
     }
+    else {
+        /* generation of intervening entities processes */                            
+        if (((pidPL = malloc ((size_t) nPlayers * sizeof (int))) == NULL) ||
+            ((pidGL = malloc ((size_t) nGoalies * sizeof (int))) == NULL) ||
+            ((pidRF = malloc ((size_t) nPitches * sizeof (int))) == NULL)) {
+            perror ("error on allocating the process identifier arrays");
+            exit (EXIT_FAILURE);
+        }
+        supInit (nEntities, (unsigned int) nPitches);
 
-    /* generation of intervening entities processes */                            
-    /* player processes */
-    launch_processes(PLAYER, "PL", NUMPLAYERS, nFic, pidPL);
+        if (fast) {
+            spawn_processes (PLAYER, "PL", nPlayers, nPitches, nFic, semgid, shmid, pidPL);
+            spawn_processes (GOALIE, "GL", nGoalies, nPitches, nFic, semgid, shmid, pidGL);
+            spawn_processes (REFEREE, "RF", nPitches, nPitches, nFic, semgid, shmid, pidRF);
+        }
+        else {
+            /* player processes */
+            launch_processes(PLAYER, "PL", nPlayers, nPitches, nFic, pidPL);
 
-    /* goalie processes */
-    launch_processes(GOALIE, "GL", NUMGOALIES, nFic, pidGL);
+            /* goalie processes */
+            launch_processes(GOALIE, "GL", nGoalies, nPitches, nFic, pidGL);
 
-    /* smoker processes */
-    launch_processes(REFEREE, "RF", 1, nFic, &pidRF);
+            /* referee processes, one per pitch */
+            launch_processes(REFEREE, "RF", nPitches, nPitches, nFic, pidRF);
+        }
+    }
 
+    t[T_SPAWN] = nowNs ();
+    if (((matchSeen = calloc ((size_t) nPitches, sizeof (int))) == NULL) ||
+        ((matchStart = malloc ((size_t) nPitches * sizeof (uint64_t))) == NULL)) {
+        perror ("error on allocating the deadline arrays");
+        exit (EXIT_FAILURE);
+    }
+    for (k = 0; k < nPitches; k++) {
+        matchStart[k] = t[T_SPAWN];
+    }
 
     /* signaling start of operations */
-    if (semSignal (semgid) == -1) {
+    atomic_store (&shr->run, RUN_GOING);
+    if ((workers == 0) && (semSignal (semgid) == -1)) {
         perror ("error on signaling start of operations");
         exit (EXIT_FAILURE);
     }
 
-    /* waiting for the termination of the intervening entities processes */
+    /* the event engine runs the whole simulation, writing its records directly */
     m = 0;
-    do {
-        info = wait (&status);
-        if (info == -1) { 
-            perror ("error on aiting for an intervening process");
+    if (workers > 0) {
+        evtRun (nFic, shr, workers, !noLog, check ? &chk : NULL);
+        m = nEntities;
+    }
+
+    /* draining the log ring while waiting for the termination of the intervening entities */
+    while (m < nEntities) {
+        drained = drainLog (nFic, &shr->fSt, LOGRING (shr));
+        if (nMatches > 1) {
+            for (k = 0; k < nPitches; k++) {
+                matchBarrier (nFic, shr, PITCH (shr, k), semgid);
+            }
+        }
+        if (threads) {
+            unsigned int done = atomic_load_explicit (&threadsDone, memory_order_acquire);
+
+            progress = (done > m);
+            m = done;
+            if (!progress && (drained == 0)) usleep (LOGDRAIN_PERIOD);
+        }
+        else {
+            /* sleeps until some process ends, or for a drain period if the log ring was empty */
+            m += supWait ((drained == 0) ? (uint64_t) LOGDRAIN_PERIOD * 1000u : 0);
+        }
+
+        /* every match must end within the deadline, counted from the start of operations or from the end of
+           the previous match of the pitch */
+        if (deadline > 0) {
+            uint64_t now = nowNs ();
+
+            for (k = 0; k < nPitches; k++) {
+                sh = PITCH (shr, k);
+                if (sh->fSt.match != matchSeen[k]) {
+                    matchSeen[k] = sh->fSt.match;
+                    matchStart[k] = now;
+                }
+                else if ((threads ? (m < nEntities) : (supPitchAlive ((unsigned int) k) > 0)) &&
+                         (now - matchStart[k] > (uint64_t) deadline * 1000000u)) {
+                    fprintf (stderr, "match %d of pitch %d exceeded the deadline of %u ms\n", sh->fSt.match + 1, k,
+                             deadline);
+                    abortRun (nFic, shr, semgid, shmid, threads, pool, t[T_SPAWN]);
+                }
+            }
+        }
+    }
+    if (workers == 0) drainLog (nFic, &shr->fSt, LOGRING (shr));
+
+    if (threads) {
+        for (m = 0; m < nEntities; m++) {
+            pthread_join (tids[m], NULL);
+        }
+    }
+    t[T_RUN] = nowNs ();
+    atomic_store (&shr->run, RUN_OVER);
+
+    /* summary of the time spent in each protocol phase, by kind of entity, over all pitches; the seed and time
+       scale repeat the delays of the run */
+    fprintf (stderr, "seed %u, time scale %g\n", seed, timeScale);
+    if (spin > 0) fprintf (stderr, "waits spin up to %u polls before blocking\n", spin);
+    if (pool) fprintf (stderr, "IPC pool, generation %u\n", generation);
+    affReport (stderr);
+    if (workers > 0) {
+        evtReport (stderr);
+    }
+    else if (!threads) {
+        failed = supReport (stderr, t[T_SPAWN]);
+    }
+    for (m = 0; m < LAT_KINDS; m++) {
+        latInit (&lat[m]);
+        for (k = 0; k < nPitches; k++) {
+            latMerge (&lat[m], &PITCH (shr, k)->lat[m]);
+        }
+    }
+    latPrint (stderr, "players", &lat[LAT_PLAYERS]);
+    latPrint (stderr, "goalies", &lat[LAT_GOALIES]);
+    latPrint (stderr, "referees", &lat[LAT_REFEREES]);
+    if (profile) {
+        lockInit (&lock);
+        for (k = 0; k < nPitches; k++) {
+            lockMerge (&lock, &PITCH (shr, k)->lock);
+        }
+        lockPrint (stderr, &lock);
+    }
+
+    if (check) {
+        if (chk.violations > CHK_MAXREPORTED) fprintf (stderr, "... %ld more\n", chk.violations - CHK_MAXREPORTED);
+        fprintf (stderr, "protocol check: %ld records, %ld violations\n", chk.records, chk.violations);
+        checkLog (NULL);
+    }
+
+    /* accumulating the histograms over several runs */
+    if (latFile != NULL) {
+        int runs = latLoad (latFile, lat);
+
+        if (runs == -1) {
+            fprintf (stderr, "%s is not a valid histogram file\n", latFile);
+            exit (EXIT_FAILURE);
+        }
+        if (latSave (latFile, lat, runs + 1) == -1) {
+            perror ("error on writing the histogram file");
             exit (EXIT_FAILURE);
         }
-        m += 1;
-    } while (m < 1 + NUMPLAYERS + NUMGOALIES);
+
+        char title[64];
+        snprintf (title, sizeof (title), "players, %d runs", runs + 1);
+        latPrint (stderr, title, &lat[LAT_PLAYERS]);
+        snprintf (title, sizeof (title), "goalies, %d runs", runs + 1);
+        latPrint (stderr, title, &lat[LAT_GOALIES]);
+        snprintf (title, sizeof (title), "referees, %d runs", runs + 1);
+        latPrint (stderr, title, &lat[LAT_REFEREES]);
+    }
 
     /* destruction of semaphore set and shared region */
-    if (semDestroy (semgid) == -1) {
-        perror ("error on destructing the semaphore set");
-        exit (EXIT_FAILURE);
+    config = shr->fSt;
+    if (workers > 0) {
+        free (shr);
     }
-    if (shmemDettach (sh) == -1) { 
-        perror ("error on unmapping the shared region off the process address space");
-        exit (EXIT_FAILURE);
+    else if (pool) {
+        /* the resources are left for the next run of the pool */
+        if (shmemDettach (shr) == -1) { 
+            perror ("error on unmapping the shared region off the process address space");
+            exit (EXIT_FAILURE);
+        }
     }
-    if (shmemDestroy (shmid) == -1) { 
-        perror ("error on destructing the shared region");
-        exit (EXIT_FAILURE);
+    else {
+        if (semDestroy (semgid) == -1) {
+            perror ("error on destructing the semaphore set");
+            exit (EXIT_FAILURE);
+        }
+        if (shmemDettach (shr) == -1) { 
+            perror ("error on unmapping the shared region off the process address space");
+            exit (EXIT_FAILURE);
+        }
+        if (shmemDestroy (shmid) == -1) { 
+            perror ("error on destructing the shared region");
+            exit (EXIT_FAILURE);
+        }
+    }
+    t[T_TEARDOWN] = nowNs ();
+
+    if (reportFile != NULL) {
+        writeReport (reportFile, (workers > 0) ? "event" : (threads ? "thread" : (fast ? "spawn" : "process")), &config,
+                     t, lat);
     }
 
-    return EXIT_SUCCESS;
+    return ((failed == 0) && (!check || (chk.violations == 0))) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
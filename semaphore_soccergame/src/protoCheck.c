@@ -0,0 +1,258 @@
+/**
+ *  \file protoCheck.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Checking the invariants of the protocol on the stream of log records.
+ *
+ *  Records are compared with the previous one eight entities at a time, so that the unchanged runs of entities,
+ *  most of every record, cost next to nothing. The changes of a record are all applied before the teams and the
+ *  referee of the pitches they touch are checked, since a record saved by the generator between matches changes
+ *  every entity at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "probConst.h"
+#include "protoCheck.h"
+
+/* internal functions */
+
+static bool isPlayer (const PROTO_CHECK *chk, int e)  { return e < chk->nPlayers; }
+static bool isReferee (const PROTO_CHECK *chk, int e) { return e >= chk->nPlayers + chk->nGoalies; }
+
+static int pitchOf (const PROTO_CHECK *chk, int e)
+{
+    if (isReferee (chk, e)) return e - chk->nPlayers - chk->nGoalies;
+    return (isPlayer (chk, e) ? e : e - chk->nPlayers) % chk->nReferees;
+}
+
+static void entityName (const PROTO_CHECK *chk, int e, char *name)
+{
+    if (isPlayer (chk, e)) sprintf (name, "P%02d", e);
+    else if (!isReferee (chk, e)) sprintf (name, "G%02d", e - chk->nPlayers);
+    else sprintf (name, "R%02d", e - chk->nPlayers - chk->nGoalies + 1);
+}
+
+/* team of a player or goalie state: 1, 2 or 0 for none */
+static int teamOf (unsigned char c)
+{
+    if ((c == WAITING_START_1) || (c == PLAYING_1)) return 1;
+    if ((c == WAITING_START_2) || (c == PLAYING_2)) return 2;
+    return 0;
+}
+
+static bool isPlaying (unsigned char c)
+{
+    return (c == PLAYING_1) || (c == PLAYING_2);
+}
+
+static int *membersOf (PROTO_CHECK *chk, int pitch, int team, int kind)
+{
+    return &chk->members[(pitch * NUMTEAMS + team - 1) * 2 + kind];
+}
+
+static void violation (PROTO_CHECK *chk, const char *fmt, ...)
+{
+    va_list ap;
+
+    chk->violations += 1;
+    if ((chk->report != NULL) && (chk->violations <= CHK_MAXREPORTED)) {
+        fprintf (chk->report, "record %ld: ", chk->records);
+        va_start (ap, fmt);
+        vfprintf (chk->report, fmt, ap);
+        va_end (ap);
+        fprintf (chk->report, "\n");
+    }
+}
+
+/* transitions a player or goalie, or a referee, may make */
+static bool allowed (const PROTO_CHECK *chk, int e, unsigned char from, unsigned char to)
+{
+    if (isReferee (chk, e)) {
+        switch (from) {
+            case ARRIVINGR:     return to == WAITING_TEAMS;
+            case WAITING_TEAMS: return to == STARTING_GAME;
+            case STARTING_GAME: return to == REFEREEING;
+            case REFEREEING:    return to == ENDING_GAME;
+            case ENDING_GAME:   return to == ARRIVINGR;                                            /* next match */
+            default:            return false;
+        }
+    }
+    switch (from) {
+        case ARRIVING:        return (to == WAITING_TEAM) || (to == FORMING_TEAM) || (to == LATE);
+        case WAITING_TEAM:
+        case FORMING_TEAM:    return (to == WAITING_START_1) || (to == WAITING_START_2);
+        case WAITING_START_1: return to == PLAYING_1;
+        case WAITING_START_2: return to == PLAYING_2;
+        case PLAYING_1:
+        case PLAYING_2:
+        case LATE:            return to == ARRIVING;                                               /* next match */
+        default:              return false;
+    }
+}
+
+/* applies the change of state of a player or goalie to the teams of its pitch */
+static void changeMember (PROTO_CHECK *chk, int e, unsigned char from, unsigned char to)
+{
+    int k = pitchOf (chk, e),
+        kind = isPlayer (chk, e) ? 0 : 1;
+
+    if (teamOf (from) != 0) *membersOf (chk, k, teamOf (from), kind) -= 1;
+    if (teamOf (to) != 0) *membersOf (chk, k, teamOf (to), kind) += 1;
+    if (isPlaying (from)) chk->playing[k * NUMTEAMS + teamOf (from) - 1] -= 1;
+    if (isPlaying (to)) {
+        chk->playing[k * NUMTEAMS + teamOf (to) - 1] += 1;
+        chk->played[k] += 1;
+    }
+}
+
+/* checks the teams of a pitch, and the transition of its referee, after a record changed them */
+static void checkPitch (PROTO_CHECK *chk, int k, unsigned char from, unsigned char to)
+{
+    int full = NUMTEAMS * (chk->nTeamPlayers + chk->nTeamGoalies);
+    char name[8];
+    int t;
+
+    for (t = 1; t <= NUMTEAMS; t++) {
+        if (*membersOf (chk, k, t, 0) > chk->nTeamPlayers)
+            violation (chk, "pitch %d: team %d has %d players", k, t, *membersOf (chk, k, t, 0));
+        if (*membersOf (chk, k, t, 1) > chk->nTeamGoalies)
+            violation (chk, "pitch %d: team %d has %d goalies", k, t, *membersOf (chk, k, t, 1));
+    }
+    if (chk->played[k] > full)
+        violation (chk, "pitch %d: %d entities reached a playing state in the match", k, chk->played[k]);
+    if (from == to) return;
+
+    entityName (chk, chk->nPlayers + chk->nGoalies + k, name);
+    switch (to) {
+        case REFEREEING:                             /* both teams were formed and all their members play */
+            for (t = 1; t <= NUMTEAMS; t++) {
+                if ((*membersOf (chk, k, t, 0) != chk->nTeamPlayers) || (*membersOf (chk, k, t, 1) != chk->nTeamGoalies))
+                    violation (chk, "referee %s refereeing with team %d incomplete (%d members)", name, t,
+                               *membersOf (chk, k, t, 0) + *membersOf (chk, k, t, 1));
+                else if (chk->playing[k * NUMTEAMS + t - 1] != chk->nTeamPlayers + chk->nTeamGoalies)
+                    violation (chk, "referee %s refereeing with %d members of team %d playing", name,
+                               chk->playing[k * NUMTEAMS + t - 1], t);
+            }
+            break;
+        case ENDING_GAME:
+            if (chk->played[k] != full)
+                violation (chk, "referee %s ending a match where %d entities played, not %d", name, chk->played[k],
+                           full);
+            break;
+        case ARRIVINGR:                              /* next match */
+            chk->played[k] = 0;
+            break;
+    }
+}
+
+/* external functions */
+
+/**
+ *  \brief Initialization of a checker, for a roster.
+ *
+ *  \param chk pointer to the checker
+ *  \param nPlayers total number of players
+ *  \param nGoalies total number of goalies
+ *  \param nReferees total number of referees, one per pitch
+ *  \param nTeamPlayers number of players in each team
+ *  \param nTeamGoalies number of goalies in each team
+ *  \param report stream where violations are reported (the first CHK_MAXREPORTED of them)
+ */
+void chkInit (PROTO_CHECK *chk, int nPlayers, int nGoalies, int nReferees, int nTeamPlayers, int nTeamGoalies,
+              FILE *report)
+{
+    size_t n = (size_t) (nPlayers + nGoalies + nReferees);
+
+    chk->nPlayers = nPlayers;
+    chk->nGoalies = nGoalies;
+    chk->nReferees = nReferees;
+    chk->nTeamPlayers = nTeamPlayers;
+    chk->nTeamGoalies = nTeamGoalies;
+    chk->report = report;
+    chk->records = chk->violations = 0;
+    if (((chk->cur = malloc (n)) == NULL) ||
+        ((chk->members = calloc ((size_t) nReferees * NUMTEAMS * 2, sizeof (int))) == NULL) ||
+        ((chk->playing = calloc ((size_t) nReferees * NUMTEAMS, sizeof (int))) == NULL) ||
+        ((chk->played = calloc ((size_t) nReferees, sizeof (int))) == NULL) ||
+        ((chk->changed = malloc ((size_t) nReferees)) == NULL)) {
+        perror ("error on allocating the protocol checker");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Checking the next record.
+ *
+ *  \param chk pointer to the checker
+ *  \param st state of every entity: players, goalies and referees, in this order
+ */
+void chkRecord (PROTO_CHECK *chk, const unsigned char *st)
+{
+    int nPG = chk->nPlayers + chk->nGoalies,
+        n = nPG + chk->nReferees,
+        e, k;
+    unsigned char *cur = chk->cur;
+    char name[8];
+    uint64_t a, b;
+
+    if (chk->records == 0) {                         /* the initial state: every entity arriving */
+        memcpy (cur, st, (size_t) n);
+        for (e = 0; e < nPG; e++) {
+            if (teamOf (st[e]) != 0) changeMember (chk, e, ARRIVING, st[e]);
+        }
+        chk->records = 1;
+        return;
+    }
+
+    /* players and goalies first, so that the referees are checked against the teams of this record */
+    memset (chk->changed, 0, (size_t) chk->nReferees);
+    for (e = 0; e < nPG; e++) {
+        if ((e + 8 <= nPG) && ((e & 7) == 0)) {
+            memcpy (&a, cur + e, sizeof (a));
+            memcpy (&b, st + e, sizeof (b));
+            if (a == b) {
+                e += 7;
+                continue;
+            }
+        }
+        if (st[e] == cur[e]) continue;
+        if (!allowed (chk, e, cur[e], st[e])) {
+            entityName (chk, e, name);
+            violation (chk, "%s %c -> %c not allowed", name, cur[e], st[e]);
+        }
+        changeMember (chk, e, cur[e], st[e]);
+        chk->changed[pitchOf (chk, e)] = 1;
+        cur[e] = st[e];
+    }
+    for (e = nPG; e < n; e++) {
+        k = e - nPG;
+        if (st[e] != cur[e]) {
+            if (!allowed (chk, e, cur[e], st[e])) {
+                entityName (chk, e, name);
+                violation (chk, "%s %c -> %c not allowed", name, cur[e], st[e]);
+            }
+            checkPitch (chk, k, cur[e], st[e]);
+            cur[e] = st[e];
+        }
+        else if (chk->changed[k]) checkPitch (chk, k, st[e], st[e]);
+    }
+    chk->records += 1;
+}
+
+/**
+ *  \brief Releasing the memory of a checker.
+ *
+ *  \param chk pointer to the checker
+ */
+void chkFree (PROTO_CHECK *chk)
+{
+    free (chk->cur); free (chk->members); free (chk->playing); free (chk->played); free (chk->changed);
+    chk->cur = NULL; chk->members = NULL; chk->playing = NULL; chk->played = NULL; chk->changed = NULL;
+}
@@ -0,0 +1,96 @@
+/**
+ *  \file protoCheck.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Checking the invariants of the protocol on the stream of log records.
+ *
+ *  The checker is fed the state of all entities of every record, in log order, either by the generator while it
+ *  drains the log ring (option -c) or by logAnalyze on a logging file. It keeps the last state of every entity and
+ *  the members of the teams of every pitch, so that each record costs a comparison with the previous one and some
+ *  work for each entity that changed; the entities themselves are not involved at all.
+ *
+ *  Invariants checked:
+ *     \li every state transition of an entity is one its life cycle makes (a late player or goalie, for instance,
+ *         never joins a team)
+ *     \li no team of a pitch has more than NUMTEAMPLAYERS players and NUMTEAMGOALIES goalies, or the sizes given
+ *     \li a referee goes through <tt>W -> S -> R -> E</tt> in this order, and referees a match (<tt>S -> R</tt>) only
+ *         when both teams are complete and all their members play; the two <tt>refereeWaitTeams</tt> signals it
+ *         starts the game on follow the registration of the members, which is not logged, so a member may still be
+ *         shown waiting for its team when the referee is already starting the game
+ *     \li exactly <tt>2 * (team players + team goalies)</tt> entities of the pitch reach a playing state in each
+ *         match, which the referee ends (<tt>R -> E</tt>).
+ *
+ *  Players and goalies are dealt round-robin over the pitches, one referee each, as in the generator.
+ */
+
+#ifndef PROTOCHECK_H_
+#define PROTOCHECK_H_
+
+#include <stdio.h>
+
+/**
+ *  \brief Definition of <em>protocol checker</em> data type.
+ */
+typedef struct {
+    /** \brief total number of players */
+    int nPlayers;
+    /** \brief total number of goalies */
+    int nGoalies;
+    /** \brief total number of referees, one per pitch */
+    int nReferees;
+    /** \brief number of players in each team */
+    int nTeamPlayers;
+    /** \brief number of goalies in each team */
+    int nTeamGoalies;
+    /** \brief stream where violations are reported */
+    FILE *report;
+    /** \brief number of records checked */
+    long records;
+    /** \brief number of violations found */
+    long violations;
+    /** \brief state of every entity in the last record */
+    unsigned char *cur;
+    /** \brief members of each team of each pitch (waiting for the start or playing), by kind of entity */
+    int *members;
+    /** \brief members of each team of each pitch playing */
+    int *playing;
+    /** \brief entities of each pitch that reached a playing state in the present match */
+    int *played;
+    /** \brief pitches changed by the present record */
+    unsigned char *changed;
+} PROTO_CHECK;
+
+/**
+ *  \brief Initialization of a checker, for a roster.
+ *
+ *  \param chk pointer to the checker
+ *  \param nPlayers total number of players
+ *  \param nGoalies total number of goalies
+ *  \param nReferees total number of referees, one per pitch
+ *  \param nTeamPlayers number of players in each team
+ *  \param nTeamGoalies number of goalies in each team
+ *  \param report stream where violations are reported (the first CHK_MAXREPORTED of them)
+ */
+extern void chkInit (PROTO_CHECK *chk, int nPlayers, int nGoalies, int nReferees, int nTeamPlayers, int nTeamGoalies,
+                     FILE *report);
+
+/**
+ *  \brief Checking the next record.
+ *
+ *  \param chk pointer to the checker
+ *  \param st state of every entity: players, goalies and referees, in this order
+ */
+extern void chkRecord (PROTO_CHECK *chk, const unsigned char *st);
+
+/**
+ *  \brief Releasing the memory of a checker.
+ *
+ *  \param chk pointer to the checker
+ */
+extern void chkFree (PROTO_CHECK *chk);
+
+/** \brief largest number of violations reported one by one */
+#define  CHK_MAXREPORTED   20
+
+#endif /* PROTOCHECK_H_ */
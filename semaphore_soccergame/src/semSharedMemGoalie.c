@@ -31,18 +31,28 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entity.h"
+#include "pacing.h"
+#include "entitySlot.h"
+#include "stateSeq.h"
+#include "ipcPool.h"
 
-/** \brief logging file name */
-static char nFic[51];
+/* entity data, private to each thread when the entities run as threads of the generator */
 
-/** \brief shared memory block access identifier */
-static int shmid;
+/** \brief logging file name */
+static _Thread_local char nFic[51];
 
 /** \brief semaphore set access identifier */
-static int semgid;
+static _Thread_local int semgid;
 
 /** \brief pointer to shared memory region */
-static SHARED_DATA *sh;
+static _Thread_local SHARED_REGION *shr;
+
+/** \brief pointer to the shared data of the pitch where the goalie plays */
+static _Thread_local SHARED_DATA *sh;
+
+/** \brief latency stats of the goalie kind in its pitch, where the time spent in each protocol phase is accumulated */
+static _Thread_local LAT_STATS *lat;
 
 /** \brief goalie takes some time to arrive */
 static void arrive (int id);
@@ -56,6 +66,63 @@ static void waitReferee(int id, int team);
 /** \brief goalie waits for referee to end match */
 static void playUntilEnd(int id, int team);
 
+/** \brief goalie waits for the next match of the tournament */
+static void waitNextMatch (void);
+
+/**
+ *  \brief Life cycle of a goalie, once for each match of the tournament.
+ *
+ *  Runs either in a goalie process, once it is connected to the IPC resources, or in a thread of the generator,
+ *  which shares them directly (see entity.h).
+ *
+ *  \param id goalie id
+ *  \param logFile name of the logging file
+ *  \param semSet semaphore set access identifier
+ *  \param region pointer to the shared region
+ *
+ *  \return EXIT_SUCCESS, or EXIT_FAILURE when the id is wrong
+ */
+int runGoalie (unsigned int id, char logFile[], int semSet, SHARED_REGION *region)
+{
+    unsigned int n = id;
+    int team, match;
+
+    strcpy (nFic, logFile);
+    semgid = semSet;
+    shr = region;
+
+    /* the roster size is only known once the shared region is mapped */
+    if (n >= (unsigned int) shr->fSt.nGoalies) {
+        fprintf (stderr, "Goalie process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* the goalie plays in pitch n % nPitches, where it is goalie n / nPitches */
+    sh = PITCH (shr, n % shr->nPitches);
+    n /= shr->nPitches;
+
+    lat = &sh->lat[LAT_GOALIES];
+
+    /* delays are drawn from a generator of its own, seeded by the generator of the entities */
+    pacingInit (shr->fSt.seed, shr->fSt.timeScale, (unsigned int) shr->fSt.nPlayers + id);
+
+    /* state records go to the log ring drained by the generator */
+    attachLogRing (LOGRING (shr));
+
+    /* simulation of the life cycle of the goalie, once for each match of the tournament */
+    for (match = 0; match < sh->fSt.nMatches; match++) {
+        if (match > 0) waitNextMatch ();
+        arrive(n);
+        if((team = goalieConstituteTeam(n))!=0) {
+            waitReferee(n, team);
+            playUntilEnd(n, team);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#ifndef ENTITY_THREAD
 /**
  *  \brief Main program.
  *
@@ -64,11 +131,12 @@ static void playUntilEnd(int id, int team);
 int main (int argc, char *argv[])
 {
     int key;                                            /*access key to shared memory and semaphore set */
+    int shmid;                                                     /* shared memory access identifier */
     char *tinp;                                                       /* numerical parameters test flag */
-    int n, team;
+    int n, status;
 
     /* validation of command line parameters */
-    if (argc != 4) { 
+    if ((argc != 4) && (argc != 6)) { 
         freopen ("error_GL", "a", stderr);
         fprintf (stderr, "Number of parameters is incorrect!\n");
         return EXIT_FAILURE;
@@ -76,7 +144,7 @@ int main (int argc, char *argv[])
     
     /* get goalie id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMGOALIES )) { 
+    if (*tinp != '\0') { 
         fprintf (stderr, "Goalie process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -88,45 +156,61 @@ int main (int argc, char *argv[])
     freopen (argv[3], "w", stderr);
     setbuf(stderr,NULL);
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+    if (argc == 6) {
+        /* identifiers of the semaphore set and the shared region passed on by the generator - argv[4], argv[5]
+           (fast startup): the shared region is mapped before waiting for the start of operations */
+        semgid = (int) strtol (argv[4], &tinp, 0);
+        if (*tinp == '\0') shmid = (int) strtol (argv[5], &tinp, 0);
+        if (*tinp != '\0') {
+            fprintf (stderr, "IPC identifiers are wrong!\n");
+            return EXIT_FAILURE;
+        }
+        if (shmemAttach (shmid, (void **) &shr) == -1) { 
+            perror ("error on mapping the shared region on the process address space");
+            return EXIT_FAILURE;
+        }
+        if (semConnectId (semgid) == -1) { 
+            perror ("error on connecting to the semaphore set");
+            return EXIT_FAILURE;
+        }
     }
+    else {
+        /* getting key value */
+        if ((key = ftok (".", 'a')) == -1) {
+            perror ("error on generating the key");
+            exit (EXIT_FAILURE);
+        }
 
-    /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
-       process address space */
-    if ((semgid = semConnect (key)) == -1) { 
-        perror ("error on connecting to the semaphore set");
-        return EXIT_FAILURE;
-    }
-    if ((shmid = shmemConnect (key)) == -1) { 
-        perror ("error on connecting to the shared memory region");
-        return EXIT_FAILURE;
-    }
-    if (shmemAttach (shmid, (void **) &sh) == -1) { 
-        perror ("error on mapping the shared region on the process address space");
-        return EXIT_FAILURE;
+        /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
+           process address space */
+        if ((semgid = semConnect (key)) == -1) { 
+            perror ("error on connecting to the semaphore set");
+            return EXIT_FAILURE;
+        }
+        if ((shmid = shmemConnect (key)) == -1) { 
+            perror ("error on connecting to the shared memory region");
+            return EXIT_FAILURE;
+        }
+        if (shmemAttach (shmid, (void **) &shr) == -1) { 
+            perror ("error on mapping the shared region on the process address space");
+            return EXIT_FAILURE;
+        }
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());              
+    /* an entity left by a previous run of the IPC pool takes no part in this one (see ipcPool.h) */
+    ipcJoin (shr);
 
-    /* simulation of the life cycle of the goalie */
-    arrive(n);
-    if((team = goalieConstituteTeam(n))!=0) {
-        waitReferee(n, team);
-        playUntilEnd(n, team);
-    }
+    status = runGoalie ((unsigned int) n, nFic, semgid, shr);
 
     /* unmapping the shared region off the process address space */
-    if (shmemDettach (sh) == -1) {
+    if (shmemDettach (shr) == -1) {
         perror ("error on unmapping the shared region off the process address space");
         return EXIT_FAILURE;;
     }
 
-    return EXIT_SUCCESS;
+    return status;
 }
+#endif /* ENTITY_THREAD */
 
 /**
  *  \brief goalie takes some time to arrive
@@ -137,30 +221,37 @@ int main (int argc, char *argv[])
  */
 static void arrive(int id)
 {    
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.goalieStat[id] = ARRIVING;
-    saveState(nFic, &sh->fSt);
+    seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), ARRIVING);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, LK_GL_ARRIVE, semgid, sh->mutex) == -1) {                               /* exit critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
-    usleep((200.0*random())/(RAND_MAX+1.0)+60.0);
+    saveSnapshot (nFic, &snap);
+
+    pace (60.0, 200.0);
 }
 
 /**
  *  \brief goalie constitutes team
  *
- *  If goalie is late, it updates state and leaves.
- *  If there are enough free players to form a team, goalie forms team allowing team members to 
- *  proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
+ *  The goalie takes an arrival ticket with an atomic fetch-add: if it is late, it records its state
+ *  and leaves without entering the critical region.
+ *  If there are enough free players to form a team, goalie forms team: it reserves the team members
+ *  and the team id in the critical region, then, out of it, allows team members to proceed and waits
+ *  for them to acknowledge registration.
+ *  Otherwise it updates state, queues in the goalies waiting for a team and waits for the forming
+ *  teammate to "call" him, on its private semaphore; it reads its team from its slot and acknowledges
+ *  registration to the captain of that team.
  *  The internal state should be saved.
  *
  *  \param id goalie id
@@ -170,64 +261,65 @@ static void arrive(int id)
  */
 static int goalieConstituteTeam (int id)
 {
-    int ret = 0;
+    int ret = 0,
+        site;                                              /* call site of the critical region (see lockProf.h) */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    // If the goalies needed in 2 teams already arrived, the goalie is late
+    if (atomic_fetch_add (&sh->fSt.goaliesArrived, 1) >= 2 * sh->fSt.nTeamGoalies) {
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), LATE);            /* no critical region: seen by observers */
+        snapshotEntity (nFic, &sh->fSt, (unsigned int) (sh->fSt.nPlayers + id), LATE);
+        return 0;
+    }
 
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
     sh->fSt.goaliesFree++;
-    sh->fSt.goaliesArrived++;
-
-    // If the number of goalies that arrived is less than the number of goalies need in 2 teams
-    if (sh->fSt.goaliesArrived <= 2 * NUMTEAMGOALIES) {
-
-        // If the number of free players is more than 4 and the number of free goalies is more than the number of goalies is 1 
-        if (sh->fSt.playersFree >= NUMTEAMPLAYERS && sh->fSt.goaliesFree >= NUMTEAMGOALIES) {
-            
-            sh->fSt.st.goalieStat[id] = FORMING_TEAM;
-            sh->fSt.goaliesFree -= NUMTEAMGOALIES;
-
-            for (int i = 0; i < NUMTEAMPLAYERS; i++) {
-
-                // Increments the semaphore value for a waiting player to procceed
-                if (semUp(semgid,sh->playersWaitTeam) == -1) {
-                    perror("error on the up operation for semaphore access (GL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-
-            for (int i = 0; i < NUMTEAMPLAYERS; i++) {
-                // Decrement the semaphore value to indicate player as been registered
-                if (semDown(semgid, sh->playerRegistered) == -1) {
-                    perror("error on the up operation for semaphore access (GL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-
-            sh->fSt.playersFree -= NUMTEAMPLAYERS;
-            ret = sh->fSt.teamId++;
-            saveState(nFic, &sh->fSt);
-
-        } else {
-            sh->fSt.st.goalieStat[id] = WAITING_TEAM;
-            saveState(nFic, &sh->fSt);
-        }
+
+    // If the number of free players is more than 4 and the number of free goalies is more than the number of goalies is 1 
+    if (sh->fSt.playersFree >= sh->fSt.nTeamPlayers && sh->fSt.goaliesFree >= sh->fSt.nTeamGoalies) {
+        
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), FORMING_TEAM);
+        site = LK_GL_CAPTAIN;
+
+        // Reserve the players (and the other goalies of the team) and the team id
+        sh->fSt.goaliesFree -= sh->fSt.nTeamGoalies;
+        sh->fSt.playersFree -= sh->fSt.nTeamPlayers;
+        ret = sh->fSt.teamId++;
+        slotFormTeam (sh, ret, GOALIESLOTID (sh, id), sh->fSt.nTeamPlayers, sh->fSt.nTeamGoalies - 1);
+        latSnapshot (lat, nFic, &sh->fSt, &snap);
+
     } else {
-        ret = 0;
-        sh->fSt.st.goalieStat[id] = LATE;
-        sh->fSt.goaliesFree--;
-        saveState(nFic, &sh->fSt);
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), WAITING_TEAM);
+        site = LK_GL_QUEUE;
+        slotEnqueue (sh, &sh->goaliesWaiting, GOALIESLOTID (sh, id));
+        latSnapshot (lat, nFic, &sh->fSt, &snap);
     }
     
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, site, semgid, sh->mutex) == -1) {                                       /* exit critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
+    saveSnapshot (nFic, &snap);
+
     // If the goalie has gathered enough players to form a team and is now in FORMING_TEAM state
-    if (sh->fSt.st.goalieStat[id] == FORMING_TEAM) {
+    if (GOALIESTAT (&sh->fSt, id) == FORMING_TEAM) {
+
+        // Increments the private semaphores of the reserved players (and the other goalies of the team) to procceed
+        if (slotWakeTeam (semgid, sh, ret, GOALIESLOTID (sh, id)) == -1) {
+            perror("error on the up operation for semaphore access (GL)");
+            exit(EXIT_FAILURE);
+        }
+
+        // Decrement the semaphore value to wait for all of them to be registered
+        if (latDownN (lat, PH_REGISTERED, semgid, sh->playerRegistered[ret - 1], sh->fSt.nTeamPlayers + sh->fSt.nTeamGoalies - 1) == -1) {
+            perror("error on the up operation for semaphore access (GL)");
+            exit(EXIT_FAILURE);
+        }
 
         // Increment semaphore to let know the referee that the team is ready
         if (semUp(semgid, sh->refereeWaitTeams) == -1) {
@@ -237,18 +329,18 @@ static int goalieConstituteTeam (int id)
     }
 
     // If the goalie is waiting for a team to be formed
-    else if (sh->fSt.st.goalieStat[id] == WAITING_TEAM) {
+    else if (GOALIESTAT (&sh->fSt, id) == WAITING_TEAM) {
 
         // Decrement the semaphore to block the goalie process
-        if (semDown(semgid, sh->goaliesWaitTeam) == -1) {
+        if (latDown (lat, PH_WAITTEAM, semgid, GOALIESLOT (sh, id).sem) == -1) {
             perror("error on the up operation for semaphore access (GL)");
             exit(EXIT_FAILURE);
         }
 
-        ret = sh->fSt.teamId;           // Fetch the team ID of the newly formed team
+        ret = GOALIESLOT (sh, id).team;     // The captain wrote the team in the slot before calling
 
         // Increment the semaphore to register the goalie
-        if (semUp(semgid, sh->playerRegistered) == -1) {
+        if (semUp(semgid, sh->playerRegistered[ret - 1]) == -1) {
             perror("error on the up operation for semaphore access (GL)");
             exit(EXIT_FAILURE);
         }
@@ -268,27 +360,31 @@ static int goalieConstituteTeam (int id)
  */
 static void waitReferee (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
     // Update states of the goalie and save them
     if (team == 1) {
-        sh->fSt.st.goalieStat[id] = WAITING_START_1;
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), WAITING_START_1);
     } else if (team == 2) {
-        sh->fSt.st.goalieStat[id] = WAITING_START_2;
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), WAITING_START_2);
     }
 
-    saveState(nFic,&sh->fSt);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, LK_GL_WAITREFEREE, semgid, sh->mutex) == -1) {                          /* exit critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
+    saveSnapshot (nFic, &snap);
+
     // Blocks the goalie process until referee signals readiness
-    if (semDown(semgid, sh->playersWaitReferee) == -1) {
+    if (latDown (lat, PH_WAITREFEREE, semgid, GOALIESLOT (sh, id).sem) == -1) {
         perror("error on the up operation for semaphore access(GL)");
         exit(EXIT_FAILURE);
     }
@@ -305,7 +401,9 @@ static void waitReferee (int id, int team)
  */
 static void playUntilEnd (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
@@ -316,21 +414,61 @@ static void playUntilEnd (int id, int team)
     }
 
     if (team == 1) {
-        sh->fSt.st.goalieStat[id] = PLAYING_1;
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), PLAYING_1);
     } else if (team == 2) {
-        sh->fSt.st.goalieStat[id] = PLAYING_2;
+        seqSetState (&sh->fSt.st, &GOALIESTAT (&sh->fSt, id), PLAYING_2);
     }
     
-    saveState(nFic, &sh->fSt);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, LK_GL_PLAY, semgid, sh->mutex) == -1) {                                 /* exit critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
+
+    saveSnapshot (nFic, &snap);
     // Decrement the semaphore to ensure the goalie plays until the end of the game
-    if (semDown(semgid, sh->playersWaitEnd) == -1) {
+    if (latDown (lat, PH_WAITEND, semgid, GOALIESLOT (sh, id).sem) == -1) {
         perror("error on the up operation for semaphore access (GL)");
         exit(EXIT_FAILURE);
     }    
 }
 
+/**
+ *  \brief goalie waits for the next match of the tournament
+ *
+ *  The goalie reports the end of its present match and goes through the two turnstiles opened by the generator
+ *  once every entity has finished it (see matchBarrier in the generator).
+ */
+static void waitNextMatch (void)
+{
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
+        perror ("error on the down operation for semaphore access (GL)");
+        exit (EXIT_FAILURE);
+    }
+    sh->fSt.matchDone++;
+    if (lockUp (&sh->lock, LK_GL_MATCHDONE, semgid, sh->mutex) == -1) {                            /* exit critical region */
+        perror ("error on the up operation for semaphore access (GL)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (latDown (lat, PH_NEXTMATCH, semgid, sh->waitMatchEnd) == -1) {
+        perror ("error on the down operation for semaphore access (GL)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
+        perror ("error on the down operation for semaphore access (GL)");
+        exit (EXIT_FAILURE);
+    }
+    sh->fSt.matchReady++;
+    if (lockUp (&sh->lock, LK_GL_MATCHREADY, semgid, sh->mutex) == -1) {                           /* exit critical region */
+        perror ("error on the up operation for semaphore access (GL)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (latDown (lat, PH_NEXTMATCH, semgid, sh->waitMatchStart) == -1) {
+        perror ("error on the down operation for semaphore access (GL)");
+        exit (EXIT_FAILURE);
+    }
+}
@@ -30,18 +30,28 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entity.h"
+#include "pacing.h"
+#include "entitySlot.h"
+#include "stateSeq.h"
+#include "ipcPool.h"
 
-/** \brief logging file name */
-static char nFic[51];
+/* entity data, private to each thread when the entities run as threads of the generator */
 
-/** \brief shared memory block access identifier */
-static int shmid;
+/** \brief logging file name */
+static _Thread_local char nFic[51];
 
 /** \brief semaphore set access identifier */
-static int semgid;
+static _Thread_local int semgid;
 
 /** \brief pointer to shared memory region */
-static SHARED_DATA *sh;
+static _Thread_local SHARED_REGION *shr;
+
+/** \brief pointer to the shared data of the pitch where the player plays */
+static _Thread_local SHARED_DATA *sh;
+
+/** \brief latency stats of the player kind in its pitch, where the time spent in each protocol phase is accumulated */
+static _Thread_local LAT_STATS *lat;
 
 /** \brief player takes some time to arrive */
 static void arrive (int id);
@@ -55,6 +65,63 @@ static void waitReferee(int id, int team);
 /** \brief player waits for referee to end match */
 static void playUntilEnd(int id, int team);
 
+/** \brief player waits for the next match of the tournament */
+static void waitNextMatch (void);
+
+/**
+ *  \brief Life cycle of a player, once for each match of the tournament.
+ *
+ *  Runs either in a player process, once it is connected to the IPC resources, or in a thread of the generator,
+ *  which shares them directly (see entity.h).
+ *
+ *  \param id player id
+ *  \param logFile name of the logging file
+ *  \param semSet semaphore set access identifier
+ *  \param region pointer to the shared region
+ *
+ *  \return EXIT_SUCCESS, or EXIT_FAILURE when the id is wrong
+ */
+int runPlayer (unsigned int id, char logFile[], int semSet, SHARED_REGION *region)
+{
+    unsigned int n = id;
+    int team, match;
+
+    strcpy (nFic, logFile);
+    semgid = semSet;
+    shr = region;
+
+    /* the roster size is only known once the shared region is mapped */
+    if (n >= (unsigned int) shr->fSt.nPlayers) {
+        fprintf (stderr, "Player process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* the player plays in pitch n % nPitches, where it is player n / nPitches */
+    sh = PITCH (shr, n % shr->nPitches);
+    n /= shr->nPitches;
+
+    lat = &sh->lat[LAT_PLAYERS];
+
+    /* delays are drawn from a generator of its own, seeded by the generator of the entities */
+    pacingInit (shr->fSt.seed, shr->fSt.timeScale, id);
+
+    /* state records go to the log ring drained by the generator */
+    attachLogRing (LOGRING (shr));
+
+    /* simulation of the life cycle of the player, once for each match of the tournament */
+    for (match = 0; match < sh->fSt.nMatches; match++) {
+        if (match > 0) waitNextMatch ();
+        arrive(n);
+        if((team = playerConstituteTeam(n))!=0) {
+            waitReferee(n, team);
+            playUntilEnd(n, team);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#ifndef ENTITY_THREAD
 /**
  *  \brief Main program.
  *
@@ -63,11 +130,12 @@ static void playUntilEnd(int id, int team);
 int main (int argc, char *argv[])
 {
     int key;                                            /*access key to shared memory and semaphore set */
+    int shmid;                                                     /* shared memory access identifier */
     char *tinp;                                                       /* numerical parameters test flag */
-    int n, team;
+    int n, status;
 
     /* validation of command line parameters */
-    if (argc != 4) { 
+    if ((argc != 4) && (argc != 6)) { 
         freopen ("error_PL", "a", stderr);
         fprintf (stderr, "Number of parameters is incorrect!\n");
         return EXIT_FAILURE;
@@ -76,7 +144,7 @@ int main (int argc, char *argv[])
 
     /* get goalie id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMPLAYERS )) { 
+    if (*tinp != '\0') { 
         fprintf (stderr, "Player process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -89,46 +157,61 @@ int main (int argc, char *argv[])
     setbuf(stderr,NULL);
 
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+    if (argc == 6) {
+        /* identifiers of the semaphore set and the shared region passed on by the generator - argv[4], argv[5]
+           (fast startup): the shared region is mapped before waiting for the start of operations */
+        semgid = (int) strtol (argv[4], &tinp, 0);
+        if (*tinp == '\0') shmid = (int) strtol (argv[5], &tinp, 0);
+        if (*tinp != '\0') {
+            fprintf (stderr, "IPC identifiers are wrong!\n");
+            return EXIT_FAILURE;
+        }
+        if (shmemAttach (shmid, (void **) &shr) == -1) { 
+            perror ("error on mapping the shared region on the process address space");
+            return EXIT_FAILURE;
+        }
+        if (semConnectId (semgid) == -1) { 
+            perror ("error on connecting to the semaphore set");
+            return EXIT_FAILURE;
+        }
     }
+    else {
+        /* getting key value */
+        if ((key = ftok (".", 'a')) == -1) {
+            perror ("error on generating the key");
+            exit (EXIT_FAILURE);
+        }
 
-    /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
-       process address space */
-    if ((semgid = semConnect (key)) == -1) { 
-        perror ("error on connecting to the semaphore set");
-        return EXIT_FAILURE;
-    }
-    if ((shmid = shmemConnect (key)) == -1) { 
-        perror ("error on connecting to the shared memory region");
-        return EXIT_FAILURE;
-    }
-    if (shmemAttach (shmid, (void **) &sh) == -1) { 
-        perror ("error on mapping the shared region on the process address space");
-        return EXIT_FAILURE;
+        /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
+           process address space */
+        if ((semgid = semConnect (key)) == -1) { 
+            perror ("error on connecting to the semaphore set");
+            return EXIT_FAILURE;
+        }
+        if ((shmid = shmemConnect (key)) == -1) { 
+            perror ("error on connecting to the shared memory region");
+            return EXIT_FAILURE;
+        }
+        if (shmemAttach (shmid, (void **) &shr) == -1) { 
+            perror ("error on mapping the shared region on the process address space");
+            return EXIT_FAILURE;
+        }
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                                 
-
+    /* an entity left by a previous run of the IPC pool takes no part in this one (see ipcPool.h) */
+    ipcJoin (shr);
 
-    /* simulation of the life cycle of the player */
-    arrive(n);
-    if((team = playerConstituteTeam(n))!=0) {
-        waitReferee(n, team);
-        playUntilEnd(n, team);
-    }
+    status = runPlayer ((unsigned int) n, nFic, semgid, shr);
 
     /* unmapping the shared region off the process address space */
-    if (shmemDettach (sh) == -1) {
+    if (shmemDettach (shr) == -1) {
         perror ("error on unmapping the shared region off the process address space");
         return EXIT_FAILURE;;
     }
 
-    return EXIT_SUCCESS;
+    return status;
 }
+#endif /* ENTITY_THREAD */
 
 /**
  *  \brief player takes some time to arrive
@@ -139,31 +222,38 @@ int main (int argc, char *argv[])
  */
 static void arrive(int id)
 {    
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
     /* TODO: insert your code here */
-    sh->fSt.st.playerStat[id] = ARRIVING;   //atualizei o estado do jogador (arriving)
-    saveState(nFic, &sh->fSt);              //salvar o estado
+    seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), ARRIVING);   //atualizei o estado do jogador (arriving)
+    latSnapshot (lat, nFic, &sh->fSt, &snap); //salvar o estado
     
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, LK_PL_ARRIVE, semgid, sh->mutex) == -1) {                               /* exit critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-    usleep((200.0*random())/(RAND_MAX+1.0)+50.0);
+    saveSnapshot (nFic, &snap);
+
+    pace (50.0, 200.0);
 }
 
 /**
  *  \brief player constitutes team
  *
- *  If player is late, it updates state and leaves.
- *  If there are enough free players and free goalies to form a team, player forms team allowing 
- *  team members to proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
+ *  The player takes an arrival ticket with an atomic fetch-add: if it is late, it records its state
+ *  and leaves without entering the critical region.
+ *  If there are enough free players and free goalies to form a team, player forms team: it reserves the
+ *  team members and the team id in the critical region, then, out of it, allows team members to proceed
+ *  and waits for them to acknowledge registration.
+ *  Otherwise it updates state, queues in the players waiting for a team and waits for the forming
+ *  teammate to "call" him, on its private semaphore; it reads its team from its slot and acknowledges
+ *  registration to the captain of that team.
  *  The internal state should be saved.
  *
  *  \param id player id
@@ -173,97 +263,84 @@ static void arrive(int id)
  */
 static int playerConstituteTeam (int id)
 {
-    int ret = 0;
+    int ret = 0,
+        site;                                              /* call site of the critical region (see lockProf.h) */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    // If there are already the necessary number of players for 2 teams, the player is late
+    if (atomic_fetch_add (&sh->fSt.playersArrived, 1) >= 2 * sh->fSt.nTeamPlayers) {
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), LATE);            /* no critical region: seen by observers */
+        snapshotEntity (nFic, &sh->fSt, (unsigned int) id, LATE);
+        return 0;
+    }
 
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.playersArrived++;   // Increment the number of players that have arrived
     sh->fSt.playersFree++;      // Increment the number of players without a team
 
-    // If there are less players than the necessary number to form 2 teams:
-    if (sh->fSt.playersArrived <= 2 * NUMTEAMPLAYERS) {
+    // If there are enough players and a goalie to form a team:
+    if (sh->fSt.playersFree >= sh->fSt.nTeamPlayers && sh->fSt.goaliesFree >= sh->fSt.nTeamGoalies) {
         
-        // If there are enough players and a goalie to form a team:
-        if (sh->fSt.playersFree >= NUMTEAMPLAYERS && sh->fSt.goaliesFree >= NUMTEAMGOALIES) {
-            
-            // In this case: a player is the captain
-            sh->fSt.st.playerStat[id] = FORMING_TEAM;
-
-            // For each player, except the captain
-            for (int i = 0; i < NUMTEAMPLAYERS - 1; i++) {     
-
-                // Signal the waiting player to proceed
-                if (semUp(semgid, sh->playersWaitTeam) == -1) {
-                    perror("error on the up operation for semaphore access (PL)");
-                    exit(EXIT_FAILURE);
-                }
-
-                // The captain waits for the player to confirm is registration
-                if (semDown(semgid, sh->playerRegistered) == -1) {
-                    perror("error on the down operation for semaphore access (PL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-
-            sh->fSt.playersFree -= NUMTEAMPLAYERS;      // Decrement the number of free players
-
-            // Signal the waiting goalie to proceed
-            if (semUp(semgid, sh->goaliesWaitTeam) == -1) { 
-                perror("error on the up operation for semaphore access (GL)");
-                exit(EXIT_FAILURE);
-            }
-
-            // The captain waits for the goalie to confirm is registration
-            if (semDown(semgid, sh->playerRegistered) == -1) {
-                perror("error on the down operation for semaphore access (PL)");
-                exit(EXIT_FAILURE);
-            }
-            
-            sh->fSt.goaliesFree -= NUMTEAMGOALIES;      // Decrement the number of free goalies
-            ret = sh->fSt.teamId++;                     // Change to the next team
-            saveState(nFic, &sh->fSt); 
-
-        // If there are not enough players to form a team:
-        } else {
-            sh->fSt.st.playerStat[id] = WAITING_TEAM; 
-            saveState(nFic, &sh->fSt);
-        }
-
-    // If there are more than the necessary number of players for 2 teams:
+        // In this case: a player is the captain
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), FORMING_TEAM);
+        site = LK_PL_CAPTAIN;
+
+        // Reserve the teammates (all players except the captain, and the goalie) and the team id
+        sh->fSt.playersFree -= sh->fSt.nTeamPlayers;      // Decrement the number of free players
+        sh->fSt.goaliesFree -= sh->fSt.nTeamGoalies;      // Decrement the number of free goalies
+        ret = sh->fSt.teamId++;                     // Change to the next team
+        slotFormTeam (sh, ret, PLAYERSLOTID (sh, id), sh->fSt.nTeamPlayers - 1, sh->fSt.nTeamGoalies);
+        latSnapshot (lat, nFic, &sh->fSt, &snap); 
+
+    // If there are not enough players to form a team:
     } else {
-        ret = 0;
-        sh->fSt.st.playerStat[id] = LATE;  
-        sh->fSt.playersFree--;              // Decrement the number of free players
-        saveState(nFic, &sh->fSt);
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), WAITING_TEAM); 
+        site = LK_PL_QUEUE;
+        slotEnqueue (sh, &sh->playersWaiting, PLAYERSLOTID (sh, id));
+        latSnapshot (lat, nFic, &sh->fSt, &snap);
     }
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, site, semgid, sh->mutex) == -1) {                                       /* exit critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
+    saveSnapshot (nFic, &snap);
+
     // If the player is waiting for a team to be formed:
-    if (sh->fSt.st.playerStat[id] == WAITING_TEAM) {
+    if (PLAYERSTAT (&sh->fSt, id) == WAITING_TEAM) {
 
         // Confirm that one player is waiting for a team to be formed
-        if (semDown(semgid, sh->playersWaitTeam) == -1) { 
+        if (latDown (lat, PH_WAITTEAM, semgid, PLAYERSLOT (sh, id).sem) == -1) { 
             perror ("error on the down operation for semaphore access (PL)");                                    
             exit(EXIT_FAILURE);
         }
 
-        ret = sh->fSt.teamId;               // Return the current team's ID
+        ret = PLAYERSLOT (sh, id).team;     // The captain wrote the team in the slot before calling
 
         // Confirm one player as been registered
-        if (semUp(semgid, sh->playerRegistered) == -1) {
+        if (semUp(semgid, sh->playerRegistered[ret - 1]) == -1) {
             perror ("error on the up operation for semaphore access (PL)");
             exit(EXIT_FAILURE);
         }
 
     // If the player is forming a team:
-    } else if (sh->fSt.st.playerStat[id] == FORMING_TEAM) {
+    } else if (PLAYERSTAT (&sh->fSt, id) == FORMING_TEAM) {
+
+        // Signal the reserved teammates (all players except the captain, and the goalie) to proceed
+        if (slotWakeTeam (semgid, sh, ret, PLAYERSLOTID (sh, id)) == -1) {
+            perror("error on the up operation for semaphore access (PL)");
+            exit(EXIT_FAILURE);
+        }
+
+        // The captain waits for all of them to confirm their registration
+        if (latDownN (lat, PH_REGISTERED, semgid, sh->playerRegistered[ret - 1], sh->fSt.nTeamPlayers - 1 + sh->fSt.nTeamGoalies) == -1) {
+            perror("error on the down operation for semaphore access (PL)");
+            exit(EXIT_FAILURE);
+        }
         
         // Signals the referee to proceed 
         if (semUp(semgid, sh->refereeWaitTeams) == -1) {
@@ -286,7 +363,9 @@ static int playerConstituteTeam (int id)
  */
 static void waitReferee (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
@@ -294,20 +373,22 @@ static void waitReferee (int id, int team)
     /* TODO: insert your code here */
 
     if (team == 1) {
-        sh->fSt.st.playerStat[id] = WAITING_START_1;
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), WAITING_START_1);
     } else if (team == 2) {
-        sh->fSt.st.playerStat[id] = WAITING_START_2;
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), WAITING_START_2);
     }   
     
-    saveState(nFic, &sh->fSt);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, LK_PL_WAITREFEREE, semgid, sh->mutex) == -1) {                          /* exit critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
+    saveSnapshot (nFic, &snap);
+
     /* TODO: insert your code here */
-    if (semDown(semgid, sh->playersWaitReferee) == -1) {                                      
+    if (latDown (lat, PH_WAITREFEREE, semgid, PLAYERSLOT (sh, id).sem) == -1) {                                      
         perror("error on the down operation for semaphore access (PL)");
         exit(EXIT_FAILURE);
     }
@@ -324,15 +405,17 @@ static void waitReferee (int id, int team)
  */
 static void playUntilEnd (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
         perror ("error on the up operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
     if (team == 1) {
-        sh->fSt.st.playerStat[id] = PLAYING_1;
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), PLAYING_1);
     } else if (team == 2) {
-        sh->fSt.st.playerStat[id] = PLAYING_2;
+        seqSetState (&sh->fSt.st, &PLAYERSTAT (&sh->fSt, id), PLAYING_2);
     }  
 
     if (semUp(semgid, sh->playing) == -1) {                                      
@@ -340,18 +423,56 @@ static void playUntilEnd (int id, int team)
         exit(EXIT_FAILURE);
     }
 
-    saveState(nFic, &sh->fSt);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+    if (lockUp (&sh->lock, LK_PL_PLAY, semgid, sh->mutex) == -1) {                                 /* exit critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-    if (semDown(semgid, sh->playersWaitEnd) == -1) {                                         
+    saveSnapshot (nFic, &snap);
+
+    if (latDown (lat, PH_WAITEND, semgid, PLAYERSLOT (sh, id).sem) == -1) {                                         
         perror("error on the down operation for semaphore access (PL)");
         exit(EXIT_FAILURE);
     }
 }
 
+/**
+ *  \brief player waits for the next match of the tournament
+ *
+ *  The player reports the end of its present match and goes through the two turnstiles opened by the generator
+ *  once every entity has finished it (see matchBarrier in the generator).
+ */
+static void waitNextMatch (void)
+{
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
+        perror ("error on the down operation for semaphore access (PL)");
+        exit (EXIT_FAILURE);
+    }
+    sh->fSt.matchDone++;
+    if (lockUp (&sh->lock, LK_PL_MATCHDONE, semgid, sh->mutex) == -1) {                            /* exit critical region */
+        perror ("error on the up operation for semaphore access (PL)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (latDown (lat, PH_NEXTMATCH, semgid, sh->waitMatchEnd) == -1) {
+        perror ("error on the down operation for semaphore access (PL)");
+        exit (EXIT_FAILURE);
+    }
 
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
+        perror ("error on the down operation for semaphore access (PL)");
+        exit (EXIT_FAILURE);
+    }
+    sh->fSt.matchReady++;
+    if (lockUp (&sh->lock, LK_PL_MATCHREADY, semgid, sh->mutex) == -1) {                           /* exit critical region */
+        perror ("error on the up operation for semaphore access (PL)");
+        exit (EXIT_FAILURE);
+    }
 
+    if (latDown (lat, PH_NEXTMATCH, semgid, sh->waitMatchStart) == -1) {
+        perror ("error on the down operation for semaphore access (PL)");
+        exit (EXIT_FAILURE);
+    }
+}
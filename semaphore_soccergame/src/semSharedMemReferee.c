@@ -34,19 +34,29 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entity.h"
+#include "pacing.h"
+#include "entitySlot.h"
+#include "stateSeq.h"
+#include "ipcPool.h"
 
 
-/** \brief logging file name */
-static char nFic[51];
+/* entity data, private to each thread when the entities run as threads of the generator */
 
-/** \brief shared memory block access identifier */
-static int shmid;
+/** \brief logging file name */
+static _Thread_local char nFic[51];
 
 /** \brief semaphore set access identifier */
-static int semgid;
+static _Thread_local int semgid;
 
 /** \brief pointer to shared memory region */
-static SHARED_DATA *sh;
+static _Thread_local SHARED_REGION *shr;
+
+/** \brief pointer to the shared data of the pitch the referee is in charge of */
+static _Thread_local SHARED_DATA *sh;
+
+/** \brief latency stats of the referee kind in its pitch, where the time spent in each protocol phase is accumulated */
+static _Thread_local LAT_STATS *lat;
 
 /** \brief referee takes some time to arrive */
 static void arrive ();
@@ -63,6 +73,60 @@ static void play ();
 /** \brief referee ends game */
 static void endGame ();
 
+/** \brief referee waits for the next match of the tournament */
+static void waitNextMatch (void);
+
+/**
+ *  \brief Life cycle of a referee, once for each match of the tournament.
+ *
+ *  Runs either in a referee process, once it is connected to the IPC resources, or in a thread of the generator,
+ *  which shares them directly (see entity.h).
+ *
+ *  \param id referee id
+ *  \param logFile name of the logging file
+ *  \param semSet semaphore set access identifier
+ *  \param region pointer to the shared region
+ *
+ *  \return EXIT_SUCCESS, or EXIT_FAILURE when the id is wrong
+ */
+int runReferee (unsigned int id, char logFile[], int semSet, SHARED_REGION *region)
+{
+    unsigned int n = id;
+    int match;
+
+    strcpy (nFic, logFile);
+    semgid = semSet;
+    shr = region;
+
+    /* the number of pitches is only known once the shared region is mapped */
+    if (n >= shr->nPitches) {
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
+    sh = PITCH (shr, n);
+
+    lat = &sh->lat[LAT_REFEREES];
+
+    /* delays are drawn from a generator of its own, seeded by the generator of the entities */
+    pacingInit (shr->fSt.seed, shr->fSt.timeScale, (unsigned int) (shr->fSt.nPlayers + shr->fSt.nGoalies) + id);
+
+    /* state records go to the log ring drained by the generator */
+    attachLogRing (LOGRING (shr));
+
+    /* simulation of the life cycle of the referee, once for each match of the tournament */
+    for (match = 0; match < sh->fSt.nMatches; match++) {
+        if (match > 0) waitNextMatch ();
+        arrive();
+        waitForTeams();
+        startGame();
+        play();
+        endGame();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#ifndef ENTITY_THREAD
 /**
  *  \brief Main program.
  *
@@ -71,15 +135,24 @@ static void endGame ();
 int main (int argc, char *argv[])
 {
     int key;                                          /*access key to shared memory and semaphore set */
+    int shmid;                                                     /* shared memory access identifier */
+    char *tinp;                                                       /* numerical parameters test flag */
+    unsigned int n;                                                                  /* referee id = pitch */
+    int status;                                                                       /* life cycle status */
 
     /* validation of command line parameters */
-    if (argc != 4) { 
+    if ((argc != 4) && (argc != 6)) { 
         freopen ("error_RF", "a", stderr);
         fprintf (stderr, "Number of parameters is incorrect!\n");
         return EXIT_FAILURE;
     }
 
-    /* argv[1] may be ignored as there is only one referee - id=0 */
+    /* get referee id - argv[1], the referee of pitch n */
+    n = (unsigned int) strtol (argv[1], &tinp, 0);
+    if (*tinp != '\0') { 
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
@@ -88,45 +161,61 @@ int main (int argc, char *argv[])
     freopen (argv[3], "w", stderr);
     setbuf(stderr,NULL);
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+    if (argc == 6) {
+        /* identifiers of the semaphore set and the shared region passed on by the generator - argv[4], argv[5]
+           (fast startup): the shared region is mapped before waiting for the start of operations */
+        semgid = (int) strtol (argv[4], &tinp, 0);
+        if (*tinp == '\0') shmid = (int) strtol (argv[5], &tinp, 0);
+        if (*tinp != '\0') {
+            fprintf (stderr, "IPC identifiers are wrong!\n");
+            return EXIT_FAILURE;
+        }
+        if (shmemAttach (shmid, (void **) &shr) == -1) { 
+            perror ("error on mapping the shared region on the process address space");
+            return EXIT_FAILURE;
+        }
+        if (semConnectId (semgid) == -1) { 
+            perror ("error on connecting to the semaphore set");
+            return EXIT_FAILURE;
+        }
     }
+    else {
+        /* getting key value */
+        if ((key = ftok (".", 'a')) == -1) {
+            perror ("error on generating the key");
+            exit (EXIT_FAILURE);
+        }
 
-    /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
-       process address space */
-    if ((semgid = semConnect (key)) == -1) { 
-        perror ("error on connecting to the semaphore set");
-        return EXIT_FAILURE;
-    }
-    if ((shmid = shmemConnect (key)) == -1) { 
-        perror ("error on connecting to the shared memory region");
-        return EXIT_FAILURE;
-    }
-    if (shmemAttach (shmid, (void **) &sh) == -1) { 
-        perror ("error on mapping the shared region on the process address space");
-        return EXIT_FAILURE;
+        /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
+           process address space */
+        if ((semgid = semConnect (key)) == -1) { 
+            perror ("error on connecting to the semaphore set");
+            return EXIT_FAILURE;
+        }
+        if ((shmid = shmemConnect (key)) == -1) { 
+            perror ("error on connecting to the shared memory region");
+            return EXIT_FAILURE;
+        }
+        if (shmemAttach (shmid, (void **) &shr) == -1) { 
+            perror ("error on mapping the shared region on the process address space");
+            return EXIT_FAILURE;
+        }
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                      
+    /* an entity left by a previous run of the IPC pool takes no part in this one (see ipcPool.h) */
+    ipcJoin (shr);
 
-    /* simulation of the life cycle of the referee */
-    arrive();
-    waitForTeams();
-    startGame();
-    play();
-    endGame();
+    status = runReferee ((unsigned int) n, nFic, semgid, shr);
 
     /* unmapping the shared region off the process address space */
-    if (shmemDettach (sh) == -1) { 
+    if (shmemDettach (shr) == -1) { 
         perror ("error on unmapping the shared region off the process address space");
         return EXIT_FAILURE;;
     }
 
-    return EXIT_SUCCESS;
+    return status;
 }
+#endif /* ENTITY_THREAD */
 
 /**
  *  \brief referee takes some time to arrive
@@ -137,21 +226,25 @@ int main (int argc, char *argv[])
  */
 static void arrive ()
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1) {                                                    /* enter critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
     // Update and save referee state
-    sh->fSt.st.refereeStat = ARRIVING;
-    saveState(nFic, &sh->fSt);
+    seqSetState (&sh->fSt.st, &REFEREESTAT (&sh->fSt, 0), ARRIVING);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
+    if (lockUp (&sh->lock, LK_RF_ARRIVE, semgid, sh->mutex) == -1) {                              /* leave critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
+
+    saveSnapshot (nFic, &snap);
     
-    usleep((100.0*random())/(RAND_MAX+1.0)+10.0);
+    pace (10.0, 100.0);
     
 }
 
@@ -164,27 +257,27 @@ static void arrive ()
  */
 static void waitForTeams ()
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1) {                                                    /* enter critical region */
         perror ("error on the down operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = WAITING_TEAMS;     
-    saveState(nFic, &sh->fSt);
+    seqSetState (&sh->fSt.st, &REFEREESTAT (&sh->fSt, 0), WAITING_TEAMS);     
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
+    if (lockUp (&sh->lock, LK_RF_WAITTEAMS, semgid, sh->mutex) == -1) {                           /* leave critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    // For each team:
-    for (int i = 0; i < 2; i++) {
+    saveSnapshot (nFic, &snap);
 
-        // Confirms both teams have been formed
-        if (semDown(semgid, sh->refereeWaitTeams) == -1) {
-            perror("error on the down operation for semaphore access (RF)");
-            exit(EXIT_FAILURE);
-        }
+    // Confirms both teams have been formed
+    if (latDownN (lat, PH_WAITTEAMS, semgid, sh->refereeWaitTeams, 2) == -1) {
+        perror("error on the down operation for semaphore access (RF)");
+        exit(EXIT_FAILURE);
     }
 }
 
@@ -197,35 +290,33 @@ static void waitForTeams ()
  */
 static void startGame ()
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1) {                                                    /* enter critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = STARTING_GAME;
-    saveState(nFic, &sh->fSt);
+    seqSetState (&sh->fSt.st, &REFEREESTAT (&sh->fSt, 0), STARTING_GAME);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
+    if (lockUp (&sh->lock, LK_RF_STARTGAME, semgid, sh->mutex) == -1) {                           /* leave critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    // For each player in a team:
-    for (int i = 0; i < 2 * (NUMTEAMGOALIES + NUMTEAMPLAYERS); i++) {
+    saveSnapshot (nFic, &snap);
 
-        // Signal the players and goalies the game is starting
-        if (semUp(semgid, sh->playersWaitReferee) == -1) {
-            perror("error on the up operation for semaphore access (PL)");
-            exit(EXIT_FAILURE);
-        }
+    // Signal the players and goalies of each team the game is starting
+    if ((slotWakeTeam (semgid, sh, 1, -1) == -1) || (slotWakeTeam (semgid, sh, 2, -1) == -1)) {
+        perror("error on the up operation for semaphore access (PL)");
+        exit(EXIT_FAILURE);
     }
 
     // Confirm the referee the players are ready
-    for (int i = 0; i < NUMPLAYERS; i++) {
-        if (semDown(semgid, sh->playing) == -1) {
-            perror("error on the down operation for semaphore access (PL)");
-            exit(EXIT_FAILURE);
-        }
+    if (latDownN (lat, PH_PLAYING, semgid, sh->playing, 2 * (sh->fSt.nTeamGoalies + sh->fSt.nTeamPlayers)) == -1) {
+        perror("error on the down operation for semaphore access (PL)");
+        exit(EXIT_FAILURE);
     }
 }
 
@@ -238,20 +329,24 @@ static void startGame ()
  */
 static void play ()
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1) {                                                    /* enter critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = REFEREEING;
-    saveState(nFic, &sh->fSt);
+    seqSetState (&sh->fSt.st, &REFEREESTAT (&sh->fSt, 0), REFEREEING);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
+    if (lockUp (&sh->lock, LK_RF_PLAY, semgid, sh->mutex) == -1) {                                /* leave critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    usleep((100.0*random())/(RAND_MAX+1.0)+900.0);
+    saveSnapshot (nFic, &snap);
+
+    pace (900.0, 100.0);
 }
 
 /**
@@ -263,26 +358,65 @@ static void play ()
  */
 static void endGame ()
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
+    STATE_SNAPSHOT snap;                                                                /* log record snapshot */
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1) {                                                    /* enter critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = ENDING_GAME;
-    saveState(nFic, &sh->fSt);
+    seqSetState (&sh->fSt.st, &REFEREESTAT (&sh->fSt, 0), ENDING_GAME);
+    latSnapshot (lat, nFic, &sh->fSt, &snap);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
+    if (lockUp (&sh->lock, LK_RF_ENDGAME, semgid, sh->mutex) == -1) {                             /* leave critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    // For each player:
-    for (int i = 0; i < NUMPLAYERS; i++) {
+    saveSnapshot (nFic, &snap);
 
-        // Signal the players the game has ended
-        if (semUp(semgid, sh->playersWaitEnd) == -1) {
-            perror("error on the up operation for semaphore access (PL)");
-            exit(EXIT_FAILURE);
-        }
+    // Signal the players of each team the game has ended
+    if ((slotWakeTeam (semgid, sh, 1, -1) == -1) || (slotWakeTeam (semgid, sh, 2, -1) == -1)) {
+        perror("error on the up operation for semaphore access (PL)");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief referee waits for the next match of the tournament
+ *
+ *  The referee reports the end of its present match and goes through the two turnstiles opened by the generator
+ *  once every entity has finished it (see matchBarrier in the generator).
+ */
+static void waitNextMatch (void)
+{
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
+        perror ("error on the down operation for semaphore access (RF)");
+        exit (EXIT_FAILURE);
+    }
+    sh->fSt.matchDone++;
+    if (lockUp (&sh->lock, LK_RF_MATCHDONE, semgid, sh->mutex) == -1) {                            /* exit critical region */
+        perror ("error on the up operation for semaphore access (RF)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (latDown (lat, PH_NEXTMATCH, semgid, sh->waitMatchEnd) == -1) {
+        perror ("error on the down operation for semaphore access (RF)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (lockDown (&sh->lock, lat, semgid, sh->mutex) == -1)  {                                                   /* enter critical region */
+        perror ("error on the down operation for semaphore access (RF)");
+        exit (EXIT_FAILURE);
+    }
+    sh->fSt.matchReady++;
+    if (lockUp (&sh->lock, LK_RF_MATCHREADY, semgid, sh->mutex) == -1) {                           /* exit critical region */
+        perror ("error on the up operation for semaphore access (RF)");
+        exit (EXIT_FAILURE);
+    }
+
+    if (latDown (lat, PH_NEXTMATCH, semgid, sh->waitMatchStart) == -1) {
+        perror ("error on the down operation for semaphore access (RF)");
+        exit (EXIT_FAILURE);
     }
 }
@@ -4,25 +4,46 @@
  *  \brief Semaphore management.
  *
  *  Operations defined on semaphores:
- *     \li creation of a set of semaphores
- *     \li connection to a previously created set of semaphores
+ *     \li creation of a set of semaphores, possibly reusing the one left by a previous run
+ *     \li connection to a previously created set of semaphores, by its key or by its identifier
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>down</em> of a semaphore within the set that does not block
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> and <em>up</em> by several units of a semaphore within the set
+ *     \li <em>down</em> that spins for a while before blocking
+ *     \li atomic operation on several semaphores within the set.
  *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
 #include <assert.h>
 
+#include "semaphore.h"
+
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/* internal functions */
+
+/* pause instruction of a spin loop: it lets the other hardware thread of the core run */
+static void relax (void)
+{
+#if defined (__x86_64__) || defined (__i386__)
+  __builtin_ia32_pause ();
+#elif defined (__aarch64__)
+  __asm__ __volatile__ ("yield");
+#endif
+}
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -41,6 +62,44 @@ int semCreate (int key, unsigned int snum)
   return semget ((key_t) key, snum+1, MASK | IPC_CREAT | IPC_EXCL);
 }
 
+/**
+ *  \brief Creation of a set of semaphores, or reuse of the set left with the same key by a previous run.
+ *
+ *  A set with at least <tt>snum</tt> semaphores is reset in place: all of them, the start of operations one included,
+ *  are set to <em>red state</em> at once; a smaller one is destroyed and a new set is created, as when there is none.
+ *
+ *  The semaphores are reset with a single <tt>semctl</tt> SETALL. Processes still blocked on them stay blocked
+ *  until an <em>up</em> of the new run wakes them. A set that is destroyed wakes them with EIDRM.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semReuse (int key, unsigned int snum)
+{
+  union semun { int val; struct semid_ds *buf; unsigned short *array; } arg;           /* semctl argument */
+  struct semid_ds ds;                                                                   /* set attributes */
+  unsigned short *red;                                                                  /* values of the set */
+  int semgid, stat;                                                                     /* set identifier */
+
+  if ((semgid = semget ((key_t) key, 0, MASK)) == -1)
+     return (errno == ENOENT) ? semCreate (key, snum) : -1;
+  arg.buf = &ds;
+  if (semctl (semgid, 0, IPC_STAT, arg) == -1)
+     return -1;
+  if (ds.sem_nsems < snum + 1)
+     return (semctl (semgid, 0, IPC_RMID, NULL) == -1) ? -1 : semCreate (key, snum);
+  if ((red = calloc (ds.sem_nsems, sizeof (unsigned short))) == NULL)
+     return -1;
+  arg.array = red;
+  stat = semctl (semgid, 0, SETALL, arg);
+  free (red);
+  return (stat == -1) ? -1 : semgid;
+}
+
 /**
  *  \brief Connection to a previously created set of semaphores.
  *
@@ -64,6 +123,28 @@ int semConnect (int key)
              else return semgid;
 }
 
+/**
+ *  \brief Connection to a previously created set of semaphores, given its identifier.
+ *
+ *  The identifier is passed on by the creator to the processes it launches, so that they need neither the creation
+ *  key nor a look up. As <tt>semConnect</tt>, the function waits for the start of operations.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier, as returned to the creator by <tt>semCreate</tt>
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnectId (int semgid)
+{
+  struct sembuf init[2] = {{ 0, -1, 0 }, {0, 1, 0}};                                     /* initialization operation */
+
+  if (semop (semgid, init, 2) == -1)
+     return -1;
+     else return semgid;
+}
+
 /**
  *  \brief Destruction of a previously created set of semaphores.
  *
@@ -119,6 +200,28 @@ int semDown (int semgid, unsigned int sindex)
   return semop (semgid, &down, 1);
 }
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, only when it can be done at once.
+ *
+ *  The caller never blocks: if the semaphore is in <em>red state</em>, the function fails with EAGAIN.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs or the semaphore is red (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semTryDown (int semgid, unsigned int sindex)
+{
+  struct sembuf down = { 0, -1, IPC_NOWAIT };                                    /* specific non-blocking down operation */
+
+  assert(sindex>0);
+  down.sem_num = (unsigned short) sindex;
+  return semop (semgid, &down, 1);
+}
+
 /**
  *  \brief <em>Up</em> of a semaphore within the set.
  *
@@ -139,3 +242,113 @@ int semUp (int semgid, unsigned int sindex)
   up.sem_num = (unsigned short) sindex;
   return semop (semgid, &up, 1);
 }
+
+/**
+ *  \brief <em>Down</em> by <tt>n</tt> units of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf down = { 0, 0, 0 };                                                   /* specific down operation */
+
+  assert((sindex>0) && (n>0) && (n<=SHRT_MAX));
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = (short) -(short) n;
+  return semop (semgid, &down, 1);
+}
+
+/**
+ *  \brief <em>Down</em> by <tt>n</tt> units of a semaphore within the set, spinning for a while before blocking.
+ *
+ *  Every poll is a <tt>semop</tt> with IPC_NOWAIT: spinning saves the sleep and the wake up of the caller, not the
+ *  system calls.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *  \param spin largest number of polls before blocking (0 blocks at once)
+ *
+ *  \return SEM_TAKEN, SEM_SPUN or SEM_SLEPT, upon success, as the units were taken
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownSpin (int semgid, unsigned int sindex, unsigned int n, unsigned int spin)
+{
+  struct sembuf down = { 0, 0, IPC_NOWAIT };                                          /* specific down operation */
+  unsigned int i;                                                                                 /* poll counter */
+
+  assert((sindex>0) && (n>0) && (n<=SHRT_MAX));
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = (short) -(short) n;
+  for (i = 0; i <= spin; i++)
+  { if (semop (semgid, &down, 1) == 0)
+       return (i == 0) ? SEM_TAKEN : SEM_SPUN;
+    if (errno != EAGAIN)
+       return -1;
+    relax ();
+  }
+  down.sem_flg = 0;
+  return (semop (semgid, &down, 1) == -1) ? -1 : SEM_SLEPT;
+}
+
+/**
+ *  \brief <em>Up</em> by <tt>n</tt> units of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf up = { 0, 0, 0 };                                                       /* specific up operation */
+
+  assert((sindex>0) && (n>0) && (n<=SHRT_MAX));
+  up.sem_num = (unsigned short) sindex;
+  up.sem_op = (short) n;
+  return semop (semgid, &up, 1);
+}
+
+/**
+ *  \brief Atomic operation on several semaphores within the set.
+ *
+ *  All operations are handed to the kernel in a single <tt>semop</tt>, which carries them out atomically.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops operations to be carried out
+ *  \param nops number of operations (1 .. SEM_MAXOPS)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semOps (int semgid, const SEMOP ops[], unsigned int nops)
+{
+  struct sembuf op[SEM_MAXOPS];                                                           /* specific operations */
+  unsigned int i;
+
+  assert((nops>0) && (nops<=SEM_MAXOPS));
+  for (i = 0; i < nops; i++)
+  { assert((ops[i].sindex>0) && (ops[i].delta>=SHRT_MIN) && (ops[i].delta<=SHRT_MAX));
+    op[i].sem_num = (unsigned short) ops[i].sindex;
+    op[i].sem_op = (short) ops[i].delta;
+    op[i].sem_flg = 0;
+  }
+  return semop (semgid, op, nops);
+}
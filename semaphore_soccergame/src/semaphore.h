@@ -4,12 +4,16 @@
  *  \brief Semaphore management.
  *
  *  Operations defined on semaphores:
- *     \li creation of a set of semaphores
- *     \li connection to a previously created set of semaphores
+ *     \li creation of a set of semaphores, possibly reusing the one left by a previous run
+ *     \li connection to a previously created set of semaphores, by its key or by its identifier
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>down</em> of a semaphore within the set that does not block
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> and <em>up</em> by several units of a semaphore within the set
+ *     \li <em>down</em> that spins for a while before blocking
+ *     \li atomic operation on several semaphores within the set.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -17,6 +21,29 @@
 #ifndef SEMAPHORE_H_
 #define SEMAPHORE_H_
 
+/**
+ *  \brief Definition of <em>operation on a semaphore</em> data type, used by <tt>semOps</tt>.
+ */
+typedef struct {
+    /** \brief semaphore location in the set (1 .. snum) */
+    unsigned int sindex;
+    /** \brief units to add (up) or remove (down) */
+    int delta;
+} SEMOP;
+
+/** \brief largest number of operations carried out by a single semOps, in both implementations (well within
+           SEMOPM, the bound of a System V <tt>semop</tt>); larger batches must be split by the caller */
+#define  SEM_MAXOPS     16
+
+/* Outcomes of semDownSpin */
+
+/** \brief the semaphore was green: the units were taken at once */
+#define  SEM_TAKEN      0
+/** \brief the units were taken while spinning */
+#define  SEM_SPUN       1
+/** \brief the units were taken after blocking */
+#define  SEM_SLEPT      2
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -32,6 +59,21 @@
 
 extern int semCreate (int key, unsigned int snum);
 
+/**
+ *  \brief Creation of a set of semaphores, or reuse of the set left with the same key by a previous run.
+ *
+ *  A set with at least <tt>snum</tt> semaphores is reset in place: all of them, the start of operations one included,
+ *  are set to <em>red state</em> at once; a smaller one is destroyed and a new set is created, as when there is none.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semReuse (int key, unsigned int snum);
+
 /**
  *  \brief Connection to a previously created set of semaphores.
  *
@@ -45,6 +87,21 @@ extern int semCreate (int key, unsigned int snum);
 
 extern int semConnect (int key);
 
+/**
+ *  \brief Connection to a previously created set of semaphores, given its identifier.
+ *
+ *  The identifier is passed on by the creator to the processes it launches, so that they need neither the creation
+ *  key nor a look up. As <tt>semConnect</tt>, the function waits for the start of operations.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier, as returned to the creator by <tt>semCreate</tt>
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semConnectId (int semgid);
+
 /**
  *  \brief Destruction of a previously created set of semaphores.
  *
@@ -85,6 +142,21 @@ extern int semSignal (int semgid);
 
 extern int semDown (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, only when it can be done at once.
+ *
+ *  The caller never blocks: if the semaphore is in <em>red state</em>, the function fails with EAGAIN.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs or the semaphore is red (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semTryDown (int semgid, unsigned int sindex);
+
 /**
  *  \brief <em>Up</em> of a semaphore within the set.
  *
@@ -99,4 +171,74 @@ extern int semDown (int semgid, unsigned int sindex);
 
 extern int semUp (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> by <tt>n</tt> units of a semaphore within the set.
+ *
+ *  The operation is atomic: the caller blocks until the semaphore value reaches <tt>n</tt> and then
+ *  decrements it by <tt>n</tt>.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief <em>Down</em> by <tt>n</tt> units of a semaphore within the set, spinning for a while before blocking.
+ *
+ *  A drop-in for <tt>semDownN</tt> where the wait is expected to be short: when the units are not there, the value
+ *  is polled up to <tt>spin</tt> times, with a pause instruction in between, before the caller blocks as in
+ *  <tt>semDownN</tt>. A poll is a load of the value with the futex implementation, which blocks on it with
+ *  <tt>futex</tt>, and a non-blocking <tt>semop</tt> with the System V one.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *  \param spin largest number of polls before blocking (0 blocks at once)
+ *
+ *  \return SEM_TAKEN, SEM_SPUN or SEM_SLEPT, upon success, as the units were taken
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int semDownSpin (int semgid, unsigned int sindex, unsigned int n, unsigned int spin);
+
+/**
+ *  \brief <em>Up</em> by <tt>n</tt> units of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semUpN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Atomic operation on several semaphores within the set.
+ *
+ *  Each element of <tt>ops</tt> adds <tt>delta</tt> (an <em>up</em> when positive, a <em>down</em> when
+ *  negative) to the semaphore at location <tt>sindex</tt>. Either all of them take place or the caller
+ *  blocks until they all can. At most SEM_MAXOPS operations are carried out at once: the atomicity of a larger
+ *  batch could not be kept by splitting it, so the caller splits it where it does not need to be atomic.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops operations to be carried out
+ *  \param nops number of operations (1 .. SEM_MAXOPS)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semOps (int semgid, const SEMOP ops[], unsigned int nops);
+
 #endif /* SEMAPHORE_H_ */
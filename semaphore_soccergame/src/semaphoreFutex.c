@@ -0,0 +1,575 @@
+/**
+ *  \file semaphoreFutex.c (implementation file)
+ *
+ *  \brief Semaphore management.
+ *
+ *  Operations defined on semaphores:
+ *     \li creation of a set of semaphores, possibly reusing the one left by a previous run
+ *     \li connection to a previously created set of semaphores, by its key or by its identifier
+ *     \li destruction of a previously created set of semaphores
+ *     \li signalling start of operations
+ *     \li <em>down</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set that does not block
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> and <em>up</em> by several units of a semaphore within the set
+ *     \li <em>down</em> that spins for a while before blocking
+ *     \li atomic operation on several semaphores within the set.
+ *
+ *  Alternative implementation of the interface in semaphore.h, selected with <tt>make SEMAPHORE=futex</tt>.
+ *  The set lives in a POSIX shared memory object named after the creation key and every semaphore is a
+ *  counter updated with atomic operations. A <em>down</em> on a green semaphore and an <em>up</em> with nobody
+ *  waiting never enter the kernel; blocked processes sleep on the counter with <tt>futex</tt>.
+ *
+ *  The set identifier returned to the caller is the descriptor of the shared memory object. A set created with the
+ *  key IPC_PRIVATE has no name: its object is unlinked as soon as it is created and its descriptor, inherited by
+ *  the processes the creator launches, is the only way to it (see <tt>semConnectId</tt>).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <assert.h>
+
+#include "semaphore.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief highest descriptor that may identify a set */
+#define  MAXFD          1024
+
+/**
+ *  \brief Definition of <em>semaphore</em> data type.
+ */
+typedef struct {
+    /** \brief semaphore value (from a cache line of its own, so that semaphores of different entities and cores do
+               not share lines) */
+    _Alignas (64) atomic_uint val;
+    /** \brief number of processes sleeping, or about to sleep, on the value */
+    atomic_uint waiters;
+    /** \brief how many of them wait for more than one unit */
+    atomic_uint multi;
+} FSEM;
+
+/**
+ *  \brief Definition of <em>set of semaphores</em> data type, as stored in shared memory.
+ */
+typedef struct {
+    /** \brief creation key */
+    int key;
+    /** \brief number of semaphores in the set, including the start of operations one */
+    unsigned int snum;
+    /** \brief semaphores */
+    FSEM sem[];
+} FSEM_SET;
+
+/** \brief local address of each attached set, indexed by its identifier */
+static FSEM_SET *setAdd[MAXFD];
+
+/* internal functions */
+
+static void objName (int key, char *name, size_t size)
+{
+    if (key == IPC_PRIVATE)
+       snprintf (name, size, "/soccergame.sem.private.%d", (int) getpid ());
+       else snprintf (name, size, "/soccergame.sem.%08x", (unsigned int) key);
+}
+
+static int futexWait (atomic_uint *addr, unsigned int val)
+{
+    return (int) syscall (SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+static int futexWake (atomic_uint *addr, int n)
+{
+    return (int) syscall (SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
+}
+
+static FSEM_SET *attach (int fd, size_t size)
+{
+    void *add;
+
+    if (fd >= MAXFD) {
+        errno = EMFILE;
+        return NULL;
+    }
+    if ((add = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+       return NULL;
+    setAdd[fd] = (FSEM_SET *) add;
+    return setAdd[fd];
+}
+
+static FSEM *lookup (int semgid, unsigned int sindex)
+{
+    if ((semgid < 0) || (semgid >= MAXFD) || (setAdd[semgid] == NULL) || (sindex >= setAdd[semgid]->snum)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return &setAdd[semgid]->sem[sindex];
+}
+
+static int waitFor (FSEM *s, unsigned int n, unsigned int v)
+{
+    int stat;
+
+    atomic_fetch_add (&s->waiters, 1);
+    if (n > 1) atomic_fetch_add (&s->multi, 1);
+
+    /* sleeps only if the value is still the one that was seen to be too low */
+    stat = futexWait (&s->val, v);
+    if ((stat == -1) && ((errno == EAGAIN) || (errno == EINTR))) stat = 0;
+
+    if (n > 1) atomic_fetch_sub (&s->multi, 1);
+    atomic_fetch_sub (&s->waiters, 1);
+    return stat;
+}
+
+static bool tryDown (FSEM *s, unsigned int n, unsigned int *v)
+{
+    *v = atomic_load (&s->val);
+    while (*v >= n) {
+        if (atomic_compare_exchange_weak (&s->val, v, *v - n))
+           return true;
+    }
+    return false;
+}
+
+static int down (FSEM *s, unsigned int n)
+{
+    unsigned int v;
+
+    while (!tryDown (s, n, &v)) {
+        if (waitFor (s, n, v) == -1)
+           return -1;
+    }
+    return 0;
+}
+
+/* pause instruction of a spin loop: it lets the other hardware thread of the core run */
+static void relax (void)
+{
+#if defined (__x86_64__) || defined (__i386__)
+    __builtin_ia32_pause ();
+#elif defined (__aarch64__)
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+/* spinners only read the value until it is high enough, and are never counted as waiters: an up with nobody else
+   waiting hands the units over without entering the kernel; once the polls are spent, the wait counts as a sleep
+   only if the caller did sleep on the value, and as spun if a last try took the units */
+static int downSpin (FSEM *s, unsigned int n, unsigned int spin)
+{
+    unsigned int v, i;
+    bool slept = false;
+
+    if (tryDown (s, n, &v))
+       return SEM_TAKEN;
+    for (i = 0; i < spin; i++) {
+        relax ();
+        if ((atomic_load_explicit (&s->val, memory_order_relaxed) >= n) && tryDown (s, n, &v))
+           return SEM_SPUN;
+    }
+    while (!tryDown (s, n, &v)) {
+        if (waitFor (s, n, v) == -1)
+           return -1;
+        slept = true;
+    }
+    return slept ? SEM_SLEPT : SEM_SPUN;
+}
+
+static int up (FSEM *s, unsigned int n)
+{
+    atomic_fetch_add (&s->val, n);
+
+    /* a waiter for several units may not be satisfied, so everybody gets a chance */
+    if (atomic_load (&s->multi) > 0)
+       return (futexWake (&s->val, INT_MAX) == -1) ? -1 : 0;
+    if ((atomic_load (&s->waiters) > 0) && (futexWake (&s->val, (int) n) == -1))
+       return -1;
+    return 0;
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of a set of semaphores.
+ *
+ *  All semaphores in the set will be in set to <em>red state</em> upon creation.
+ *  The function fails if there is already a semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semCreate (int key, unsigned int snum)
+{
+  char name[64];                                                                     /* shared memory object name */
+  size_t size = sizeof (FSEM_SET) + (snum + 1) * sizeof (FSEM);                                      /* set size */
+  int fd;                                                                                   /* set identifier */
+  FSEM_SET *set;
+
+  /* a private set is reached only through its descriptor, which must then be inherited */
+  objName (key, name, sizeof (name));
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL | ((key == IPC_PRIVATE) ? 0 : O_CLOEXEC), MASK)) == -1)
+     return -1;
+  if ((ftruncate (fd, (off_t) size) == -1) || ((set = attach (fd, size)) == NULL))
+     { shm_unlink (name);
+       close (fd);
+       return -1;
+     }
+  /* shm_open always sets FD_CLOEXEC: it is cleared so that the descriptor of a private set is inherited */
+  if ((key == IPC_PRIVATE) && ((shm_unlink (name) == -1) || (fcntl (fd, F_SETFD, 0) == -1)))
+     { close (fd);
+       return -1;
+     }
+  set->key = key;
+  set->snum = snum + 1;                           /* ftruncate zero-fills the object: all semaphores are red */
+  return fd;
+}
+
+/**
+ *  \brief Creation of a set of semaphores, or reuse of the set left with the same key by a previous run.
+ *
+ *  A set with at least <tt>snum</tt> semaphores is reset in place: all of them, the start of operations one included,
+ *  are set to <em>red state</em> at once; a smaller one is destroyed and a new set is created, as when there is none.
+ *
+ *  The values of the semaphores are zeroed in a single pass; the counts of waiters are left alone, since stale
+ *  processes may still sleep on them until an <em>up</em> of the new run wakes them.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semReuse (int key, unsigned int snum)
+{
+  char name[64];                                                                     /* shared memory object name */
+  struct stat st;
+  int fd;                                                                                   /* set identifier */
+  unsigned int i;
+  FSEM_SET *set;
+
+  objName (key, name, sizeof (name));
+  if ((key == IPC_PRIVATE) || ((fd = shm_open (name, O_RDWR | O_CLOEXEC, MASK)) == -1))
+     return ((key == IPC_PRIVATE) || (errno == ENOENT)) ? semCreate (key, snum) : -1;
+  if ((fstat (fd, &st) == -1) || ((set = attach (fd, (size_t) st.st_size)) == NULL))
+     { close (fd);
+       return -1;
+     }
+  if (set->snum < snum + 1)
+     return (semDestroy (fd) == -1) ? -1 : semCreate (key, snum);
+  for (i = 0; i < set->snum; i++)
+    atomic_store (&set->sem[i].val, 0);
+  return fd;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnect (int key)
+{
+  char name[64];                                                                     /* shared memory object name */
+  struct stat st;
+  int fd;                                                                                   /* set identifier */
+  FSEM_SET *set;
+
+  objName (key, name, sizeof (name));
+  if ((fd = shm_open (name, O_RDWR | O_CLOEXEC, MASK)) == -1)
+     return -1;
+  if ((fstat (fd, &st) == -1) || ((set = attach (fd, (size_t) st.st_size)) == NULL))
+     { close (fd);
+       return -1;
+     }
+
+  /* waiting for the start of operations and passing it on */
+  if ((down (&set->sem[0], 1) == -1) || (up (&set->sem[0], 1) == -1))
+     return -1;
+  return fd;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores, given its identifier.
+ *
+ *  The identifier is passed on by the creator to the processes it launches, so that they need neither the creation
+ *  key nor a look up. As <tt>semConnect</tt>, the function waits for the start of operations.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier, as returned to the creator by <tt>semCreate</tt>
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnectId (int semgid)
+{
+  struct stat st;
+  FSEM_SET *set;
+
+  if ((semgid < 0) || (fstat (semgid, &st) == -1) || ((set = attach (semgid, (size_t) st.st_size)) == NULL))
+     return -1;
+
+  /* waiting for the start of operations and passing it on */
+  if ((down (&set->sem[0], 1) == -1) || (up (&set->sem[0], 1) == -1))
+     return -1;
+  return semgid;
+}
+
+/**
+ *  \brief Destruction of a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDestroy (int semgid)
+{
+  char name[64];                                                                     /* shared memory object name */
+  FSEM_SET *set;
+
+  if (lookup (semgid, 0) == NULL)
+     return -1;
+  set = setAdd[semgid];
+  objName (set->key, name, sizeof (name));
+  if ((set->key != IPC_PRIVATE) && (shm_unlink (name) == -1))
+     return -1;
+  munmap (set, sizeof (FSEM_SET) + set->snum * sizeof (FSEM));
+  setAdd[semgid] = NULL;
+  return close (semgid);
+}
+
+/**
+ *  \brief Signalling start of operations upon initialization of shared data structures.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semSignal (int semgid)
+{
+  FSEM *s;
+
+  if ((s = lookup (semgid, 0)) == NULL)
+     return -1;
+  return up (s, 1);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDown (int semgid, unsigned int sindex)
+{
+  FSEM *s;
+
+  assert(sindex>0);
+  if ((s = lookup (semgid, sindex)) == NULL)
+     return -1;
+  return down (s, 1);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, only when it can be done at once.
+ *
+ *  The caller never blocks: if the semaphore is in <em>red state</em>, the function fails with EAGAIN.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs or the semaphore is red (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semTryDown (int semgid, unsigned int sindex)
+{
+  FSEM *s;
+  unsigned int v;
+
+  assert(sindex>0);
+  if ((s = lookup (semgid, sindex)) == NULL)
+     return -1;
+  if (tryDown (s, 1, &v))
+     return 0;
+  errno = EAGAIN;
+  return -1;
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUp (int semgid, unsigned int sindex)
+{
+  FSEM *s;
+
+  assert(sindex>0);
+  if ((s = lookup (semgid, sindex)) == NULL)
+     return -1;
+  return up (s, 1);
+}
+
+/**
+ *  \brief <em>Down</em> by <tt>n</tt> units of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  FSEM *s;
+
+  assert((sindex>0) && (n>0));
+  if ((s = lookup (semgid, sindex)) == NULL)
+     return -1;
+  return down (s, n);
+}
+
+/**
+ *  \brief <em>Down</em> by <tt>n</tt> units of a semaphore within the set, spinning for a while before blocking.
+ *
+ *  Every poll is a load of the value, after a pause instruction; the caller blocks on the value as in
+ *  <tt>semDownN</tt> once they are all spent.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *  \param spin largest number of polls before blocking (0 blocks at once)
+ *
+ *  \return SEM_TAKEN, SEM_SPUN or SEM_SLEPT, upon success, as the units were taken
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownSpin (int semgid, unsigned int sindex, unsigned int n, unsigned int spin)
+{
+  FSEM *s;
+
+  assert((sindex>0) && (n>0));
+  if ((s = lookup (semgid, sindex)) == NULL)
+     return -1;
+  return downSpin (s, n, spin);
+}
+
+/**
+ *  \brief <em>Up</em> by <tt>n</tt> units of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  FSEM *s;
+
+  assert((sindex>0) && (n>0));
+  if ((s = lookup (semgid, sindex)) == NULL)
+     return -1;
+  return up (s, n);
+}
+
+/**
+ *  \brief Atomic operation on several semaphores within the set.
+ *
+ *  The <em>downs</em> are tried first, in order; if one of them cannot be done, those already done are
+ *  undone and the caller waits on that semaphore before trying again, so it never blocks holding part of
+ *  the units. The <em>ups</em> are carried out once all <em>downs</em> succeeded.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops operations to be carried out
+ *  \param nops number of operations (1 .. SEM_MAXOPS)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semOps (int semgid, const SEMOP ops[], unsigned int nops)
+{
+  FSEM *s;
+  unsigned int i, j, v;
+
+  assert((nops>0) && (nops<=SEM_MAXOPS));
+  for (i = 0; i < nops; i++)
+    if ((s = lookup (semgid, ops[i].sindex)) == NULL)
+       return -1;
+
+  for (i = 0; i < nops; i++)
+  { if (ops[i].delta >= 0) continue;
+    s = lookup (semgid, ops[i].sindex);
+    if (!tryDown (s, (unsigned int) -ops[i].delta, &v))
+       { for (j = 0; j < i; j++)                                                    /* undo the downs already done */
+           if ((ops[j].delta < 0) && (up (lookup (semgid, ops[j].sindex), (unsigned int) -ops[j].delta) == -1))
+              return -1;
+         if (waitFor (s, (unsigned int) -ops[i].delta, v) == -1)
+            return -1;
+         i = (unsigned int) -1;                                                                  /* start over */
+       }
+  }
+
+  for (i = 0; i < nops; i++)
+    if ((ops[i].delta > 0) && (up (lookup (semgid, ops[i].sindex), (unsigned int) ops[i].delta) == -1))
+       return -1;
+  return 0;
+}
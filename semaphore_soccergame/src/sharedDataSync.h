@@ -19,44 +19,164 @@
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "latency.h"
+#include "lockProf.h"
 
 /**
- *  \brief Definition of <em>shared information</em> data type.
+ *  \brief Definition of <em>entity slot</em> data type: information private to one player or goalie of a pitch.
+ *
+ *  Each slot takes a cache line of its own, so that entities running on different cores do not share them.
  */
 typedef struct
-        { /** \brief full state of the problem */
-          FULL_STAT fSt;
+        { /** \brief team of the entity in the present match (0 while it has none), written by its captain */
+          _Alignas (CACHELINE) int team;
+          /** \brief next slot in the list the entity belongs to (-1 for the last one) */
+          int next;
+          /** \brief identification of the private semaphore where the entity waits to be called by its captain and
+                     to be started and ended by the referee – val = 0 */
+          unsigned int sem;
+        } ENTITY_SLOT;
+
+/**
+ *  \brief Definition of <em>slot list</em> data type: entities of a pitch linked through their slots.
+ */
+typedef struct
+        { /** \brief first slot (-1 for an empty list) */
+          int head;
+          /** \brief last slot (-1 for an empty list) */
+          int tail;
+        } SLOT_LIST;
 
-          /* semaphores ids */
+/**
+ *  \brief Definition of <em>shared information</em> data type.
+ *
+ *  There is one per pitch: each pitch has its own semaphore group, full state and referee, so matches in
+ *  different pitches never share a lock. The parts written at different times, or by different entities, start
+ *  each in a cache line of their own: the semaphore ids and the location of the slots, read-only once the pitch
+ *  is initialized; the lists of the team formation; the latency histograms; the contention profile; the full state.
+ */
+typedef struct
+        { /* semaphores ids */
           /** \brief identification of critical region protection semaphore – val = 1 */
           unsigned int mutex;
-          /** \brief identification of semaphore used by players to wait for forming team teammate - val = 0 */
-          unsigned int playersWaitTeam;
-          /** \brief identification of semaphore used by goalies to wait for forming team teammate - val = 0 */
-          unsigned int goaliesWaitTeam;
-          /** \brief identification of semaphore used by players and goalies to wait for the match to start - val = 0 */
-          unsigned int playersWaitReferee;
-          /** \brief identification of semaphore used by players and goalies to wait for the match to end - val = 0 */
-          unsigned int playersWaitEnd;
           /** \brief identification of semaphore used by referee to wait for teams to be formed – val = 0  */
           unsigned int refereeWaitTeams;
-          /** \brief identification of semaphore used by players and goalies to acknowledge team registration – val = 0  */
-          unsigned int playerRegistered;
+          /** \brief identification of semaphores used by players and goalies to acknowledge registration to the captain
+                     of each team – val = 0  */
+          unsigned int playerRegistered[NUMTEAMS];
           /** \brief identification of semaphore used by referee to wait for players and goalies to start – val = 0  */
           unsigned int playing;
+          /** \brief identification of semaphore used by all entities to wait for the end of the present match – val = 0  */
+          unsigned int waitMatchEnd;
+          /** \brief identification of semaphore used by all entities to wait for the start of the next match – val = 0  */
+          unsigned int waitMatchStart;
+
+          /** \brief location of the slot of each player and goalie of the pitch (offset from the start of this
+                     structure, see SLOT) */
+          size_t slotOffset;
+
+          /* team formation: the captain reserves the members of its team in the critical region and calls them
+             outside of it, each on its private semaphore (see entitySlot.h) */
+
+          /** \brief players waiting for a team, in order of arrival */
+          _Alignas (CACHELINE) SLOT_LIST playersWaiting;
+          /** \brief goalies waiting for a team, in order of arrival */
+          SLOT_LIST goaliesWaiting;
+          /** \brief members of each team, its captain first */
+          SLOT_LIST team[NUMTEAMS];
+
+          /** \brief time spent in each protocol phase by each kind of entity of the pitch (see latency.h) */
+          _Alignas (CACHELINE) LAT_STATS lat[LAT_KINDS];
+
+          /** \brief time each call site waited for and held the critical region of the pitch (see lockProf.h) */
+          _Alignas (CACHELINE) LOCK_STATS lock;
+
+          /** \brief full state of the pitch (sized at run time, must be the last member) */
+          FULL_STAT fSt;
 
         } SHARED_DATA;
 
-/** \brief number of semaphores in the set */
-#define SEM_NU                   8 
+_Static_assert (sizeof (ENTITY_SLOT) == CACHELINE, "ENTITY_SLOT must take one cache line");
+_Static_assert (offsetof (SHARED_DATA, playersWaiting) == CACHELINE, "SHARED_DATA read-only part must take one cache line");
+_Static_assert (offsetof (SHARED_DATA, lat) % CACHELINE == 0, "SHARED_DATA histograms must start a cache line");
+_Static_assert (offsetof (SHARED_DATA, fSt) % CACHELINE == 0, "SHARED_DATA full state must start a cache line");
+
+/**
+ *  \brief Definition of <em>shared region</em> data type.
+ *
+ *  Layout of the shared region: this header, followed by the shared information of each pitch and by the ring of
+ *  state records. Sizes depend on the roster, so the parts are located through their offsets.
+ */
+typedef struct
+        { /** \brief number of pitches */
+          unsigned int nPitches;
+
+          /** \brief location of the shared information of the first pitch (offset from the start of the region) */
+          size_t pitchOffset;
+          /** \brief size of the shared information of each pitch */
+          size_t pitchSize;
+
+          /** \brief location of the ring of state records, drained into the logging file by the generator
+                     (offset from the start of the region, see LOGRING) */
+          size_t logRingOffset;
+          /** \brief stage of the run, for its observers (see soccerTop.c): RUN_SETUP, RUN_GOING or RUN_OVER */
+          atomic_int run;
+          /** \brief run of the IPC pool the region is laid out for, which its entities must belong to (0 outside of
+                     the pool, see ipcPool.h) */
+          atomic_uint generation;
+
+          /** \brief state of all entities of all pitches, as recorded in the log (kept by the generator,
+                     sized at run time, must be the last member) */
+          FULL_STAT fSt;
+
+        } SHARED_REGION;
+
+_Static_assert (offsetof (SHARED_REGION, fSt) == CACHELINE, "SHARED_REGION header must take one cache line");
+
+/** \brief the generator is laying out the shared region */
+#define RUN_SETUP                0
+/** \brief the shared region is initialized and the entities may start */
+#define RUN_GOING                1
+/** \brief all entities ended, or the run was aborted */
+#define RUN_OVER                 2
+
+/** \brief shared information of pitch <tt>k</tt> in the shared region pointed to by <tt>shr</tt> */
+#define PITCH(shr, k)            ((SHARED_DATA *) ((char *) (shr) + (shr)->pitchOffset + (size_t) (k) * (shr)->pitchSize))
+
+/** \brief slot with index <tt>i</tt> of the pitch whose shared information is pointed to by <tt>sh</tt> */
+#define SLOT(sh, i)              (((ENTITY_SLOT *) ((char *) (sh) + (sh)->slotOffset))[(i)])
+
+/** \brief slot index of player <tt>id</tt> of the pitch whose shared information is pointed to by <tt>sh</tt> */
+#define PLAYERSLOTID(sh, id)     (id)
+/** \brief slot index of goalie <tt>id</tt> of the pitch whose shared information is pointed to by <tt>sh</tt> */
+#define GOALIESLOTID(sh, id)     ((sh)->fSt.nPlayers + (id))
+
+/** \brief slot of player <tt>id</tt> of the pitch whose shared information is pointed to by <tt>sh</tt> */
+#define PLAYERSLOT(sh, id)       SLOT ((sh), PLAYERSLOTID ((sh), (id)))
+/** \brief slot of goalie <tt>id</tt> of the pitch whose shared information is pointed to by <tt>sh</tt> */
+#define GOALIESLOT(sh, id)       SLOT ((sh), GOALIESLOTID ((sh), (id)))
+
+/** \brief address of the log ring in the shared region pointed to by <tt>shr</tt> */
+#define LOGRING(shr)             ((LOG_RING *) ((char *) (shr) + (shr)->logRingOffset))
+
+/** \brief number of semaphores of each pitch, not counting the private semaphores of its players and goalies, which
+           follow those of all pitches in the set */
+#define SEM_NU                   7
+
+/** \brief index in the semaphore set of semaphore <tt>sem</tt> (one of the constants below) of pitch <tt>k</tt> */
+#define SEMINDEX(k, sem)         ((unsigned int) (k) * SEM_NU + (sem))
 
 #define MUTEX                    1
-#define PLAYERSWAITTEAM          2
-#define GOALIESWAITTEAM          3
-#define PLAYERSWAITREFEREE       4
-#define PLAYERSWAITEND           5
-#define REFEREEWAITTEAMS         6
-#define PLAYERREGISTERED         7
-#define PLAYING                  8
+#define REFEREEWAITTEAMS         2
+#define PLAYERREGISTERED         3
+#define PLAYERREGISTERED2        4
+#define PLAYING                  5
+#define WAITMATCHEND             6
+#define WAITMATCHSTART           7
+
+/** \brief index in the semaphore set of the private semaphore of the <tt>i</tt>-th player or goalie of all pitches,
+           counted pitch after pitch, players before goalies */
+#define PRIVSEMINDEX(K, i)       ((unsigned int) (K) * SEM_NU + 1 + (unsigned int) (i))
 
 #endif /* SHAREDDATASYNC_H_ */
@@ -4,19 +4,22 @@
  *  \brief Shared memory management.
  *
  *   Operations defined on shared memory:
- *      \li creation of a new block
+ *      \li creation of a new block, possibly reusing the one left by a previous run
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
- *      \li mapping of the block previously created on the process address space
+ *      \li mapping of the block previously created on the process address space, possibly for reading only
  *      \li unmapping of the block off the process address space.
  *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/shm.h>
 
+#include "sharedMemory.h"
+
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
@@ -37,6 +40,33 @@ int shmemCreate (int key, unsigned int size)
   return shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL);
 }
 
+/**
+ *  \brief Creation of a new block, or reuse of the block left with the same key by a previous run.
+ *
+ *  A block of at least <tt>size</tt> bytes is reused as it is, with the contents it was left with; a smaller one is
+ *  destroyed and a new block is created, as when there is none.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemReuse (int key, unsigned int size)
+{
+  struct shmid_ds ds;                                                                         /* block attributes */
+  int shmid;                                                                                  /* block identifier */
+
+  if ((shmid = shmget ((key_t) key, 0, MASK)) == -1)
+     return (errno == ENOENT) ? shmemCreate (key, size) : -1;
+  if (shmctl (shmid, IPC_STAT, &ds) == -1)
+     return -1;
+  if (ds.shm_segsz < size)
+     return (shmemDestroy (shmid) == -1) ? -1 : shmemCreate (key, size);
+  return shmid;
+}
+
 /**
  *  \brief Connection to a previously created block.
  *
@@ -93,6 +123,30 @@ int shmemAttach (int shmid, void **pAttAdd)
      else return 1;
 }
 
+/**
+ *  \brief Mapping of the block previously created on the process address space, for reading only.
+ *
+ *  An observer of the run reads the shared region without writing to it, so that it cannot disturb the entities.
+ *  The block is unmapped with <tt>shmemDettach</tt>.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttachReadOnly (int shmid, const void **pAttAdd)
+{
+  void *add;                                                                                    /* temporary pointer */
+
+  if ((add = shmat (shmid, (char *) NULL, SHM_RDONLY)) == (void *) -1)
+     return -1;
+  *pAttAdd = add;
+  return 0;
+}
+
 /**
  *  \brief Unmapping of the block off the process address space.
  *
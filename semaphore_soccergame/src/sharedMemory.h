@@ -4,10 +4,10 @@
  *  \brief Shared memory management.
  *
  *   Operations defined on shared memory:
- *      \li creation of a new block
+ *      \li creation of a new block, possibly reusing the one left by a previous run
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
- *      \li mapping of the block previously created on the process address space
+ *      \li mapping of the block previously created on the process address space, possibly for reading only
  *      \li unmapping of the block off the process address space.
  *
  *  \author António Rui Borges - October 1995
@@ -30,6 +30,21 @@
 
 extern int shmemCreate (int key, unsigned int size);
 
+/**
+ *  \brief Creation of a new block, or reuse of the block left with the same key by a previous run.
+ *
+ *  A block of at least <tt>size</tt> bytes is reused as it is, with the contents it was left with; a smaller one is
+ *  destroyed and a new block is created, as when there is none.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemReuse (int key, unsigned int size);
+
 /**
  *  \brief Connection to a previously created block.
  *
@@ -70,6 +85,22 @@ extern int shmemDestroy (int shmid);
 
 extern int shmemAttach (int shmid, void **pAttAdd);
 
+/**
+ *  \brief Mapping of the block previously created on the process address space, for reading only.
+ *
+ *  An observer of the run reads the shared region without writing to it, so that it cannot disturb the entities.
+ *  The block is unmapped with <tt>shmemDettach</tt>.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemAttachReadOnly (int shmid, const void **pAttAdd);
+
 /**
  *  \brief Unmapping of the block off the process address space.
  *
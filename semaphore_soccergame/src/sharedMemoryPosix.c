@@ -0,0 +1,389 @@
+/**
+ *  \file sharedMemoryPosix.c (implementation file)
+ *
+ *  \brief Shared memory management.
+ *
+ *   Operations defined on shared memory:
+ *      \li creation of a new block, possibly reusing the one left by a previous run
+ *      \li connection to a previously created block
+ *      \li destruction of a previously created block
+ *      \li mapping of the block previously created on the process address space, possibly for reading only
+ *      \li unmapping of the block off the process address space.
+ *
+ *  Alternative implementation of the interface in sharedMemory.h, selected with <tt>make SHMEM=posix</tt>.
+ *  The block is a POSIX shared memory object named after the creation key and the process id of its creator, so
+ *  that simulations running at the same time in the same directory do not collide. The creator exports the name in
+ *  the environment variable <tt>SOCCERGAME_SHM</tt>, inherited by the processes it launches, and connecting
+ *  processes look the block up by that name. A process that did not inherit it, an observer started apart, takes the
+ *  block of the key whose creator is still running. The block of the IPC pool (see shmemReuse) is named after the key
+ *  alone, and outlives its creator.
+ *
+ *  The block is pre-faulted when mapped (<tt>MAP_POPULATE</tt>), unless <tt>SOCCERGAME_SHM_POPULATE=0</tt>.
+ *  If <tt>SOCCERGAME_HUGETLB</tt> names a directory where a <tt>hugetlbfs</tt> is mounted (for instance
+ *  <tt>/dev/hugepages</tt>), the block is created there instead and is backed by huge pages.
+ *
+ *  The block identifier returned to the caller is the descriptor of the shared memory object. A block created with
+ *  the key IPC_PRIVATE is not exported: its object is unlinked as soon as it is created and its descriptor, inherited
+ *  by the processes the creator launches, is the only way to it (they attach it directly, with no connection).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+#include "sharedMemory.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief highest descriptor that may identify a block */
+#define  MAXFD          1024
+
+/** \brief largest number of blocks mapped at the same time */
+#define  MAXATT         16
+
+/** \brief size of the name of a block, including the huge pages directory */
+#define  NAMESIZE       256
+
+/** \brief suffix of the name of the block of the IPC pool, in place of the process id of its creator */
+#define  POOL_SUFFIX    "pool"
+
+/** \brief environment variable where the creator exports the name of the block */
+#define  ENV_NAME       "SOCCERGAME_SHM"
+
+/** \brief environment variable naming the mount point of a hugetlbfs, to back the block with huge pages */
+#define  ENV_HUGETLB    "SOCCERGAME_HUGETLB"
+
+/** \brief environment variable disabling the pre-faulting of the block when set to 0 */
+#define  ENV_POPULATE   "SOCCERGAME_SHM_POPULATE"
+
+/** \brief name of each created block, indexed by its identifier, to be unlinked on destruction (empty for a private
+           block, already unlinked) */
+static char *blockName[MAXFD];
+
+/** \brief local address and length of each mapping */
+static struct {
+    void *add;
+    size_t len;
+} att[MAXATT];
+
+/* internal functions */
+
+static bool hugePages (void)
+{
+    char *dir = getenv (ENV_HUGETLB);
+
+    return (dir != NULL) && (dir[0] != '\0');
+}
+
+/* a huge pages block is a file of the hugetlbfs, any other is a POSIX shared memory object */
+
+static int objOpen (const char *name, int flags)
+{
+    return hugePages () ? open (name, flags, MASK) : shm_open (name, flags, MASK);
+}
+
+static int objUnlink (const char *name)
+{
+    return hugePages () ? unlink (name) : shm_unlink (name);
+}
+
+/* name of the block of a key whose creator is still running, or of the block of the pool, if any */
+static bool findBlock (int key, char *name, size_t size)
+{
+    const char *dir = hugePages () ? getenv (ENV_HUGETLB) : "/dev/shm";
+    char prefix[32];
+    struct dirent *d;
+    DIR *dp;
+    int pid;
+    bool found = false;
+
+    snprintf (prefix, sizeof (prefix), "soccergame.shm.%08x.", (unsigned int) key);
+    if ((dp = opendir (dir)) == NULL) return false;
+    while (!found && ((d = readdir (dp)) != NULL)) {
+        if ((strncmp (d->d_name, prefix, strlen (prefix)) != 0) ||
+            ((strcmp (d->d_name + strlen (prefix), POOL_SUFFIX) != 0) &&
+             ((sscanf (d->d_name + strlen (prefix), "%d", &pid) != 1) || ((kill ((pid_t) pid, 0) == -1) && (errno != EPERM)))))
+            continue;
+        if (hugePages ()) snprintf (name, size, "%s/%s", dir, d->d_name);
+        else snprintf (name, size, "/%s", d->d_name);
+        found = true;
+    }
+    closedir (dp);
+    return found;
+}
+
+/* name of the block of a key, with the given suffix */
+static void blockPath (char *name, size_t size, int key, const char *suffix)
+{
+    if (hugePages ())
+        snprintf (name, size, "%s/soccergame.shm.%08x.%s", getenv (ENV_HUGETLB), (unsigned int) key, suffix);
+    else snprintf (name, size, "/soccergame.shm.%08x.%s", (unsigned int) key, suffix);
+}
+
+/* a new block of the given name, exported unless it is private */
+static int createBlock (const char *name, int key, unsigned int size)
+{
+  off_t len = (off_t) size;                                                                       /* object length */
+  struct statfs fs;
+  int fd;                                                                                     /* block identifier */
+
+  /* a private block is reached only through its descriptor, which must then be inherited */
+  if ((fd = objOpen (name, O_RDWR | O_CREAT | O_EXCL | ((key == IPC_PRIVATE) ? 0 : O_CLOEXEC))) == -1)
+     return -1;
+  if (fd >= MAXFD)
+     { errno = EMFILE;
+       goto fail;
+     }
+
+  /* the length of a hugetlbfs file must be a multiple of the huge page size */
+  if (hugePages ())
+     { if (fstatfs (fd, &fs) == -1)
+          goto fail;
+       len = (len + fs.f_bsize - 1) / fs.f_bsize * fs.f_bsize;
+     }
+  if (ftruncate (fd, len) == -1)
+     goto fail;
+  /* shm_open always sets FD_CLOEXEC: it is cleared so that the descriptor of a private block is inherited */
+  if (key == IPC_PRIVATE)
+     { if ((objUnlink (name) == -1) || (fcntl (fd, F_SETFD, 0) == -1) || ((blockName[fd] = strdup ("")) == NULL))
+          { close (fd);
+            return -1;
+          }
+       return fd;
+     }
+  if (((blockName[fd] = strdup (name)) == NULL) || (setenv (ENV_NAME, name, 1) == -1))
+     goto fail;
+  return fd;
+
+fail:
+  objUnlink (name);
+  close (fd);
+  return -1;
+}
+
+static int mapBlock (int shmid, int prot, void **pAttAdd)
+{
+    char *populate = getenv (ENV_POPULATE);
+    int flags = MAP_SHARED,
+        n;
+    struct stat st;
+    void *add;
+
+    for (n = 0; (n < MAXATT) && (att[n].add != NULL); n++) ;
+    if (n == MAXATT) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if ((populate == NULL) || (strcmp (populate, "0") != 0)) flags |= MAP_POPULATE;
+    if (fstat (shmid, &st) == -1) return -1;
+    if ((add = mmap (NULL, (size_t) st.st_size, prot, flags, shmid, 0)) == MAP_FAILED) return -1;
+    att[n].add = add;
+    att[n].len = (size_t) st.st_size;
+    *pAttAdd = add;
+    return 0;
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of a new block.
+ *
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreate (int key, unsigned int size)
+{
+  char name[NAMESIZE],                                                                              /* block name */
+       pid[16];
+
+  snprintf (pid, sizeof (pid), "%d", (int) getpid ());
+  blockPath (name, sizeof (name), key, pid);
+  return createBlock (name, key, size);
+}
+
+/**
+ *  \brief Creation of a new block, or reuse of the block left with the same key by a previous run.
+ *
+ *  A block of at least <tt>size</tt> bytes is reused as it is, with the contents it was left with; a smaller one is
+ *  destroyed and a new block is created, as when there is none.
+ *
+ *  The block of the pool is named after the key alone, with the suffix <tt>pool</tt> instead of a process id, so that
+ *  the next run finds it once its creator is gone; it is exported as a new one is.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemReuse (int key, unsigned int size)
+{
+  char name[NAMESIZE];                                                                              /* block name */
+  struct stat st;
+  int fd;                                                                                     /* block identifier */
+
+  blockPath (name, sizeof (name), key, POOL_SUFFIX);
+  if ((key == IPC_PRIVATE) || ((fd = objOpen (name, O_RDWR | O_CLOEXEC)) == -1))
+     return ((key == IPC_PRIVATE) || (errno == ENOENT)) ? createBlock (name, key, size) : -1;
+  if ((fd >= MAXFD) || (fstat (fd, &st) == -1))
+     { if (fd >= MAXFD) errno = EMFILE;
+       close (fd);
+       return -1;
+     }
+  if ((size_t) st.st_size < size)
+     { close (fd);
+       return (objUnlink (name) == -1) ? -1 : createBlock (name, key, size);
+     }
+  if (((blockName[fd] = strdup (name)) == NULL) || (setenv (ENV_NAME, name, 1) == -1))
+     { close (fd);
+       return -1;
+     }
+  return fd;
+}
+
+/**
+ *  \brief Connection to a previously created block.
+ *
+ *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemConnect (int key)
+{
+  char *name = getenv (ENV_NAME),                                                                   /* block name */
+       suffix[16],
+       found[NAMESIZE];
+  int fd;                                                                                     /* block identifier */
+
+  /* the block exported must have been created with the same key */
+  snprintf (suffix, sizeof (suffix), ".%08x.", (unsigned int) key);
+  if ((name == NULL) && findBlock (key, found, sizeof (found)))
+     name = found;
+  if ((name == NULL) || (strstr (name, suffix) == NULL))
+     { errno = ENOENT;
+       return -1;
+     }
+  if ((fd = objOpen (name, O_RDWR | O_CLOEXEC)) == -1)
+     return -1;
+  if (fd >= MAXFD)
+     { close (fd);
+       errno = EMFILE;
+       return -1;
+     }
+  return fd;
+}
+
+/**
+ *  \brief Destruction of a previously created block.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDestroy (int shmid)
+{
+  int stat;
+
+  if ((shmid < 0) || (shmid >= MAXFD) || (blockName[shmid] == NULL))
+     { errno = EINVAL;
+       return -1;
+     }
+  stat = (blockName[shmid][0] == '\0') ? 0 : objUnlink (blockName[shmid]);
+  free (blockName[shmid]);
+  blockName[shmid] = NULL;
+  close (shmid);
+  return stat;
+}
+
+/**
+ *  \brief Mapping of the block previously created on the process address space.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttach (int shmid, void **pAttAdd)
+{
+  return mapBlock (shmid, PROT_READ | PROT_WRITE, pAttAdd);
+}
+
+/**
+ *  \brief Mapping of the block previously created on the process address space, for reading only.
+ *
+ *  An observer of the run reads the shared region without writing to it, so that it cannot disturb the entities.
+ *  The block is unmapped with <tt>shmemDettach</tt>.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttachReadOnly (int shmid, const void **pAttAdd)
+{
+  void *add;
+
+  if (mapBlock (shmid, PROT_READ, &add) == -1)
+     return -1;
+  *pAttAdd = add;
+  return 0;
+}
+
+/**
+ *  \brief Unmapping of the block off the process address space.
+ *
+ *  The function fails if the pointer does not locate a region of the address space
+ *  where a mapping took previously place.
+ *
+ *  \param attAdd local address of the attached block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDettach (void *attAdd)
+{
+  int n;
+
+  for (n = 0; (n < MAXATT) && (att[n].add != attAdd); n++) ;
+  if ((attAdd == NULL) || (n == MAXATT))
+     { errno = EINVAL;
+       return -1;
+     }
+  att[n].add = NULL;
+  return munmap (attAdd, att[n].len);
+}
@@ -0,0 +1,194 @@
+/**
+ *  \file soccerTop.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Live monitor of a running simulation, in the style of top.
+ *
+ *  Attaches to the shared region of the simulation running in the present directory (by the key of the generator,
+ *  so that a run with the fast startup, whose region is private, cannot be observed) for reading only, and every
+ *  interval prints, for each pitch, the match being played, the number of entities in each state,
+ *  the rate of state changes and the state of every entity. The states are copied under their sequence lock (see
+ *  stateSeq.h), so that the copy is consistent and the entities are neither slowed down nor written to; the rate of
+ *  changes comes from the counter of the lock. The monitor ends with the run.
+ *
+ *  Usage: soccerTop [-b] [-s] [-i interval] [-n refreshes]
+ *    \li -b batch mode: the screen is not cleared between refreshes, for a dashboard reading the output
+ *    \li -s summary only: the state of every entity is not shown
+ *    \li -i ms interval between refreshes (default 1000)
+ *    \li -n n number of refreshes (default: until the run ends).
+ *
+ *  With the POSIX shared memory (<tt>make SHMEM=posix</tt>) the block is looked up by the creation key among
+ *  those whose creator is still running.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "sharedMemory.h"
+#include "stateSeq.h"
+
+/** \brief states of players and goalies, in the order of the counts shown */
+static const char pgStates[] = { ARRIVING, WAITING_TEAM, FORMING_TEAM, WAITING_START_1, WAITING_START_2, PLAYING_1,
+                                 PLAYING_2, LATE, '\0' };
+
+/** \brief entity states shown on each line */
+#define  LINESTATES     64
+
+/** \brief screen clearing sequence of an ANSI terminal */
+#define  CLEAR          "\033[H\033[2J"
+
+static uint64_t nowNs (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+static int getCount (char *arg, char *argv0, const char *what)
+{
+    char *end;
+    long v = strtol (arg, &end, 0);
+
+    if ((*end != '\0') || (v < 1) || (v > INT_MAX)) {
+        fprintf (stderr, "%s: wrong %s \"%s\"\n", argv0, what, arg);
+        exit (EXIT_FAILURE);
+    }
+    return (int) v;
+}
+
+/* states of a kind of entity, folded into lines */
+static void printStates (const char *kind, const unsigned char *st, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i += LINESTATES) {
+        printf ("  %-8s %.*s\n", (i == 0) ? kind : "", (n - i < LINESTATES) ? n - i : LINESTATES, st + i);
+    }
+}
+
+/* one line per pitch, followed by the state of its entities; returns the changes of all pitches */
+static unsigned long refresh (const SHARED_REGION *shr, unsigned int *prev, double dt, bool summary,
+                              unsigned char *st)
+{
+    unsigned long total = 0;
+    unsigned int k, changes;
+    int nP, nG, i, j;
+    int count[sizeof (pgStates)];
+
+    printf ("%-6s %9s %10s", "pitch", "match", "changes/s");
+    for (j = 0; pgStates[j] != '\0'; j++) {
+        printf (" %5c", pgStates[j]);
+    }
+    printf ("  referee\n");
+    for (k = 0; k < shr->nPitches; k++) {
+        const SHARED_DATA *sh = PITCH (shr, k);
+
+        nP = sh->fSt.nPlayers;
+        nG = sh->fSt.nGoalies;
+        changes = seqRead (&sh->fSt.st, st);
+        memset (count, 0, sizeof (count));
+        for (i = 0; i < nP + nG; i++) {
+            for (j = 0; (pgStates[j] != '\0') && (pgStates[j] != st[i]); j++) ;
+            count[j] += 1;
+        }
+        printf ("%-6u %4d/%-4d %10.0f", k, __atomic_load_n (&sh->fSt.match, __ATOMIC_RELAXED) + 1, sh->fSt.nMatches,
+                (dt > 0.0) ? (double) (changes - prev[k]) / dt : 0.0);
+        for (j = 0; pgStates[j] != '\0'; j++) {
+            printf (" %5d", count[j]);
+        }
+        printf ("  %c\n", st[nP + nG]);
+        if (!summary) {
+            printStates ("players", st, nP);
+            printStates ("goalies", st + nP, nG);
+        }
+        total += changes - prev[k];
+        prev[k] = changes;
+    }
+    return total;
+}
+
+int main (int argc, char *argv[])
+{
+    const SHARED_REGION *shr;
+    unsigned int *prev;
+    unsigned char *st;
+    bool batch = false,
+         summary = false,
+         over;
+    int interval = 1000,
+        refreshes = -1,
+        key, shmid, opt, n;
+    unsigned long changes;
+    uint64_t t0, last, now;
+
+    while ((opt = getopt (argc, argv, "bsi:n:")) != -1) {
+        switch (opt) {
+            case 'b': batch = true; break;
+            case 's': summary = true; break;
+            case 'i': interval = getCount (optarg, argv[0], "interval"); break;
+            case 'n': refreshes = getCount (optarg, argv[0], "number of refreshes"); break;
+            default:
+                fprintf (stderr, "Usage: %s [-b] [-s] [-i interval] [-n refreshes]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((key = ftok (".", 'a')) == -1) {
+        perror ("error on generating the key");
+        return EXIT_FAILURE;
+    }
+    if ((shmid = shmemConnect (key)) == -1) {
+        perror ("error on connecting to the shared region (is a simulation running here?)");
+        return EXIT_FAILURE;
+    }
+    if (shmemAttachReadOnly (shmid, (const void **) &shr) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        return EXIT_FAILURE;
+    }
+
+    /* the generator may still be laying out the region */
+    while (atomic_load (&shr->run) == RUN_SETUP) {
+        usleep (1000);
+    }
+    if (((prev = calloc (shr->nPitches, sizeof (unsigned int))) == NULL) ||
+        ((st = malloc (shr->fSt.st.nEntities)) == NULL)) {
+        perror ("error on allocating the monitor state");
+        return EXIT_FAILURE;
+    }
+
+    t0 = last = nowNs ();
+    for (n = 0; (refreshes < 0) || (n < refreshes); n++) {
+        over = (atomic_load (&shr->run) == RUN_OVER);
+        now = nowNs ();
+        if (!batch) printf (CLEAR);
+        printf ("soccerTop - %u pitches, %d players, %d goalies, %d matches, %.1f s%s\n", shr->nPitches,
+                shr->fSt.nPlayers, shr->fSt.nGoalies, shr->fSt.nMatches, (double) (now - t0) / 1e9,
+                over ? ", run over" : "");
+        changes = refresh (shr, prev, (n == 0) ? 0.0 : (double) (now - last) / 1e9, summary, st);
+        if (n > 0) printf ("total %.0f changes/s\n", (double) changes / ((double) (now - last) / 1e9));
+        printf ("\n");
+        fflush (stdout);
+        last = now;
+        if (over) break;
+        usleep ((useconds_t) interval * 1000);
+    }
+
+    if (shmemDettach ((void *) shr) == -1) {
+        perror ("error on unmapping the shared region off the process address space");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/**
+ *  \file stateSeq.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Sequence lock of the states of the intervening entities.
+ *
+ *  A writer makes the counter odd with a compare and swap, which also keeps other writers out, and even again
+ *  with a release increment. States are stored and loaded as relaxed atomic operations, ordered with the counter by
+ *  fences: a reader that sees a state stored in a write section sees the counter it opened with, and tries again.
+ *
+ *  Defined operations:
+ *     \li changing the state of an entity
+ *     \li opening and closing a write section, to change the states of several entities at once
+ *     \li taking a consistent copy of the states.
+ */
+
+#include <stdatomic.h>
+
+#include "probDataStruct.h"
+#include "stateSeq.h"
+
+/* internal functions */
+
+/* pause instruction of a spin loop: it lets the other hardware thread of the core run */
+static void relax (void)
+{
+#if defined (__x86_64__) || defined (__i386__)
+    __builtin_ia32_pause ();
+#elif defined (__aarch64__)
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+/* external functions */
+
+/**
+ *  \brief Opening a write section of the states: waiting for the one open, if any, to be closed.
+ *
+ *  Between seqWriteBegin and seqWriteEnd the states may be assigned as usual.
+ *
+ *  \param st pointer to the states
+ */
+void seqWriteBegin (STAT *st)
+{
+    unsigned int s = atomic_load_explicit (&st->seq, memory_order_relaxed);
+
+    while (((s & 1) != 0) ||
+           !atomic_compare_exchange_weak_explicit (&st->seq, &s, s + 1, memory_order_acquire, memory_order_relaxed)) {
+        if ((s & 1) != 0) {
+            relax ();
+            s = atomic_load_explicit (&st->seq, memory_order_relaxed);
+        }
+    }
+    /* the odd counter is seen before any state stored after it */
+    atomic_thread_fence (memory_order_release);
+}
+
+/**
+ *  \brief Closing the write section of the states opened by the caller.
+ *
+ *  \param st pointer to the states
+ */
+void seqWriteEnd (STAT *st)
+{
+    atomic_fetch_add_explicit (&st->seq, 1, memory_order_release);
+}
+
+/**
+ *  \brief Changing the state of an entity in a write section of its own.
+ *
+ *  \param st pointer to the states
+ *  \param state pointer to the state of the entity (see PLAYERSTAT, GOALIESTAT and REFEREESTAT)
+ *  \param value new state
+ */
+void seqSetState (STAT *st, unsigned int *state, unsigned int value)
+{
+    seqWriteBegin (st);
+    __atomic_store_n (state, value, __ATOMIC_RELAXED);
+    seqWriteEnd (st);
+}
+
+/**
+ *  \brief Taking a consistent copy of the states, without writing to them.
+ *
+ *  \param st pointer to the states
+ *  \param states pointer to the location where the state of every entity is copied (<tt>st->nEntities</tt> bytes)
+ *
+ *  \return number of state changes made before the copy
+ */
+unsigned int seqRead (const STAT *st, unsigned char *states)
+{
+    unsigned int s0, s1, e;
+
+    do {
+        while (((s0 = atomic_load_explicit (&st->seq, memory_order_acquire)) & 1) != 0) {
+            relax ();
+        }
+        for (e = 0; e < st->nEntities; e++) {
+            states[e] = (unsigned char) __atomic_load_n (&st->stat[e], __ATOMIC_RELAXED);
+        }
+        /* the counter is read again after all the states */
+        atomic_thread_fence (memory_order_acquire);
+        s1 = atomic_load_explicit (&st->seq, memory_order_relaxed);
+    } while (s0 != s1);
+    return s0 / 2;
+}
@@ -0,0 +1,62 @@
+/**
+ *  \file stateSeq.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Sequence lock of the states of the intervening entities.
+ *
+ *  The states of the entities of a pitch change within its critical region, all but that of a late player or goalie,
+ *  which is recorded without it; taking the critical region to read them would add an entity to the contention of
+ *  the pitch. Every change is made instead within a write section of the sequence lock of the states (the field
+ *  <tt>seq</tt> of STAT): the counter is odd while a change is being made, and writers take turns on it, so that the
+ *  changes made out of the critical region are serialized as well. A reader copies the states between two reads of
+ *  an even counter, and again if it changed in between, without ever writing to shared memory: an observer may map
+ *  it read-only (see soccerTop.c) and slows down no entity.
+ *
+ *  As every write section bumps the counter twice, it also counts the state changes of the pitch.
+ *
+ *  Defined operations:
+ *     \li changing the state of an entity
+ *     \li opening and closing a write section, to change the states of several entities at once
+ *     \li taking a consistent copy of the states.
+ */
+
+#ifndef STATESEQ_H_
+#define STATESEQ_H_
+
+#include "probDataStruct.h"
+
+/**
+ *  \brief Opening a write section of the states: waiting for the one open, if any, to be closed.
+ *
+ *  \param st pointer to the states
+ */
+extern void seqWriteBegin (STAT *st);
+
+/**
+ *  \brief Closing the write section of the states opened by the caller.
+ *
+ *  \param st pointer to the states
+ */
+extern void seqWriteEnd (STAT *st);
+
+/**
+ *  \brief Changing the state of an entity in a write section of its own.
+ *
+ *  \param st pointer to the states
+ *  \param state pointer to the state of the entity (see PLAYERSTAT, GOALIESTAT and REFEREESTAT)
+ *  \param value new state
+ */
+extern void seqSetState (STAT *st, unsigned int *state, unsigned int value);
+
+/**
+ *  \brief Taking a consistent copy of the states, without writing to them.
+ *
+ *  \param st pointer to the states
+ *  \param states pointer to the location where the state of every entity is copied (<tt>st->nEntities</tt> bytes)
+ *
+ *  \return number of state changes made before the copy
+ */
+extern unsigned int seqRead (const STAT *st, unsigned char *states);
+
+#endif /* STATESEQ_H_ */
@@ -0,0 +1,279 @@
+/**
+ *  \file supervisor.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Supervision of the intervening entities processes by the generator.
+ *
+ *  Children are kept in a table, looked up by process id through an open addressing hash. A single signalfd
+ *  notification may stand for several children, so each wake up reaps with <tt>waitpid (WNOHANG)</tt> until there
+ *  is none left.
+ *
+ *  Defined operations:
+ *     \li setting up the supervision, before any child is generated
+ *     \li registering a child
+ *     \li waiting for and reaping children
+ *     \li killing all running children
+ *     \li reporting the children that did not end successfully.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+#include <sys/epoll.h>
+
+#include "supervisor.h"
+
+/**
+ *  \brief Definition of <em>child</em> data type.
+ */
+typedef struct {
+    /** \brief process id */
+    pid_t pid;
+    /** \brief kind of entity */
+    char kind;
+    /** \brief entity id within its kind */
+    unsigned int id;
+    /** \brief pitch where the entity plays */
+    unsigned int pitch;
+    /** \brief the child is still running */
+    bool alive;
+    /** \brief exit status, as returned by waitpid */
+    int status;
+    /** \brief instant the child was reaped (CLOCK_MONOTONIC, in ns) */
+    uint64_t exitNs;
+} CHILD;
+
+/** \brief children, in the order they were registered */
+static CHILD *child;
+
+/** \brief number of children registered */
+static unsigned int nChild;
+
+/** \brief hash of the process ids: index of the child plus 1, 0 for a free entry */
+static unsigned int *hash;
+
+/** \brief number of entries of the hash, a power of two */
+static unsigned int hashSize;
+
+/** \brief number of children running in each pitch */
+static unsigned int *alive;
+
+/** \brief signal mask before SIGCHLD was blocked */
+static sigset_t oldMask;
+
+/** \brief signalfd where SIGCHLD is delivered */
+static int sfd = -1;
+
+/** \brief epoll instance watching the signalfd */
+static int efd = -1;
+
+/* internal functions */
+
+static uint64_t now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+static unsigned int *slotOf (pid_t pid)
+{
+    unsigned int h = ((unsigned int) pid * 2654435761u) & (hashSize - 1);
+
+    while ((hash[h] != 0) && (child[hash[h] - 1].pid != pid)) {
+        h = (h + 1) & (hashSize - 1);
+    }
+    return &hash[h];
+}
+
+static const char *kindName (char kind)
+{
+    switch (kind) {
+        case 'P': return "player";
+        case 'G': return "goalie";
+        default:  return "referee";
+    }
+}
+
+/* reaps all children that ended, without waiting */
+static unsigned int reap (void)
+{
+    unsigned int n = 0, i;
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid (-1, &status, WNOHANG)) > 0) {
+        if ((i = *slotOf (pid)) == 0) continue;                                      /* not an entity process */
+        CHILD *c = &child[i - 1];
+
+        c->alive = false;
+        c->status = status;
+        c->exitNs = now ();
+        alive[c->pitch] -= 1;
+        n += 1;
+    }
+    if ((pid == -1) && (errno != ECHILD)) {
+        perror ("error on waiting for an intervening process");
+        exit (EXIT_FAILURE);
+    }
+    return n;
+}
+
+/* external functions */
+
+/**
+ *  \brief Setting up the supervision: blocking SIGCHLD and watching it with epoll.
+ *
+ *  \param nChildren largest number of children that will be registered
+ *  \param nPitches number of pitches the children are dealt over
+ */
+void supInit (unsigned int nChildren, unsigned int nPitches)
+{
+    struct epoll_event ev = { .events = EPOLLIN };
+    sigset_t mask;
+
+    for (hashSize = 1; hashSize < 2 * nChildren; hashSize <<= 1) ;
+    if (((child = calloc (nChildren, sizeof (CHILD))) == NULL) ||
+        ((hash = calloc (hashSize, sizeof (unsigned int))) == NULL) ||
+        ((alive = calloc (nPitches, sizeof (unsigned int))) == NULL)) {
+        perror ("error on allocating the supervision tables");
+        exit (EXIT_FAILURE);
+    }
+
+    sigemptyset (&mask);
+    sigaddset (&mask, SIGCHLD);
+    if (sigprocmask (SIG_BLOCK, &mask, &oldMask) == -1) {
+        perror ("error on blocking SIGCHLD");
+        exit (EXIT_FAILURE);
+    }
+    if (((sfd = signalfd (-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) ||
+        ((efd = epoll_create1 (EPOLL_CLOEXEC)) == -1) ||
+        (epoll_ctl (efd, EPOLL_CTL_ADD, sfd, &ev) == -1)) {
+        perror ("error on setting up the supervision of the intervening processes");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Signal mask the generator had before the supervision was set up, to be restored in every child.
+ *
+ *  \return pointer to the signal mask
+ */
+const sigset_t *supSigMask (void)
+{
+    return &oldMask;
+}
+
+/**
+ *  \brief Registering a child just generated.
+ *
+ *  \param pid process id of the child
+ *  \param kind kind of entity (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id within its kind
+ *  \param pitch pitch where the entity plays
+ */
+void supChild (pid_t pid, char kind, unsigned int id, unsigned int pitch)
+{
+    CHILD *c = &child[nChild];
+
+    c->pid = pid;
+    c->kind = kind;
+    c->id = id;
+    c->pitch = pitch;
+    c->alive = true;
+    alive[pitch] += 1;
+    *slotOf (pid) = ++nChild;
+}
+
+/**
+ *  \brief Waiting until some child ends or the timeout expires, and reaping all children that ended.
+ *
+ *  \param timeoutNs longest wait, in ns (0 to reap without waiting)
+ *
+ *  \return number of children reaped
+ */
+unsigned int supWait (uint64_t timeoutNs)
+{
+    struct epoll_event ev;
+    struct signalfd_siginfo si;
+    struct timespec ts = { .tv_sec = (time_t) (timeoutNs / 1000000000u), .tv_nsec = (long) (timeoutNs % 1000000000u) };
+
+    if ((epoll_pwait2 (efd, &ev, 1, &ts, NULL) == -1) && (errno != EINTR)) {
+        perror ("error on waiting for the intervening processes");
+        exit (EXIT_FAILURE);
+    }
+
+    /* notifications are drained before reaping, so that a child ending in between is never missed */
+    while (read (sfd, &si, sizeof (si)) == sizeof (si)) ;
+    return reap ();
+}
+
+/**
+ *  \brief Number of children of a pitch still running.
+ *
+ *  \param pitch pitch
+ *
+ *  \return number of children running
+ */
+unsigned int supPitchAlive (unsigned int pitch)
+{
+    return alive[pitch];
+}
+
+/**
+ *  \brief Killing all children still running (SIGKILL) and reaping them.
+ */
+void supKill (void)
+{
+    unsigned int i, left = 0;
+
+    for (i = 0; i < nChild; i++) {
+        if (child[i].alive && (kill (child[i].pid, SIGKILL) == 0)) left += 1;
+    }
+    while (left > 0) {
+        unsigned int n = supWait (1000000000u);
+
+        left = (n > left) ? 0 : left - n;
+    }
+}
+
+/**
+ *  \brief Printing one line for every child that did not end successfully, and a summary line.
+ *
+ *  \param fp stream where the report is printed
+ *  \param t0 instant the exit instants are measured from (CLOCK_MONOTONIC, in ns)
+ *
+ *  \return number of children that did not end successfully
+ */
+unsigned int supReport (FILE *fp, uint64_t t0)
+{
+    unsigned int i, failed = 0;
+    uint64_t last = t0;
+
+    for (i = 0; i < nChild; i++) {
+        CHILD *c = &child[i];
+
+        if (c->alive) continue;
+        if (c->exitNs > last) last = c->exitNs;
+        if (WIFEXITED (c->status) && (WEXITSTATUS (c->status) == EXIT_SUCCESS)) continue;
+        failed += 1;
+        if (WIFSIGNALED (c->status))
+            fprintf (fp, "%s %u (pid %d, pitch %u) killed by signal %d at %.3f ms\n", kindName (c->kind), c->id,
+                     (int) c->pid, c->pitch, WTERMSIG (c->status), (double) (c->exitNs - t0) / 1e6);
+        else fprintf (fp, "%s %u (pid %d, pitch %u) exited with status %d at %.3f ms\n", kindName (c->kind), c->id,
+                      (int) c->pid, c->pitch, WEXITSTATUS (c->status), (double) (c->exitNs - t0) / 1e6);
+    }
+    fprintf (fp, "%u entity processes ended, the last at %.3f ms, %u of them abnormally\n", nChild,
+             (double) (last - t0) / 1e6, failed);
+    return failed;
+}
@@ -0,0 +1,87 @@
+/**
+ *  \file supervisor.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Supervision of the intervening entities processes by the generator.
+ *
+ *  SIGCHLD is blocked and delivered through a <tt>signalfd</tt> watched by <tt>epoll</tt>: the generator sleeps
+ *  until a child ends or a timeout expires, and every child that ended is reaped at once, its exit status and the
+ *  instant it was reaped being recorded. Children are counted by pitch, so that the generator can tell whether a
+ *  pitch still has entities running, and can all be killed when a match exceeds its deadline.
+ *
+ *  Defined operations:
+ *     \li setting up the supervision, before any child is generated
+ *     \li registering a child
+ *     \li waiting for and reaping children
+ *     \li killing all running children
+ *     \li reporting the children that did not end successfully.
+ */
+
+#ifndef SUPERVISOR_H_
+#define SUPERVISOR_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ *  \brief Setting up the supervision: blocking SIGCHLD and watching it with epoll.
+ *
+ *  \param nChildren largest number of children that will be registered
+ *  \param nPitches number of pitches the children are dealt over
+ */
+extern void supInit (unsigned int nChildren, unsigned int nPitches);
+
+/**
+ *  \brief Signal mask the generator had before the supervision was set up, to be restored in every child.
+ *
+ *  \return pointer to the signal mask
+ */
+extern const sigset_t *supSigMask (void);
+
+/**
+ *  \brief Registering a child just generated.
+ *
+ *  \param pid process id of the child
+ *  \param kind kind of entity (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id within its kind
+ *  \param pitch pitch where the entity plays
+ */
+extern void supChild (pid_t pid, char kind, unsigned int id, unsigned int pitch);
+
+/**
+ *  \brief Waiting until some child ends or the timeout expires, and reaping all children that ended.
+ *
+ *  \param timeoutNs longest wait, in ns (0 to reap without waiting)
+ *
+ *  \return number of children reaped
+ */
+extern unsigned int supWait (uint64_t timeoutNs);
+
+/**
+ *  \brief Number of children of a pitch still running.
+ *
+ *  \param pitch pitch
+ *
+ *  \return number of children running
+ */
+extern unsigned int supPitchAlive (unsigned int pitch);
+
+/**
+ *  \brief Killing all children still running (SIGKILL) and reaping them.
+ */
+extern void supKill (void);
+
+/**
+ *  \brief Printing one line for every child that did not end successfully, and a summary line.
+ *
+ *  \param fp stream where the report is printed
+ *  \param t0 instant the exit instants are measured from (CLOCK_MONOTONIC, in ns)
+ *
+ *  \return number of children that did not end successfully
+ */
+extern unsigned int supReport (FILE *fp, uint64_t t0);
+
+#endif /* SUPERVISOR_H_ */
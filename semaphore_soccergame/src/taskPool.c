@@ -0,0 +1,232 @@
+/**
+ *  \file taskPool.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Pool of worker threads that run rounds of tasks, balanced by work stealing.
+ *
+ *  A worker that finds its deque empty tries the others in turn, from the next one on, until every task of the round
+ *  was taken; the count of tasks left is decremented as soon as a task is taken, so that no worker goes on looking
+ *  for work while the last tasks run.
+ *
+ *  Defined operations:
+ *     \li creating a pool
+ *     \li running a round of tasks
+ *     \li destroying a pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "taskPool.h"
+
+/** \brief stack size of a worker thread (in bytes) */
+#define  WORKER_STACK   (256 << 10)
+
+/** \brief the deque had no task */
+#define  EMPTY          (-1)
+/** \brief a steal lost the race for the last task, or for the top one, and may be retried */
+#define  ABORT          (-2)
+
+/* internal functions */
+
+static void relax (void)
+{
+#if defined (__x86_64__) || defined (__i386__)
+    __builtin_ia32_pause ();
+#elif defined (__aarch64__)
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+/* the owner takes the task pushed last */
+static long pop (TASK_DEQUE *dq)
+{
+    long b = atomic_load_explicit (&dq->bottom, memory_order_relaxed) - 1,
+         t, x = EMPTY;
+
+    atomic_store_explicit (&dq->bottom, b, memory_order_relaxed);
+    atomic_thread_fence (memory_order_seq_cst);
+    t = atomic_load_explicit (&dq->top, memory_order_relaxed);
+    if (t <= b) {
+        x = dq->task[b];
+        if (t == b) {
+            /* last task: the owner races with the thieves for it */
+            if (!atomic_compare_exchange_strong_explicit (&dq->top, &t, t + 1, memory_order_seq_cst,
+                                                          memory_order_relaxed)) x = EMPTY;
+            atomic_store_explicit (&dq->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else atomic_store_explicit (&dq->bottom, b + 1, memory_order_relaxed);
+    return x;
+}
+
+/* a thief takes the task pushed first */
+static long steal (TASK_DEQUE *dq)
+{
+    long t = atomic_load_explicit (&dq->top, memory_order_acquire),
+         b, x;
+
+    atomic_thread_fence (memory_order_seq_cst);
+    b = atomic_load_explicit (&dq->bottom, memory_order_acquire);
+    if (t >= b) return EMPTY;
+    x = dq->task[t];
+    if (!atomic_compare_exchange_strong_explicit (&dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return ABORT;
+    return x;
+}
+
+/* the share of the round of a worker: its own tasks, then those it steals */
+static void work (TASK_DEQUE *dq)
+{
+    TASK_POOL *pool = dq->pool;
+    unsigned int w = (unsigned int) (dq - pool->dq),
+                 v = w;
+    long x;
+
+    while ((x = pop (dq)) >= 0) {
+        atomic_fetch_sub_explicit (&pool->left, 1, memory_order_relaxed);
+        pool->run (pool->ctx, (unsigned int) x);
+    }
+    while (atomic_load_explicit (&pool->left, memory_order_relaxed) > 0) {
+        if ((v = (v + 1) % pool->nWorkers) == w) {
+            relax ();
+            continue;
+        }
+        if ((x = steal (&pool->dq[v])) >= 0) {
+            atomic_fetch_sub_explicit (&pool->left, 1, memory_order_relaxed);
+            dq->steals += 1;
+            pool->run (pool->ctx, (unsigned int) x);
+        }
+    }
+}
+
+static void *worker (void *arg)
+{
+    TASK_DEQUE *dq = arg;
+    TASK_POOL *pool = dq->pool;
+
+    for (;;) {
+        pthread_barrier_wait (&pool->start);
+        if (pool->quit) break;
+        work (dq);
+        pthread_barrier_wait (&pool->end);
+    }
+    return NULL;
+}
+
+/* external functions */
+
+/**
+ *  \brief Creating a pool, whose worker 0 is the calling thread.
+ *
+ *  \param pool pointer to the pool
+ *  \param nWorkers number of workers (1..POOL_MAXWORKERS)
+ *  \param maxTasks largest number of tasks of a round
+ *  \param run task function
+ *  \param ctx context of the task function
+ */
+void poolInit (TASK_POOL *pool, unsigned int nWorkers, unsigned int maxTasks,
+               void (*run) (void *ctx, unsigned int task), void *ctx)
+{
+    pthread_attr_t attr;
+    unsigned int w;
+    int err;
+
+    pool->nWorkers = nWorkers;
+    pool->run = run;
+    pool->ctx = ctx;
+    pool->quit = false;
+    atomic_init (&pool->left, 0);
+    if (((pool->dq = aligned_alloc (CACHELINE, nWorkers * sizeof (TASK_DEQUE))) == NULL) ||
+        ((pool->tids = malloc (nWorkers * sizeof (pthread_t))) == NULL)) {
+        perror ("error on allocating the task pool");
+        exit (EXIT_FAILURE);
+    }
+    for (w = 0; w < nWorkers; w++) {
+        atomic_init (&pool->dq[w].top, 0);
+        atomic_init (&pool->dq[w].bottom, 0);
+        pool->dq[w].steals = 0;
+        pool->dq[w].pool = pool;
+        if ((pool->dq[w].task = malloc ((maxTasks + 1) * sizeof (unsigned int))) == NULL) {
+            perror ("error on allocating the task pool");
+            exit (EXIT_FAILURE);
+        }
+    }
+    if ((pthread_barrier_init (&pool->start, NULL, nWorkers) != 0) ||
+        (pthread_barrier_init (&pool->end, NULL, nWorkers) != 0)) {
+        perror ("error on initializing the barriers of the task pool");
+        exit (EXIT_FAILURE);
+    }
+
+    pthread_attr_init (&attr);
+    pthread_attr_setstacksize (&attr, WORKER_STACK);
+    for (w = 1; w < nWorkers; w++) {
+        if ((err = pthread_create (&pool->tids[w], &attr, worker, &pool->dq[w])) != 0) {
+            fprintf (stderr, "error on the creation of a worker thread: %s\n", strerror (err));
+            exit (EXIT_FAILURE);
+        }
+    }
+    pthread_attr_destroy (&attr);
+}
+
+/**
+ *  \brief Running a round of tasks, each one once, returning when all of them ran.
+ *
+ *  The tasks are pushed while the other workers are parked on the start barrier, which publishes them.
+ *
+ *  \param pool pointer to the pool
+ *  \param task tasks of the round
+ *  \param n number of tasks of the round
+ */
+void poolRound (TASK_POOL *pool, const unsigned int *task, unsigned int n)
+{
+    unsigned int i, w;
+    long b;
+
+    for (w = 0; w < pool->nWorkers; w++) {
+        atomic_store_explicit (&pool->dq[w].top, 0, memory_order_relaxed);
+        atomic_store_explicit (&pool->dq[w].bottom, 0, memory_order_relaxed);
+    }
+    for (i = 0; i < n; i++) {
+        TASK_DEQUE *dq = &pool->dq[task[i] % pool->nWorkers];
+
+        b = atomic_load_explicit (&dq->bottom, memory_order_relaxed);
+        dq->task[b] = task[i];
+        atomic_store_explicit (&dq->bottom, b + 1, memory_order_relaxed);
+    }
+    atomic_store_explicit (&pool->left, n, memory_order_relaxed);
+
+    pthread_barrier_wait (&pool->start);
+    work (&pool->dq[0]);
+    pthread_barrier_wait (&pool->end);
+}
+
+/**
+ *  \brief Destroying a pool: its workers end.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return number of tasks stolen over all rounds
+ */
+unsigned long poolDestroy (TASK_POOL *pool)
+{
+    unsigned long steals = 0;
+    unsigned int w;
+
+    pool->quit = true;
+    pthread_barrier_wait (&pool->start);
+    for (w = 1; w < pool->nWorkers; w++) {
+        pthread_join (pool->tids[w], NULL);
+    }
+    for (w = 0; w < pool->nWorkers; w++) {
+        steals += pool->dq[w].steals;
+        free (pool->dq[w].task);
+    }
+    pthread_barrier_destroy (&pool->start);
+    pthread_barrier_destroy (&pool->end);
+    free (pool->dq);
+    free (pool->tids);
+    return steals;
+}
@@ -0,0 +1,110 @@
+/**
+ *  \file taskPool.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Pool of worker threads that run rounds of tasks, balanced by work stealing.
+ *
+ *  The tasks of a round are numbers, dealt round-robin to the workers (task t to worker t % workers, so that a task
+ *  keeps running on the same worker round after round); each worker pops the tasks of its own deque, from its
+ *  bottom, and once it is empty steals from the top of the deques of the others, until every task of the round was
+ *  taken. The deques are those of Chase and Lev, with the atomics of Lê et al.; tasks are only pushed between
+ *  rounds, while the workers are parked on a barrier, so that a deque never grows.
+ *
+ *  The thread that creates the pool is worker 0: it runs tasks too during a round, and each round ends when all
+ *  workers have finished theirs.
+ *
+ *  Defined operations:
+ *     \li creating a pool
+ *     \li running a round of tasks
+ *     \li destroying a pool.
+ */
+
+#ifndef TASKPOOL_H_
+#define TASKPOOL_H_
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "probConst.h"
+
+/** \brief upper bound for the number of workers of a pool */
+#define  POOL_MAXWORKERS   256
+
+/** \brief task pool, defined below */
+typedef struct TASK_POOL TASK_POOL;
+
+/**
+ *  \brief Definition of <em>task deque</em> data type.
+ *
+ *  The position of the thieves and that of the owner start each a cache line of their own.
+ */
+typedef struct {
+    /** \brief next task to be stolen */
+    _Alignas (CACHELINE) atomic_long top;
+    /** \brief one past the next task to be popped by the owner */
+    _Alignas (CACHELINE) atomic_long bottom;
+    /** \brief tasks (as many as there are tasks in a round) */
+    unsigned int *task;
+    /** \brief number of tasks this worker stole from others */
+    unsigned long steals;
+    /** \brief pool of the worker */
+    TASK_POOL *pool;
+} TASK_DEQUE;
+
+/**
+ *  \brief Definition of <em>task pool</em> data type.
+ */
+struct TASK_POOL {
+    /** \brief number of workers, the creating thread included */
+    unsigned int nWorkers;
+    /** \brief task function: runs task <tt>task</tt> on the context of the pool */
+    void (*run) (void *ctx, unsigned int task);
+    /** \brief context of the task function */
+    void *ctx;
+    /** \brief deque of each worker */
+    TASK_DEQUE *dq;
+    /** \brief worker threads (all but worker 0) */
+    pthread_t *tids;
+    /** \brief workers wait here for a round to start */
+    pthread_barrier_t start;
+    /** \brief workers wait here for a round to end */
+    pthread_barrier_t end;
+    /** \brief tasks of the present round not taken yet */
+    _Alignas (CACHELINE) atomic_uint left;
+    /** \brief the workers are to end, instead of running a round */
+    bool quit;
+};
+
+/**
+ *  \brief Creating a pool, whose worker 0 is the calling thread.
+ *
+ *  \param pool pointer to the pool
+ *  \param nWorkers number of workers (1..POOL_MAXWORKERS)
+ *  \param maxTasks largest number of tasks of a round
+ *  \param run task function
+ *  \param ctx context of the task function
+ */
+extern void poolInit (TASK_POOL *pool, unsigned int nWorkers, unsigned int maxTasks,
+                      void (*run) (void *ctx, unsigned int task), void *ctx);
+
+/**
+ *  \brief Running a round of tasks, each one once, returning when all of them ran.
+ *
+ *  \param pool pointer to the pool
+ *  \param task tasks of the round
+ *  \param n number of tasks of the round
+ */
+extern void poolRound (TASK_POOL *pool, const unsigned int *task, unsigned int n);
+
+/**
+ *  \brief Destroying a pool: its workers end.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return number of tasks stolen over all rounds
+ */
+extern unsigned long poolDestroy (TASK_POOL *pool);
+
+#endif /* TASKPOOL_H_ */